@@ -62,6 +62,10 @@ void BrewEngine::Init()
 	// read other settings like maishschedules and pid
 	this->readSettings();
 
+	// allocated once, so a long run doesn't fragment the heap
+	this->tempLog.reserve(CONFIG_HISTORY_BUDGET);
+	this->channelLog.reserve(CONFIG_CHANNEL_HISTORY_BUDGET);
+
 	this->readTempSensorSettings();
 
 	this->initOneWire();
@@ -70,388 +74,553 @@ void BrewEngine::Init()
 
 	this->initMqtt();
 
+	// a run that was going when we went down is picked up by the read loop
+	this->readCheckpoint();
+
+	// versions restart with every boot, a random start keeps a client from taking the plan it had before a reboot
+	// for the current one, like after a resume where the rebuilt plan would otherwise get the same version
+	this->runningVersion = (uint16_t)esp_random();
+
 	this->run = true;
 
-	xTaskCreate(&this->readLoop, "readloop_task", 4096, this, 5, NULL);
+	xTaskCreate(&this->readLoop, "readloop_task", 4096, this, 5, &this->readLoopHandle);
+
+	// one long lived task handles all notifications, it just waits on the queue
+	this->notificationQueue = xQueueCreate(10, sizeof(NotificationEvent *));
+	xTaskCreate(&this->notificationLoop, "notification_task", 4096, this, 10, &this->notificationLoopHandle);
+
+	// slow api commands like wifi scans run here, so the webserver stays responsive
+	this->jobQueue = xQueueCreate(API_JOB_HISTORY, sizeof(CommandJob *));
+	xTaskCreate(&this->jobLoop, "job_task", 8192, this, 5, &this->jobLoopHandle);
+
+	this->initWebFiles();
+
+	this->initBrewLogStorage();
 
 	this->server = this->startWebserver();
 }
 
-void BrewEngine::initHeaters()
+void BrewEngine::initWebFiles()
 {
-	for (auto const &heater : this->heaters)
+	esp_vfs_spiffs_conf_t conf = {};
+	conf.base_path = "/www";
+	conf.partition_label = "www";
+	conf.max_files = 4;
+	conf.format_if_mount_failed = false;
+
+	esp_err_t ret = esp_vfs_spiffs_register(&conf);
+
+	if (ret != ESP_OK)
 	{
-		ESP_LOGI(TAG, "Heater %s Configured", heater->name.c_str());
+		// installs with an older partition table don't have it
+		ESP_LOGI(TAG, "No web partition (%s), using embedded ui", esp_err_to_name(ret));
+		return;
+	}
 
-		gpio_reset_pin(heater->pinNr);
-		gpio_set_direction(heater->pinNr, GPIO_MODE_OUTPUT);
-		gpio_set_level(heater->pinNr, this->gpioLow);
+	this->webFilesMounted = true;
+
+	// written by updatewebfiles.sh, a line with the hash and path of every file
+	FILE *file = fopen("/www/etags", "r");
+	if (file == NULL)
+	{
+		ESP_LOGW(TAG, "Web partition has no etags, files are sent without");
+		return;
 	}
+
+	this->webFileEtags.load(file);
+	fclose(file);
 }
 
-void BrewEngine::readSystemSettings()
+void BrewEngine::initBrewLogStorage()
 {
-	ESP_LOGI(TAG, "Reading System Settings");
+	esp_vfs_spiffs_conf_t conf = {};
+	conf.base_path = "/brewlog";
+	conf.partition_label = "brewlog";
+	conf.max_files = 2;
+	conf.format_if_mount_failed = true; // only holds our logs, a fresh partition needs formatting once
 
-	// io settings
-	this->oneWire_PIN = (gpio_num_t)this->settingsManager->Read("onewirePin", (uint16_t)CONFIG_ONEWIRE);
-	this->stir_PIN = (gpio_num_t)this->settingsManager->Read("stirPin", (uint16_t)CONFIG_STIR);
-	this->buzzer_PIN = (gpio_num_t)this->settingsManager->Read("buzzerPin", (uint16_t)CONFIG_BUZZER);
-	this->buzzerTime = this->settingsManager->Read("buzzerTime", (uint8_t)2);
+	esp_err_t ret = esp_vfs_spiffs_register(&conf);
 
-	bool configInvertOutputs = false;
-// is there a cleaner way to do this?, config to bool doesn't seem to work properly
-#if defined(CONFIG_InvertOutputs)
-	configInvertOutputs = true;
-#endif
-	this->invertOutputs = this->settingsManager->Read("invertOutputs", configInvertOutputs);
+	if (ret != ESP_OK)
+	{
+		// installs with an older partition table don't have it
+		ESP_LOGI(TAG, "No brew log partition (%s), brews are not logged to flash", esp_err_to_name(ret));
+		return;
+	}
 
-	// mqtt
-	this->mqttUri = this->settingsManager->Read("mqttUri", (string)CONFIG_MQTT_URI);
+	this->brewLog.setDirectory("/brewlog");
+}
 
-	// temperature scale
-	uint8_t defaultConfigScale = 0; // default to Celsius
-#if defined(CONFIG_SCALE_FAHRENHEIT)
-	defaultConfigScale = Fahrenheit;
-#endif
+void BrewEngine::initHeaters()
+{
+	for (auto const &heater : this->heaters)
+	{
+		ESP_LOGI(TAG, "Heater %s Configured", heater->name.c_str());
 
-	this->temperatureScale = (TemperatureScale)this->settingsManager->Read("tempScale", defaultConfigScale);
+		gpio_reset_pin(heater->pinNr);
+		gpio_set_direction(heater->pinNr, GPIO_MODE_OUTPUT);
+		gpio_set_level(heater->pinNr, this->gpioLow);
+	}
+}
 
-	ESP_LOGI(TAG, "Reading System Settings Done");
+// the settings of each group, the api uses the name in the schema
+auto BrewEngine::systemSettingFields()
+{
+	return std::make_tuple(
+		SettingField{BrewSettings::onewirePin, &BrewEngine::oneWire_PIN},
+		SettingField{BrewSettings::stirPin, &BrewEngine::stir_PIN},
+		SettingField{BrewSettings::buzzerPin, &BrewEngine::buzzer_PIN},
+		SettingField{BrewSettings::buzzerTime, &BrewEngine::buzzerTime},
+		SettingField{BrewSettings::invertOutputs, &BrewEngine::invertOutputs},
+		SettingField{BrewSettings::mqttUri, &BrewEngine::mqttUri},
+		SettingField{BrewSettings::temperatureScale, &BrewEngine::temperatureScale});
 }
 
-void BrewEngine::saveSystemSettingsJson(const json &config)
+auto BrewEngine::pidSettingFields()
 {
-	ESP_LOGI(TAG, "Saving System Settings");
+	return std::make_tuple(
+		SettingField{BrewSettings::mashkP, &BrewEngine::mashkP},
+		SettingField{BrewSettings::mashkI, &BrewEngine::mashkI},
+		SettingField{BrewSettings::mashkD, &BrewEngine::mashkD},
+		SettingField{BrewSettings::boilkP, &BrewEngine::boilkP},
+		SettingField{BrewSettings::boilkI, &BrewEngine::boilkI},
+		SettingField{BrewSettings::boilkD, &BrewEngine::boilkD},
+		SettingField{BrewSettings::pidLoopTime, &BrewEngine::pidLoopTime},
+		SettingField{BrewSettings::stepInterval, &BrewEngine::stepInterval},
+		SettingField{BrewSettings::boostModeUntil, &BrewEngine::boostModeUntil},
+		SettingField{BrewSettings::heatUpRate, &BrewEngine::heatUpRate});
+}
 
-	if (!config["onewirePin"].is_null() && config["onewirePin"].is_number())
-	{
-		this->settingsManager->Write("onewirePin", (uint16_t)config["onewirePin"]);
-		this->oneWire_PIN = (gpio_num_t)config["onewirePin"];
-	}
-	if (!config["stirPin"].is_null() && config["stirPin"].is_number())
-	{
-		this->settingsManager->Write("stirPin", (uint16_t)config["stirPin"]);
-		this->stir_PIN = (gpio_num_t)config["stirPin"];
-	}
-	if (!config["buzzerPin"].is_null() && config["buzzerPin"].is_number())
-	{
-		this->settingsManager->Write("buzzerPin", (uint16_t)config["buzzerPin"]);
-		this->buzzer_PIN = (gpio_num_t)config["buzzerPin"];
-	}
-	if (!config["buzzerTime"].is_null() && config["buzzerTime"].is_number())
-	{
-		this->settingsManager->Write("buzzerTime", (uint8_t)config["buzzerTime"]);
-		this->buzzerTime = (uint8_t)config["buzzerTime"];
-	}
-	if (!config["invertOutputs"].is_null() && config["invertOutputs"].is_boolean())
+// value from the api, nullopt when it has the wrong type or is out of range
+template <typename T>
+static std::optional<T> settingFromJson(const json &value, const Setting<T> &setting)
+{
+	if constexpr (std::is_same_v<T, bool>)
 	{
-		this->settingsManager->Write("invertOutputs", (bool)config["invertOutputs"]);
-		this->invertOutputs = (bool)config["invertOutputs"];
+		if (!value.is_boolean())
+		{
+			return std::nullopt;
+		}
+		return value.get<bool>();
 	}
-	if (!config["mqttUri"].is_null() && config["mqttUri"].is_string())
+	else
 	{
-		this->settingsManager->Write("mqttUri", (string)config["mqttUri"]);
-		this->mqttUri = config["mqttUri"];
+		if (!value.is_number())
+		{
+			return std::nullopt;
+		}
+
+		// checked as double, a negative number would wrap around in an unsigned type
+		double number = value.get<double>();
+		if (!(number >= (double)setting.min && number <= (double)setting.max))
+		{
+			return std::nullopt;
+		}
+		if (std::is_integral_v<T> && std::trunc(number) != number)
+		{
+			return std::nullopt;
+		}
+
+		return static_cast<T>(number);
 	}
-	if (!config["temperatureScale"].is_null() && config["temperatureScale"].is_number())
+}
+
+static std::optional<string> settingFromJson(const json &value, const TextSetting &setting)
+{
+	if (!value.is_string() || !setting.valid(value.get<string>()))
 	{
-		uint8_t scale = (uint8_t)config["temperatureScale"];
-		this->settingsManager->Write("tempScale", scale); // key is limited to x chars so we shorten it
-		this->temperatureScale = (TemperatureScale)config["temperatureScale"];
+		return std::nullopt;
 	}
+	return value.get<string>();
+}
 
-	ESP_LOGI(TAG, "Saving System Settings Done");
+template <typename Fields>
+void BrewEngine::readSettingFields(const Fields &fields)
+{
+	std::apply([this](auto const &...field)
+			   { ((this->*field.member = static_cast<std::remove_reference_t<decltype(this->*field.member)>>(this->settingsManager->Get(field.setting))), ...); },
+			   fields);
 }
 
-void BrewEngine::readSettings()
+template <typename Fields>
+json BrewEngine::settingFieldsToJson(const Fields &fields)
 {
-	ESP_LOGI(TAG, "Reading Settings");
+	json jSettings = json::object();
+	std::apply([this, &jSettings](auto const &...field)
+			   { ((jSettings[field.setting.name] = static_cast<typename std::remove_cvref_t<decltype(field.setting)>::Type>(this->*field.member)), ...); },
+			   fields);
+	return jSettings;
+}
 
-	vector<uint8_t> empty = json::to_msgpack(json::array({}));
-	vector<uint8_t> serialized = this->settingsManager->Read("mashschedules", empty);
+// saves the fields that are in data, nothing is saved when one of them is invalid
+// returns the name of the invalid field, empty when saved
+template <typename Fields>
+string BrewEngine::saveSettingFields(const json &data, const Fields &fields)
+{
+	string invalid;
 
-	json jSchedules = json::from_msgpack(serialized);
+	auto check = [&data, &invalid](auto const &field)
+	{
+		const char *name = field.setting.name;
+		if (invalid.empty() && data.contains(name) && !data[name].is_null() && !settingFromJson(data[name], field.setting).has_value())
+		{
+			invalid = name;
+		}
+	};
+	std::apply([&check](auto const &...field)
+			   { (check(field), ...); },
+			   fields);
 
-	if (jSchedules.empty())
+	if (!invalid.empty())
 	{
-		ESP_LOGI(TAG, "Adding Default Mash Schedules");
-		this->addDefaultMash();
-		this->saveMashSchedules();
+		return invalid;
 	}
-	else
+
+	auto save = [this, &data](auto const &field)
 	{
-		for (const auto &el : jSchedules.items())
+		const char *name = field.setting.name;
+		if (!data.contains(name) || data[name].is_null())
 		{
-			json jSchedule = el.value();
+			return;
+		}
 
-			auto schedule = new MashSchedule();
-			schedule->from_json(jSchedule);
+		auto value = settingFromJson(data[name], field.setting).value();
+		this->settingsManager->Set(field.setting, value);
+		this->*field.member = static_cast<std::remove_reference_t<decltype(this->*field.member)>>(value);
+	};
+	std::apply([&save](auto const &...field)
+			   { (save(field), ...); },
+			   fields);
 
-			this->mashSchedules.insert_or_assign(schedule->name, schedule);
-		}
-	}
+	this->settingsManager->Commit();
+
+	return "";
+}
+
+void BrewEngine::readSystemSettings()
+{
+	ESP_LOGI(TAG, "Reading System Settings");
 
-	// we save and load pid doubles as unit16 becease nvs doesnt' have double support, and we are happy with only 1 decimal
-	uint16_t pint = this->settingsManager->Read("kP", (uint16_t)(this->mashkP * 10));
-	uint16_t iint = this->settingsManager->Read("kI", (uint16_t)(this->mashkI * 10));
-	uint16_t dint = this->settingsManager->Read("kD", (uint16_t)(this->mashkD * 10));
+	this->readSettingFields(systemSettingFields());
 
-	this->mashkP = (double)pint / 10;
-	this->mashkI = (double)iint / 10;
-	this->mashkD = (double)dint / 10;
+	ESP_LOGI(TAG, "Reading System Settings Done");
+}
 
-	uint16_t bpint = this->settingsManager->Read("boilkP", (uint16_t)(this->boilkP * 10));
-	uint16_t biint = this->settingsManager->Read("boilkI", (uint16_t)(this->boilkI * 10));
-	uint16_t bdint = this->settingsManager->Read("boilkD", (uint16_t)(this->boilkD * 10));
+string BrewEngine::saveSystemSettingsJson(const json &config)
+{
+	ESP_LOGI(TAG, "Saving System Settings");
 
-	this->boilkP = (double)bpint / 10;
-	this->boilkI = (double)biint / 10;
-	this->boilkD = (double)bdint / 10;
+	string invalid = this->saveSettingFields(config, systemSettingFields());
 
-	this->pidLoopTime = this->settingsManager->Read("pidLoopTime", (uint16_t)CONFIG_PID_LOOPTIME);
-	this->stepInterval = this->settingsManager->Read("stepInterval", (uint16_t)CONFIG_PID_LOOPTIME); // we use same as pidloop time
+	ESP_LOGI(TAG, "Saving System Settings Done");
 
-	this->boostModeUntil = this->settingsManager->Read("boostModeUntil", (uint8_t)this->boostModeUntil);
+	return invalid;
 }
 
-void BrewEngine::setMashSchedule(const json &jSchedule)
+// pid gains and the heat up rate used to be saved as uint16 with a fixed number of decimals, nvs has no floats
+void BrewEngine::migrateSettings()
 {
-	json newSteps = jSchedule["steps"];
+	auto migrate = [this](const char *key, auto const &setting, float divider)
+	{
+		if (!this->settingsManager->Contains(key))
+		{
+			return;
+		}
+
+		using T = typename std::remove_cvref_t<decltype(setting)>::Type;
+		T value = (T)this->settingsManager->Read(key, (uint16_t)0) / divider;
+
+		ESP_LOGI(TAG, "Migrating Setting %s to %s", key, setting.key);
+		this->settingsManager->Set(setting, std::clamp(value, setting.min, setting.max));
+		this->settingsManager->Erase(key);
+	};
+
+	migrate("kP", BrewSettings::mashkP, 10);
+	migrate("kI", BrewSettings::mashkI, 10);
+	migrate("kD", BrewSettings::mashkD, 10);
+	migrate("boilkP", BrewSettings::boilkP, 10);
+	migrate("boilkI", BrewSettings::boilkI, 10);
+	migrate("boilkD", BrewSettings::boilkD, 10);
+	migrate("heatUpRate", BrewSettings::heatUpRate, 100);
 
-	auto newMash = new MashSchedule();
-	newMash->name = jSchedule["name"].get<string>();
-	newMash->boil = jSchedule["boil"].get<bool>();
+	this->settingsManager->Commit();
+}
+
+void BrewEngine::readSettings()
+{
+	ESP_LOGI(TAG, "Reading Settings");
 
-	for (auto const &step : newMash->steps)
+	this->scheduleStore.init(this->settingsManager);
+	if (!this->scheduleStore.load())
 	{
-		delete step;
+		this->migrateMashSchedules();
 	}
-	newMash->steps.clear();
 
-	for (auto &el : newSteps.items())
+	if (this->scheduleStore.empty())
 	{
-		auto jStep = el.value();
+		ESP_LOGI(TAG, "Adding Default Mash Schedules");
+		this->addDefaultMash();
 
-		auto newStep = new MashStep();
-		newStep->from_json(jStep);
-		newMash->steps.push_back(newStep);
+		// still on the main task, nothing else uses the schedules yet
+		for (auto &[name, schedule] : this->mashSchedules)
+		{
+			this->scheduleStore.save(schedule.to_json());
+		}
 	}
 
-	newMash->sort_steps();
+	this->migrateSettings();
+	this->readSettingFields(pidSettingFields());
+
+	this->readHistoryChannelSettings();
+}
+
+void BrewEngine::setMashSchedule(const json &jSchedule)
+{
+	MashSchedule newMash;
+	newMash.name = jSchedule["name"].get<string>();
+	newMash.boil = jSchedule["boil"].get<bool>();
 
-	json newNotifications = jSchedule["notifications"];
-	for (auto const &notification : newMash->notifications)
+	const json &newSteps = jSchedule["steps"];
+	newMash.steps.reserve(newSteps.size());
+	for (auto &jStep : newSteps)
 	{
-		delete notification;
+		MashStep &newStep = newMash.steps.emplace_back();
+		newStep.from_json(jStep);
 	}
-	newMash->notifications.clear();
 
-	for (auto &el : newNotifications.items())
-	{
-		auto jNotification = el.value();
+	newMash.sort_steps();
 
-		auto newNotification = new Notification();
-		newNotification->from_json(jNotification);
-		newMash->notifications.push_back(newNotification);
+	const json &newNotifications = jSchedule["notifications"];
+	newMash.notifications.reserve(newNotifications.size());
+	for (auto &jNotification : newNotifications)
+	{
+		Notification &newNotification = newMash.notifications.emplace_back();
+		newNotification.from_json(jNotification);
 	}
 
-	newMash->sort_notifications();
+	newMash.sort_notifications();
 
-	this->mashSchedules.insert_or_assign(newMash->name, newMash);
+	// replaces the schedule with the same name, which releases its steps and notifications
+	string name = newMash.name;
+	std::lock_guard<std::mutex> lock(this->mashSchedulesLock);
+	this->mashSchedules.insert_or_assign(name, std::move(newMash));
 }
 
-void BrewEngine::saveMashSchedules()
+// parsed on first use, most schedules aren't needed between two boots
+// returns a copy, the schedule can be replaced or deleted from the api while the caller still uses it
+// keep is for a schedule that is run or edited, listing them all shouldn't hold the whole library in ram
+std::optional<MashSchedule> BrewEngine::findMashSchedule(const string &name, bool keep)
 {
-	ESP_LOGI(TAG, "Saving Mash Schedules");
+	std::lock_guard<std::mutex> lock(this->mashSchedulesLock);
 
-	json jSchedules = json::array({});
-	for (auto const &[key, mashSchedule] : this->mashSchedules)
+	auto pos = this->mashSchedules.find(name);
+	if (pos != this->mashSchedules.end())
 	{
+		return pos->second;
+	}
 
-		if (!mashSchedule->temporary)
-		{
-			json jSchedule = mashSchedule->to_json();
-			jSchedules.push_back(jSchedule);
-		}
+	json jSchedule = this->scheduleStore.read(name);
+	if (jSchedule.is_null())
+	{
+		return std::nullopt;
 	}
 
-	// serialize to MessagePack for size
-	vector<uint8_t> serialized = json::to_msgpack(jSchedules);
+	MashSchedule schedule;
+	schedule.from_json(jSchedule);
+	schedule.name = name;
 
-	this->settingsManager->Write("mashschedules", serialized);
+	if (keep)
+	{
+		this->mashSchedules.insert_or_assign(name, schedule);
+	}
 
-	ESP_LOGI(TAG, "Saving Mash Schedules Done, %d bytes", serialized.size());
+	return schedule;
 }
 
-void BrewEngine::savePIDSettings()
+void BrewEngine::saveMashSchedule(const string &name)
 {
-	ESP_LOGI(TAG, "Saving PID Settings");
+	ESP_LOGI(TAG, "Saving Mash Schedule %s", name.c_str());
+
+	std::lock_guard<std::mutex> lock(this->mashSchedulesLock);
 
-	uint16_t pint = static_cast<uint16_t>(this->mashkP * 10);
-	uint16_t iint = static_cast<uint16_t>(this->mashkI * 10);
-	uint16_t dint = static_cast<uint16_t>(this->mashkD * 10);
+	auto pos = this->mashSchedules.find(name);
+	if (pos == this->mashSchedules.end() || pos->second.temporary)
+	{
+		return;
+	}
 
-	this->settingsManager->Write("kP", pint);
-	this->settingsManager->Write("kI", iint);
-	this->settingsManager->Write("kD", dint);
+	this->scheduleStore.save(pos->second.to_json());
 
-	uint16_t bpint = static_cast<uint16_t>(this->boilkP * 10);
-	uint16_t biint = static_cast<uint16_t>(this->boilkI * 10);
-	uint16_t bdint = static_cast<uint16_t>(this->boilkD * 10);
+	ESP_LOGI(TAG, "Saving Mash Schedule Done");
+}
 
-	this->settingsManager->Write("boilkP", bpint);
-	this->settingsManager->Write("boilkI", biint);
-	this->settingsManager->Write("boilkD", bdint);
+// schedules used to be saved all together in one blob
+void BrewEngine::migrateMashSchedules()
+{
+	vector<uint8_t> serialized = this->settingsManager->Get(BrewSettings::legacySchedules, vector<uint8_t>());
+	if (serialized.empty())
+	{
+		return;
+	}
 
-	this->settingsManager->Write("pidLoopTime", this->pidLoopTime);
-	this->settingsManager->Write("stepInterval", this->stepInterval);
+	json jSchedules = json::from_msgpack(serialized, true, false);
+	if (jSchedules.is_array())
+	{
+		ESP_LOGI(TAG, "Migrating %d Mash Schedules", jSchedules.size());
 
-	this->settingsManager->Write("boostModeUntil", this->boostModeUntil);
+		for (auto const &jSchedule : jSchedules)
+		{
+			if (jSchedule.is_object() && jSchedule.contains("name") && jSchedule["name"].is_string())
+			{
+				this->scheduleStore.save(jSchedule);
+			}
+		}
+	}
 
-	ESP_LOGI(TAG, "Saving PID Settings Done");
+	this->settingsManager->Erase(BrewSettings::legacySchedules.key);
+	this->settingsManager->Commit();
 }
 
 void BrewEngine::addDefaultMash()
 {
-	auto defaultMash = new MashSchedule();
-	defaultMash->name = "Default";
-	defaultMash->boil = false;
-
-	auto defaultMash_s1 = new MashStep();
-	defaultMash_s1->index = 0;
-	defaultMash_s1->name = "Beta Amylase";
-	defaultMash_s1->temperature = (this->temperatureScale == Celsius) ? 64 : 150;
-	defaultMash_s1->stepTime = 5;
-	defaultMash_s1->extendStepTimeIfNeeded = true;
-	defaultMash_s1->allowBoost = true;
-	defaultMash_s1->time = 45;
-	defaultMash->steps.push_back(defaultMash_s1);
-
-	auto defaultMash_s2 = new MashStep();
-	defaultMash_s2->index = 1;
-	defaultMash_s2->name = "Alpha Amylase";
-	defaultMash_s2->temperature = (this->temperatureScale == Celsius) ? 72 : 160;
-	defaultMash_s2->stepTime = 5;
-	defaultMash_s2->extendStepTimeIfNeeded = true;
-	defaultMash_s2->allowBoost = false;
-	defaultMash_s2->time = 20;
-	defaultMash->steps.push_back(defaultMash_s2);
-
-	auto defaultMash_s3 = new MashStep();
-	defaultMash_s3->index = 2;
-	defaultMash_s3->name = "Mash Out";
-	defaultMash_s3->temperature = (this->temperatureScale == Celsius) ? 78 : 170;
-	defaultMash_s3->stepTime = 5;
-	defaultMash_s3->extendStepTimeIfNeeded = true;
-	defaultMash_s3->allowBoost = false;
-	defaultMash_s3->time = 5;
-	defaultMash->steps.push_back(defaultMash_s3);
-
-	auto defaultMash_n1 = new Notification();
-	defaultMash_n1->name = "Add Grains";
-	defaultMash_n1->message = "Please add Grains";
-	defaultMash_n1->timeFromStart = 5;
-	defaultMash_n1->buzzer = true;
-	defaultMash->notifications.push_back(defaultMash_n1);
-
-	auto defaultMash_n2 = new Notification();
-	defaultMash_n2->name = "Start Lautering";
-	defaultMash_n2->message = "Please Start Lautering/Sparging";
-	defaultMash_n2->timeFromStart = 85;
-	defaultMash_n2->buzzer = true;
-	defaultMash->notifications.push_back(defaultMash_n2);
-
-	this->mashSchedules.insert_or_assign(defaultMash->name, defaultMash);
-
-	auto ryeMash = new MashSchedule();
-	ryeMash->name = "Rye Mash";
-	ryeMash->boil = false;
-
-	auto ryeMash_s1 = new MashStep();
-	ryeMash_s1->index = 0;
-	ryeMash_s1->name = "Beta Glucanase";
-	ryeMash_s1->temperature = (this->temperatureScale == Celsius) ? 43 : 110;
-	ryeMash_s1->stepTime = 5;
-	ryeMash_s1->extendStepTimeIfNeeded = true;
-	ryeMash_s1->allowBoost = true;
-	ryeMash_s1->time = 20;
-	ryeMash->steps.push_back(ryeMash_s1);
-
-	auto ryeMash_s2 = new MashStep();
-	ryeMash_s2->index = 1;
-	ryeMash_s2->name = "Beta Amylase";
-	ryeMash_s2->temperature = (this->temperatureScale == Celsius) ? 64 : 150;
-	ryeMash_s2->stepTime = 5;
-	ryeMash_s2->extendStepTimeIfNeeded = true;
-	ryeMash_s2->allowBoost = false;
-	ryeMash_s2->time = 45;
-	ryeMash->steps.push_back(ryeMash_s2);
-
-	auto ryeMash_s3 = new MashStep();
-	ryeMash_s3->index = 2;
-	ryeMash_s3->name = "Alpha Amylase";
-	ryeMash_s3->temperature = (this->temperatureScale == Celsius) ? 72 : 160;
-	ryeMash_s3->stepTime = 5;
-	ryeMash_s3->extendStepTimeIfNeeded = true;
-	ryeMash_s3->allowBoost = false;
-	ryeMash_s3->time = 20;
-	ryeMash->steps.push_back(ryeMash_s3);
-
-	auto ryeMash_s4 = new MashStep();
-	ryeMash_s4->index = 3;
-	ryeMash_s4->name = "Mash Out";
-	ryeMash_s4->temperature = (this->temperatureScale == Celsius) ? 78 : 170;
-	ryeMash_s4->stepTime = 5;
-	ryeMash_s4->extendStepTimeIfNeeded = true;
-	ryeMash_s4->allowBoost = false;
-	ryeMash_s4->time = 5;
-	ryeMash->steps.push_back(ryeMash_s4);
-
-	auto ryeMash_n1 = new Notification();
-	ryeMash_n1->name = "Add Grains";
-	ryeMash_n1->message = "Please add Grains";
-	ryeMash_n1->timeFromStart = 5;
-	ryeMash_n1->buzzer = true;
-	ryeMash->notifications.push_back(ryeMash_n1);
-
-	auto ryeMash_n2 = new Notification();
-	ryeMash_n2->name = "Start Lautering";
-	ryeMash_n2->message = "Please Start Lautering/Sparging";
-	ryeMash_n2->timeFromStart = 110;
-	ryeMash_n2->buzzer = true;
-	ryeMash->notifications.push_back(ryeMash_n2);
-
-	this->mashSchedules.insert_or_assign(ryeMash->name, ryeMash);
-
-	auto boil = new MashSchedule();
-	boil->name = "Boil 70 Min";
-	boil->boil = true;
-
-	auto boil_s1 = new MashStep();
-	boil_s1->index = 0;
-	boil_s1->name = "Boil";
-	boil_s1->temperature = (this->temperatureScale == Celsius) ? 101 : 214;
-	boil_s1->stepTime = 0;
-	boil_s1->extendStepTimeIfNeeded = true;
-	boil_s1->time = 70;
-	boil->steps.push_back(boil_s1);
-
-	auto boil_n1 = new Notification();
-	boil_n1->name = "Bittering Hops";
-	boil_n1->message = "Please add Bittering Hops";
-	boil_n1->timeFromStart = 0;
-	boil_n1->buzzer = true;
-	boil->notifications.push_back(boil_n1);
-
-	auto boil_n2 = new Notification();
-	boil_n2->name = "Aroma Hops";
-	boil_n2->message = "Please add Aroma Hops";
-	boil_n2->timeFromStart = 55;
-	boil_n2->buzzer = true;
-	boil->notifications.push_back(boil_n2);
-
-	this->mashSchedules.insert_or_assign(boil->name, boil);
+	MashSchedule defaultMash;
+	defaultMash.name = "Default";
+	defaultMash.boil = false;
+
+	MashStep defaultMash_s1;
+	defaultMash_s1.index = 0;
+	defaultMash_s1.name = "Beta Amylase";
+	defaultMash_s1.temperature = (this->temperatureScale == Celsius) ? 64 : 150;
+	defaultMash_s1.stepTime = 5;
+	defaultMash_s1.extendStepTimeIfNeeded = true;
+	defaultMash_s1.allowBoost = true;
+	defaultMash_s1.time = 45;
+	defaultMash.steps.push_back(defaultMash_s1);
+
+	MashStep defaultMash_s2;
+	defaultMash_s2.index = 1;
+	defaultMash_s2.name = "Alpha Amylase";
+	defaultMash_s2.temperature = (this->temperatureScale == Celsius) ? 72 : 160;
+	defaultMash_s2.stepTime = 5;
+	defaultMash_s2.extendStepTimeIfNeeded = true;
+	defaultMash_s2.allowBoost = false;
+	defaultMash_s2.time = 20;
+	defaultMash.steps.push_back(defaultMash_s2);
+
+	MashStep defaultMash_s3;
+	defaultMash_s3.index = 2;
+	defaultMash_s3.name = "Mash Out";
+	defaultMash_s3.temperature = (this->temperatureScale == Celsius) ? 78 : 170;
+	defaultMash_s3.stepTime = 5;
+	defaultMash_s3.extendStepTimeIfNeeded = true;
+	defaultMash_s3.allowBoost = false;
+	defaultMash_s3.time = 5;
+	defaultMash.steps.push_back(defaultMash_s3);
+
+	Notification defaultMash_n1;
+	defaultMash_n1.name = "Add Grains";
+	defaultMash_n1.message = "Please add Grains";
+	defaultMash_n1.timeFromStart = 5;
+	defaultMash_n1.buzzer = true;
+	defaultMash.notifications.push_back(defaultMash_n1);
+
+	Notification defaultMash_n2;
+	defaultMash_n2.name = "Start Lautering";
+	defaultMash_n2.message = "Please Start Lautering/Sparging";
+	defaultMash_n2.timeFromStart = 85;
+	defaultMash_n2.buzzer = true;
+	defaultMash.notifications.push_back(defaultMash_n2);
+
+	this->mashSchedules.insert_or_assign(defaultMash.name, defaultMash);
+
+	MashSchedule ryeMash;
+	ryeMash.name = "Rye Mash";
+	ryeMash.boil = false;
+
+	MashStep ryeMash_s1;
+	ryeMash_s1.index = 0;
+	ryeMash_s1.name = "Beta Glucanase";
+	ryeMash_s1.temperature = (this->temperatureScale == Celsius) ? 43 : 110;
+	ryeMash_s1.stepTime = 5;
+	ryeMash_s1.extendStepTimeIfNeeded = true;
+	ryeMash_s1.allowBoost = true;
+	ryeMash_s1.time = 20;
+	ryeMash.steps.push_back(ryeMash_s1);
+
+	MashStep ryeMash_s2;
+	ryeMash_s2.index = 1;
+	ryeMash_s2.name = "Beta Amylase";
+	ryeMash_s2.temperature = (this->temperatureScale == Celsius) ? 64 : 150;
+	ryeMash_s2.stepTime = 5;
+	ryeMash_s2.extendStepTimeIfNeeded = true;
+	ryeMash_s2.allowBoost = false;
+	ryeMash_s2.time = 45;
+	ryeMash.steps.push_back(ryeMash_s2);
+
+	MashStep ryeMash_s3;
+	ryeMash_s3.index = 2;
+	ryeMash_s3.name = "Alpha Amylase";
+	ryeMash_s3.temperature = (this->temperatureScale == Celsius) ? 72 : 160;
+	ryeMash_s3.stepTime = 5;
+	ryeMash_s3.extendStepTimeIfNeeded = true;
+	ryeMash_s3.allowBoost = false;
+	ryeMash_s3.time = 20;
+	ryeMash.steps.push_back(ryeMash_s3);
+
+	MashStep ryeMash_s4;
+	ryeMash_s4.index = 3;
+	ryeMash_s4.name = "Mash Out";
+	ryeMash_s4.temperature = (this->temperatureScale == Celsius) ? 78 : 170;
+	ryeMash_s4.stepTime = 5;
+	ryeMash_s4.extendStepTimeIfNeeded = true;
+	ryeMash_s4.allowBoost = false;
+	ryeMash_s4.time = 5;
+	ryeMash.steps.push_back(ryeMash_s4);
+
+	Notification ryeMash_n1;
+	ryeMash_n1.name = "Add Grains";
+	ryeMash_n1.message = "Please add Grains";
+	ryeMash_n1.timeFromStart = 5;
+	ryeMash_n1.buzzer = true;
+	ryeMash.notifications.push_back(ryeMash_n1);
+
+	Notification ryeMash_n2;
+	ryeMash_n2.name = "Start Lautering";
+	ryeMash_n2.message = "Please Start Lautering/Sparging";
+	ryeMash_n2.timeFromStart = 110;
+	ryeMash_n2.buzzer = true;
+	ryeMash.notifications.push_back(ryeMash_n2);
+
+	this->mashSchedules.insert_or_assign(ryeMash.name, ryeMash);
+
+	MashSchedule boil;
+	boil.name = "Boil 70 Min";
+	boil.boil = true;
+
+	MashStep boil_s1;
+	boil_s1.index = 0;
+	boil_s1.name = "Boil";
+	boil_s1.temperature = (this->temperatureScale == Celsius) ? 101 : 214;
+	boil_s1.stepTime = 0;
+	boil_s1.extendStepTimeIfNeeded = true;
+	boil_s1.time = 70;
+	boil.steps.push_back(boil_s1);
+
+	Notification boil_n1;
+	boil_n1.name = "Bittering Hops";
+	boil_n1.message = "Please add Bittering Hops";
+	boil_n1.timeFromStart = 0;
+	boil_n1.buzzer = true;
+	boil.notifications.push_back(boil_n1);
+
+	Notification boil_n2;
+	boil_n2.name = "Aroma Hops";
+	boil_n2.message = "Please add Aroma Hops";
+	boil_n2.timeFromStart = 55;
+	boil_n2.buzzer = true;
+	boil.notifications.push_back(boil_n2);
+
+	this->mashSchedules.insert_or_assign(boil.name, boil);
 }
 
 void BrewEngine::addDefaultHeaters()
@@ -481,7 +650,7 @@ void BrewEngine::addDefaultHeaters()
 void BrewEngine::readHeaterSettings()
 {
 	vector<uint8_t> empty = json::to_msgpack(json::array({}));
-	vector<uint8_t> serialized = this->settingsManager->Read("heaters", empty);
+	vector<uint8_t> serialized = this->settingsManager->Get(BrewSettings::heaters, empty);
 
 	json jHeaters = json::from_msgpack(serialized);
 
@@ -561,7 +730,7 @@ void BrewEngine::saveHeaterSettings(const json &jHeaters)
 	// Serialize to MessagePack for size
 	vector<uint8_t> serialized = json::to_msgpack(jHeaters);
 
-	this->settingsManager->Write("heaters", serialized);
+	this->settingsManager->Set(BrewSettings::heaters, serialized);
 
 	// re-init so they can be used
 	this->initHeaters();
@@ -572,7 +741,7 @@ void BrewEngine::saveHeaterSettings(const json &jHeaters)
 void BrewEngine::readTempSensorSettings()
 {
 	vector<uint8_t> empty = json::to_msgpack(json::array({}));
-	vector<uint8_t> serialized = this->settingsManager->Read("tempsensors", empty);
+	vector<uint8_t> serialized = this->settingsManager->Get(BrewSettings::tempSensors, empty);
 
 	json jTempSensors = json::from_msgpack(serialized);
 
@@ -696,7 +865,7 @@ void BrewEngine::saveTempSensorSettings(const json &jTempSensors)
 	// Serialize to MessagePack for size
 	vector<uint8_t> serialized = json::to_msgpack(jSensors);
 
-	this->settingsManager->Write("tempsensors", serialized);
+	this->settingsManager->Set(BrewSettings::tempSensors, serialized);
 
 	// continue our temp loop
 	this->skipTempLoop = false;
@@ -704,6 +873,219 @@ void BrewEngine::saveTempSensorSettings(const json &jTempSensors)
 	ESP_LOGI(TAG, "Saving Temp Sensor Settings Done");
 }
 
+void BrewEngine::readHistoryChannelSettings()
+{
+	vector<uint8_t> empty = json::to_msgpack(json::object());
+	vector<uint8_t> serialized = this->settingsManager->Get(BrewSettings::historyChannels, empty);
+
+	json jChannels = json::from_msgpack(serialized, true, false);
+
+	this->historyChannels.clear();
+	if (jChannels.is_object())
+	{
+		for (auto &[name, enabled] : jChannels.items())
+		{
+			if (enabled.is_boolean())
+			{
+				this->historyChannels.insert_or_assign(name, enabled.get<bool>());
+			}
+		}
+	}
+}
+
+// channels for the current sensors and heaters, each logged unless it was switched off
+std::vector<ChannelHistory::Channel> BrewEngine::historyChannelList()
+{
+	std::vector<ChannelHistory::Channel> channels = {
+		{"temp", 10, true},
+		{"target", 10, true},
+		{"output", 1, true},
+	};
+
+	for (auto const &[key, sensor] : this->sensors)
+	{
+		channels.push_back({"sensor:" + std::to_string(key), 10, true});
+	}
+
+	for (auto const &heater : this->heaters)
+	{
+		channels.push_back({"heater:" + std::to_string(heater->id), 1, true});
+	}
+
+	for (auto &channel : channels)
+	{
+		auto flag = this->historyChannels.find(channel.name);
+		if (flag != this->historyChannels.end())
+		{
+			channel.enabled = flag->second;
+		}
+	}
+
+	return channels;
+}
+
+void BrewEngine::configureChannelLog()
+{
+	std::vector<ChannelHistory::Channel> channels = this->historyChannelList();
+
+	this->channelLog.configure(channels);
+	this->channelValues.assign(channels.size(), NAN);
+	this->lastChannelLogTime = 0;
+}
+
+void BrewEngine::logChannels(time_t now)
+{
+	const std::vector<ChannelHistory::Channel> &channels = this->channelLog.channels();
+
+	for (size_t i = 0; i < channels.size(); i++)
+	{
+		const string &name = channels[i].name;
+		float value = NAN;
+
+		if (name == "temp")
+		{
+			value = this->temperature;
+		}
+		else if (name == "target")
+		{
+			value = this->targetTemperature;
+		}
+		else if (name == "output")
+		{
+			value = this->pidOutput;
+		}
+		else if (name.starts_with("sensor:"))
+		{
+			// sensors can be removed or disconnect during a run, those get no value
+			auto sensor = this->sensors.find(std::stoull(name.substr(7)));
+			if (sensor != this->sensors.end() && sensor->second->connected)
+			{
+				value = sensor->second->lastTemp;
+			}
+		}
+		else if (name.starts_with("heater:"))
+		{
+			uint8_t id = (uint8_t)std::stoul(name.substr(7));
+			auto heater = std::find_if(this->heaters.begin(), this->heaters.end(), [id](const Heater *h)
+									   { return h->id == id; });
+			if (heater != this->heaters.end())
+			{
+				value = (*heater)->burnTime;
+			}
+		}
+
+		this->channelValues[i] = value;
+	}
+
+	this->channelLog.push(now, this->channelValues);
+	this->lastChannelLogTime = now;
+
+	if (this->brewLog.available())
+	{
+		// a stop and start within a second never shows up as a stopped run here
+		if (!this->brewLog.isOpen() || this->brewLog.id() != this->runStartTime)
+		{
+			this->openBrewLog(now);
+		}
+
+		if (!this->brewLog.append(now, this->channelValues))
+		{
+			ESP_LOGW(TAG, "Brew log block could not be written");
+		}
+
+		if (now - this->brewLog.lastFlushTime() >= BREWLOG_FLUSH_INTERVAL)
+		{
+			this->flushBrewLog();
+		}
+	}
+}
+
+void BrewEngine::openBrewLog(time_t now)
+{
+	this->brewLog.close();
+
+	this->pruneBrewLogs(BREWLOG_MIN_FREE);
+
+	json jHeader;
+	jHeader["version"] = 1;
+	jHeader["interval"] = CHANNEL_LOG_INTERVAL;
+	jHeader["tempScale"] = this->temperatureScale;
+	jHeader["boil"] = this->boilRun;
+	jHeader["pid"] = {
+		{"kP", this->boilRun ? this->boilkP : this->mashkP},
+		{"kI", this->boilRun ? this->boilkI : this->mashkI},
+		{"kD", this->boilRun ? this->boilkD : this->mashkD},
+		{"loopTime", this->pidLoopTime},
+	};
+
+	auto schedule = this->findMashSchedule(this->selectedMashScheduleName);
+	if (schedule.has_value())
+	{
+		jHeader["schedule"] = schedule->to_json();
+	}
+
+	// the run start is the id, so a log started a few seconds late still belongs to its run
+	time_t start = (this->runStartTime != 0) ? this->runStartTime : now;
+	bool opened = this->brewLog.open(start, jHeader, this->channelLog.channels());
+
+	// a resumed run whose sensors changed gets a log of its own
+	if (!opened && start != now)
+	{
+		start = now;
+		opened = this->brewLog.open(start, jHeader, this->channelLog.channels());
+		this->runStartTime = start;
+	}
+
+	if (!opened)
+	{
+		ESP_LOGW(TAG, "Unable to create brew log");
+		return;
+	}
+
+	ESP_LOGI(TAG, "Brew log %lld started", (long long)start);
+}
+
+void BrewEngine::flushBrewLog()
+{
+	if (this->brewLog.flush())
+	{
+		return;
+	}
+
+	// most likely full, the block is gone but the next ones get room
+	ESP_LOGW(TAG, "Brew log write failed, removing old logs");
+	this->pruneBrewLogs(BREWLOG_MIN_FREE);
+}
+
+// removes the oldest logs until needed bytes are free, never the open one
+void BrewEngine::pruneBrewLogs(size_t needed)
+{
+	size_t total = 0;
+	size_t used = 0;
+	if (esp_spiffs_info("brewlog", &total, &used) != ESP_OK)
+	{
+		return;
+	}
+
+	std::vector<time_t> ids;
+	this->brewLog.list([&ids](time_t id, size_t size)
+					   { ids.push_back(id); });
+
+	for (time_t id : ids)
+	{
+		if (used + needed <= total)
+		{
+			return;
+		}
+
+		if (this->brewLog.remove(id))
+		{
+			ESP_LOGI(TAG, "Removed brew log %lld to make room", (long long)id);
+			esp_spiffs_info("brewlog", &total, &used);
+		}
+	}
+}
+
 void BrewEngine::initMqtt()
 {
 	// return if no broker is configured
@@ -736,6 +1118,8 @@ void BrewEngine::initMqtt()
 	// we create a topic and just post all out data to runningLog, more complex configuration can follow in the future
 	this->mqttTopic = "esp-brew-engine/" + this->Hostname + "/history";
 	this->mqttTopicLog = "esp-brew-engine/" + this->Hostname + "/log";
+	this->mqttTopicNotification = "esp-brew-engine/" + this->Hostname + "/notification";
+	this->mqttTopicEta = "esp-brew-engine/" + this->Hostname + "/eta";
 	this->mqttEnabled = true;
 
 	ESP_LOGI(TAG, "initMqtt: Done");
@@ -848,7 +1232,12 @@ void BrewEngine::start()
 	// don't start if we are already running
 	if (!this->controlRun)
 	{
+		// before the run flag, so the read loop never logs into a half configured log
+		this->configureChannelLog();
+		this->runStartTime = time(0);
+
 		this->controlRun = true;
+		this->delayedStartRun = false;
 		this->inOverTime = false;
 		this->boostStatus = Off;
 		this->overrideTargetTemperature = std::nullopt;
@@ -856,17 +1245,17 @@ void BrewEngine::start()
 		this->tempLog.clear();
 
 		// also clear old steps
-		for (auto const &step : this->executionSteps)
-		{
-			delete step.second;
-		}
-		this->executionSteps.clear();
+		this->executionPlan.clear();
+		this->eta.clear();
+		this->lastPublishedEnd = 0;
+
+		// a new run replaces whatever was left from before a reboot
+		this->pendingResume = std::nullopt;
 
 		if (this->selectedMashScheduleName.empty() == false)
 		{
-			this->loadSchedule();
+			this->loadSchedule(std::chrono::system_clock::now(), this->temperature);
 			this->currentMashStep = 1; // 0 is current temp, so we can start at 1
-			xTaskCreate(&this->controlLoop, "controlloop_task", 4096, this, 5, NULL);
 		}
 		else
 		{
@@ -882,60 +1271,397 @@ void BrewEngine::start()
 			}
 		}
 
-		xTaskCreate(&this->pidLoop, "pidloop_task", 8192, this, 5, NULL);
-
-		xTaskCreate(&this->outputLoop, "outputloop_task", 4096, this, 5, NULL);
+		this->startRunTasks();
+	}
+}
 
-		this->statusText = "Running";
+void BrewEngine::startRunTasks()
+{
+	if (this->selectedMashScheduleName.empty() == false)
+	{
+		xTaskCreate(&this->controlLoop, "controlloop_task", 4096, this, 5, NULL);
 	}
+
+	xTaskCreate(&this->pidLoop, "pidloop_task", 8192, this, 5, NULL);
+
+	xTaskCreate(&this->outputLoop, "outputloop_task", 4096, this, 5, NULL);
+
+	this->statusText = "Running";
 }
 
-void BrewEngine::loadSchedule()
+void BrewEngine::readCheckpoint()
 {
-	auto pos = this->mashSchedules.find(this->selectedMashScheduleName);
+	vector<uint8_t> empty;
+	vector<uint8_t> serialized = this->settingsManager->Get(BrewSettings::checkpoint, empty);
 
-	if (pos == this->mashSchedules.end())
+	if (serialized.empty())
 	{
-		ESP_LOGE(TAG, "Program with name: %s not found!", this->selectedMashScheduleName.c_str());
 		return;
 	}
-	auto schedule = pos->second;
 
-	system_clock::time_point prevTime = std::chrono::system_clock::now();
+	json jCheckpoint = json::from_msgpack(serialized, true, false);
+	if (!jCheckpoint.is_object())
+	{
+		return;
+	}
+
+	try
+	{
+		RunCheckpoint checkpoint;
+		checkpoint.from_json(jCheckpoint);
+		this->pendingResume = checkpoint;
+		this->checkpointSaved = true;
+		ESP_LOGI(TAG, "Found a run that was interrupted at step %d", checkpoint.step);
+	}
+	catch (const json::exception &e)
+	{
+		ESP_LOGW(TAG, "Ignoring damaged checkpoint: %s", e.what());
+	}
+}
+
+RunCheckpoint BrewEngine::currentCheckpoint()
+{
+	RunCheckpoint checkpoint;
+	checkpoint.schedule = this->selectedMashScheduleName;
+	checkpoint.step = this->currentMashStep;
+	checkpoint.nextNotification = this->nextNotification;
+	checkpoint.inOverTime = this->inOverTime;
+	checkpoint.boostStatus = this->boostStatus;
+	checkpoint.overrideTargetTemperature = this->overrideTargetTemperature;
+	checkpoint.manualOverrideOutput = this->manualOverrideOutput;
+	checkpoint.boil = this->boilRun;
+	checkpoint.runStart = this->runStartTime;
+
+	if (!checkpoint.schedule.empty() && !this->executionPlan.empty())
+	{
+		const ExecutionStep &first = this->executionPlan.at(0);
+		checkpoint.planStart = system_clock::to_time_t(first.time);
+		checkpoint.startTemperature = first.temperature;
+
+		this->executionPlan.eachShift([&checkpoint](size_t fromIndex, seconds extra)
+									  { checkpoint.shifts.push_back({(uint16_t)fromIndex, (int32_t)extra.count()}); });
+	}
+	else
+	{
+		// the plan sets the target of a schedule, so it would only cause a write each step
+		checkpoint.targetTemperature = this->targetTemperature;
+	}
+
+	return checkpoint;
+}
+
+// called every second while running, but only writes when the run state changed or the last write is getting old
+void BrewEngine::saveCheckpoint(time_t now)
+{
+	RunCheckpoint checkpoint = this->currentCheckpoint();
+
+	if (this->checkpointSaved && checkpoint.sameState(this->lastCheckpoint) && now - this->lastCheckpoint.savedAt < CHECKPOINT_INTERVAL)
+	{
+		return;
+	}
+
+	auto schedule = this->findMashSchedule(checkpoint.schedule);
+	if (schedule.has_value() && schedule->temporary)
+	{
+		checkpoint.temporarySchedule = schedule->to_json();
+	}
+
+	checkpoint.savedAt = now;
+
+	// serialize to MessagePack for size
+	vector<uint8_t> serialized = json::to_msgpack(checkpoint.to_json());
+	this->settingsManager->Set(BrewSettings::checkpoint, serialized);
+
+	this->lastCheckpoint = checkpoint;
+	this->checkpointSaved = true;
+}
+
+void BrewEngine::clearCheckpoint()
+{
+	vector<uint8_t> empty;
+	this->settingsManager->Set(BrewSettings::checkpoint, empty);
+	this->checkpointSaved = false;
+}
+
+void BrewEngine::checkResume(time_t now)
+{
+	RunCheckpoint checkpoint = this->pendingResume.value();
+
+	// without a clock we can't tell how long we were down, so we wait for sntp
+	if (now < checkpoint.savedAt)
+	{
+		return;
+	}
+
+	this->pendingResume = std::nullopt;
+
+	// after a long outage it is safer to let the brewer decide
+	if (CONFIG_RESUME_MAX_DOWNTIME == 0 || now - checkpoint.savedAt > CONFIG_RESUME_MAX_DOWNTIME * 60)
+	{
+		ESP_LOGW(TAG, "Not resuming, down for %lld seconds", (long long)(now - checkpoint.savedAt));
+		this->clearCheckpoint();
+		return;
+	}
+
+	this->resume(checkpoint, now);
+}
+
+// picks up a run that was interrupted by a reboot, the time we were down is added as a shift so no step is cut short
+void BrewEngine::resume(const RunCheckpoint &checkpoint, time_t now)
+{
+	if (!checkpoint.schedule.empty() && !this->findMashSchedule(checkpoint.schedule).has_value())
+	{
+		if (checkpoint.temporarySchedule.is_null())
+		{
+			ESP_LOGW(TAG, "Can't resume, schedule %s is gone", checkpoint.schedule.c_str());
+			this->clearCheckpoint();
+			return;
+		}
+
+		this->setMashSchedule(checkpoint.temporarySchedule);
+	}
+
+	ESP_LOGI(TAG, "Resuming run after %lld seconds down", (long long)(now - checkpoint.savedAt));
+
+	this->configureChannelLog();
+	this->runStartTime = checkpoint.runStart;
+
+	this->selectedMashScheduleName = checkpoint.schedule;
+	this->controlRun = true;
+	this->delayedStartRun = false;
+	this->inOverTime = checkpoint.inOverTime;
+	this->boostStatus = (BoostStatus)checkpoint.boostStatus;
+	this->overrideTargetTemperature = checkpoint.overrideTargetTemperature;
+	this->manualOverrideOutput = checkpoint.manualOverrideOutput;
+	this->tempLog.clear();
+	this->executionPlan.clear();
+	this->eta.clear();
+	this->lastPublishedEnd = 0;
+
+	if (!checkpoint.schedule.empty())
+	{
+		this->loadSchedule(system_clock::from_time_t(checkpoint.planStart), checkpoint.startTemperature);
+
+		for (auto const &[fromIndex, extra] : checkpoint.shifts)
+		{
+			this->executionPlan.shift(fromIndex, seconds(extra));
+		}
+		this->executionPlan.shift(checkpoint.step, seconds(now - checkpoint.savedAt));
+
+		this->currentMashStep = checkpoint.step;
+		this->nextNotification = std::min<size_t>(checkpoint.nextNotification, this->notifications.size());
+		for (size_t i = 0; i < this->nextNotification; i++)
+		{
+			this->notifications[i].done = true;
+		}
+	}
+	else
+	{
+		this->targetTemperature = checkpoint.targetTemperature;
+		this->boilRun = checkpoint.boil;
+	}
+
+	this->startRunTasks();
+
+	this->logRemote("Resumed after reboot");
+}
+
+uint BrewEngine::mashWattage()
+{
+	uint totalWattage = 0;
+
+	for (auto const &heater : this->heaters)
+	{
+		if (heater->useForMash)
+		{
+			totalWattage += heater->watt;
+		}
+	}
+
+	return totalWattage;
+}
+
+float BrewEngine::availableHeatUpRate()
+{
+	uint totalMashWattage = this->mashWattage();
+
+	if (this->heatUpRate <= 0 || totalMashWattage == 0)
+	{
+		return 0;
+	}
+
+	// the rate is learned at full mash power, boil can use other heaters
+	uint availableWattage = 0;
+	for (auto const &heater : this->heaters)
+	{
+		if ((this->boilRun && heater->useForBoil) || (!this->boilRun && heater->useForMash))
+		{
+			availableWattage += heater->watt;
+		}
+	}
+
+	return this->heatUpRate * ((float)availableWattage / (float)totalMashWattage);
+}
+
+void BrewEngine::updateEta(system_clock::time_point now)
+{
+	this->eta.update(this->executionPlan, this->currentMashStep, now, this->temperature, this->availableHeatUpRate(), this->tempMargin);
+
+	if (!this->mqttEnabled)
+	{
+		return;
+	}
+
+	// we only publish when the end really moves, not every tick
+	time_t predictedEnd = system_clock::to_time_t(this->eta.endTime);
+	if (abs(predictedEnd - this->lastPublishedEnd) < 30)
+	{
+		return;
+	}
+
+	this->lastPublishedEnd = predictedEnd;
+
+	json jPayload = this->eta.to_json();
+	jPayload["time"] = this->to_iso_8601(now);
+	string payload = jPayload.dump();
+
+	esp_mqtt_client_publish(this->mqttClient, this->mqttTopicEta.c_str(), payload.c_str(), 0, 1, 1);
+}
+
+std::optional<system_clock::time_point> BrewEngine::calculateDelayedStart(system_clock::time_point readyBy, float volume)
+{
+	auto schedule = this->findMashSchedule(this->selectedMashScheduleName);
+
+	if (!schedule.has_value() || schedule->steps.empty())
+	{
+		return std::nullopt;
+	}
+
+	// no sensors means no prediction
+	if (std::isnan(this->temperature))
+	{
+		return std::nullopt;
+	}
+
+	// our own copy, sorting it leaves the schedule other tasks use alone
+	schedule->sort_steps();
+	const MashStep &firstStep = schedule->steps.front();
+
+	float degreesPerMinute = this->heatUpRate;
+
+	if (degreesPerMinute <= 0)
+	{
+		// nothing learned yet, estimate from wattage
+		degreesPerMinute = DelayedStart::estimatedRate(this->mashWattage(), volume);
+		if (degreesPerMinute <= 0)
+		{
+			return std::nullopt;
+		}
+
+		if (this->temperatureScale == Fahrenheit)
+		{
+			degreesPerMinute = degreesPerMinute * 1.8;
+		}
+	}
+
+	float heatUpMinutes = DelayedStart::heatUpMinutes(this->temperature, firstStep.temperature, degreesPerMinute, firstStep.stepTime);
+
+	ESP_LOGI(TAG, "Delayed Start: %.1f° to go at %.2f°/min takes %.0f min", std::max((float)firstStep.temperature - this->temperature, 0.0f), degreesPerMinute, heatUpMinutes);
+
+	return readyBy - seconds((int)(heatUpMinutes * 60));
+}
+
+void BrewEngine::delayedStartLoop(void *arg)
+{
+	BrewEngine *instance = (BrewEngine *)arg;
+	TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+	// nothing to control while waiting, so let the radio sleep between beacons
+	esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+
+	// a stop and a new StartAt while we sleep replace the handle, this task then ends without starting
+	while (instance->run && instance->delayedStartRun && instance->delayedStartHandle == self)
+	{
+		// water cools down while we wait, so keep the start time up to date
+		if (instance->delayedReadyBy.has_value())
+		{
+			auto startTime = instance->calculateDelayedStart(instance->delayedReadyBy.value(), instance->delayedStartVolume);
+
+			if (startTime.has_value())
+			{
+				instance->delayedStartTime = startTime.value();
+			}
+		}
+
+		if (std::chrono::system_clock::now() >= instance->delayedStartTime)
+		{
+			break;
+		}
+
+		vTaskDelay(pdMS_TO_TICKS(10000));
+	}
+
+	if (instance->delayedStartHandle != self)
+	{
+		ESP_LOGI(TAG, "Delayed Start: Replaced by a newer one");
+		vTaskDelete(NULL);
+		return;
+	}
+
+	esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+
+	// could be cancelled by stop
+	if (instance->run && instance->delayedStartRun)
+	{
+		ESP_LOGI(TAG, "Delayed Start: Starting");
+		instance->logRemote("Delayed Start");
+		instance->delayedStartRun = false;
+		instance->start();
+	}
+
+	instance->delayedStartHandle = NULL;
+	vTaskDelete(NULL);
+}
+
+// plan from startTime on, starting at startTemperature
+void BrewEngine::loadSchedule(system_clock::time_point startTime, float startTemperature)
+{
+	auto schedule = this->findMashSchedule(this->selectedMashScheduleName);
 
-	for (auto const &step : this->executionSteps)
+	if (!schedule.has_value())
 	{
-		delete step.second;
+		ESP_LOGE(TAG, "Program with name: %s not found!", this->selectedMashScheduleName.c_str());
+		return;
 	}
-	this->executionSteps.clear();
+
+	system_clock::time_point prevTime = startTime;
+
+	this->executionPlan.clear();
 
 	this->currentExecutionStep = 0;
 	this->boilRun = schedule->boil;
-	int stepIndex = 0;
 
-	float prevTemp = this->temperature;
+	float prevTemp = startTemperature;
 	// insert the current as starting point
-	auto execStep0 = new ExecutionStep();
-	execStep0->time = prevTime;
-	execStep0->temperature = prevTemp;
-	execStep0->extendIfNeeded = false;
-	this->executionSteps.insert(std::make_pair(stepIndex, execStep0));
+	ExecutionStep execStep0;
+	execStep0.time = prevTime;
+	execStep0.temperature = prevTemp;
+	execStep0.extendIfNeeded = false;
+	this->executionPlan.push_back(execStep0);
 
 	string iso_string = this->to_iso_8601(prevTime);
-	ESP_LOGI(TAG, "Time:%s, Temp:%f Extend:%d", iso_string.c_str(), prevTemp, execStep0->extendIfNeeded);
+	ESP_LOGI(TAG, "Time:%s, Temp:%f Extend:%d", iso_string.c_str(), prevTemp, execStep0.extendIfNeeded);
 
 	int extendNotifications = 0;
 
-	stepIndex++;
-
 	for (auto const &step : schedule->steps)
 	{
 		// a step can actualy be 2 different executions, 1 step time that needs substeps calcualted, and one fixed
 
-		if (step->stepTime > 0 || step->extendStepTimeIfNeeded)
+		if (step.stepTime > 0 || step.extendStepTimeIfNeeded)
 		{
 
-			int stepTime = step->stepTime;
+			int stepTime = step.stepTime;
 
 			// when the users request step extended, we need a step so 0 isn't valid we default to 1 min
 			if (stepTime == 0)
@@ -949,7 +1675,7 @@ void BrewEngine::loadSchedule()
 			int subStepsInStep;
 
 			// When boost mode is active we don't want substeps this only complicates things
-			if (step->allowBoost && this->boostModeUntil > 0)
+			if (step.allowBoost && this->boostModeUntil > 0)
 			{
 				subStepsInStep = 1;
 			}
@@ -965,7 +1691,7 @@ void BrewEngine::loadSchedule()
 				}
 			}
 
-			float tempDiffPerStep = (step->temperature - prevTemp) / (float)subStepsInStep;
+			float tempDiffPerStep = (step.temperature - prevTemp) / (float)subStepsInStep;
 
 			float prevStepTemp = 0;
 
@@ -977,24 +1703,24 @@ void BrewEngine::loadSchedule()
 				float subStepTemp = prevTemp + (tempDiffPerStep * ((float)j + 1));
 
 				// insert the current as starting point
-				auto execStep = new ExecutionStep();
-				execStep->time = executionStepTime;
-				execStep->temperature = subStepTemp;
-				execStep->extendIfNeeded = false;
+				ExecutionStep execStep;
+				execStep.time = executionStepTime;
+				execStep.temperature = subStepTemp;
+				execStep.extendIfNeeded = false;
 
-				if (step->allowBoost && this->boostModeUntil > 0)
+				if (step.allowBoost && this->boostModeUntil > 0)
 				{
-					execStep->allowBoost = true;
+					execStep.allowBoost = true;
 				}
 				else
 				{
-					execStep->allowBoost = false;
+					execStep.allowBoost = false;
 				}
 
 				// set extend if needed on last step if configured
-				if (j == (subStepsInStep - 1) && step->extendStepTimeIfNeeded)
+				if (j == (subStepsInStep - 1) && step.extendStepTimeIfNeeded)
 				{
-					execStep->extendIfNeeded = true;
+					execStep.extendIfNeeded = true;
 				}
 
 				float diff = abs(subStepTemp - prevStepTemp);
@@ -1003,14 +1729,13 @@ void BrewEngine::loadSchedule()
 				// only insert if difference or if last step more then 1 degree
 				if (diff > 1 || (j == subStepsInStep - 1))
 				{
-					this->executionSteps.insert(std::make_pair(stepIndex, execStep));
-					prevStepTemp = execStep->temperature;
-					stepIndex++;
+					this->executionPlan.push_back(execStep);
+					prevStepTemp = execStep.temperature;
 
 					// Convert the time_point to an ISO 8601 string
 					string iso_string = this->to_iso_8601(executionStepTime);
 
-					ESP_LOGI(TAG, "Time:%s, Temp:%f Extend:%d", iso_string.c_str(), subStepTemp, execStep->extendIfNeeded);
+					ESP_LOGI(TAG, "Time:%s, Temp:%f Extend:%d", iso_string.c_str(), subStepTemp, execStep.extendIfNeeded);
 				}
 			}
 
@@ -1023,63 +1748,58 @@ void BrewEngine::loadSchedule()
 			auto stepEndTime = prevTime + seconds(10);
 
 			// go directly to temp
-			auto execStep = new ExecutionStep();
-			execStep->time = stepEndTime;
-			execStep->temperature = (float)step->temperature;
-			execStep->extendIfNeeded = step->extendStepTimeIfNeeded;
-
-			this->executionSteps.insert(std::make_pair(stepIndex, execStep));
+			ExecutionStep execStep;
+			execStep.time = stepEndTime;
+			execStep.temperature = (float)step.temperature;
+			execStep.extendIfNeeded = step.extendStepTimeIfNeeded;
 
-			stepIndex++;
+			this->executionPlan.push_back(execStep);
 
 			// Convert the time_point to an ISO 8601 string
 			string iso_string = this->to_iso_8601(prevTime);
 
-			ESP_LOGI(TAG, "Time:%s, Temp:%f Extend:%d", iso_string.c_str(), (float)step->temperature, execStep->extendIfNeeded);
+			ESP_LOGI(TAG, "Time:%s, Temp:%f Extend:%d", iso_string.c_str(), (float)step.temperature, execStep.extendIfNeeded);
 
 			prevTime = stepEndTime;
-			prevTemp = (float)step->temperature;
+			prevTemp = (float)step.temperature;
 		}
 
 		// for the hold time we just need add one point
-		auto holdEndTime = prevTime + minutes(step->time);
+		auto holdEndTime = prevTime + minutes(step.time);
 
-		auto holdStep = new ExecutionStep();
-		holdStep->time = holdEndTime;
-		holdStep->temperature = (float)step->temperature;
-		holdStep->extendIfNeeded = false;
+		ExecutionStep holdStep;
+		holdStep.time = holdEndTime;
+		holdStep.temperature = (float)step.temperature;
+		holdStep.extendIfNeeded = false;
 
-		this->executionSteps.insert(std::make_pair(stepIndex, holdStep));
-		stepIndex++;
+		this->executionPlan.push_back(holdStep);
 
 		prevTime = holdEndTime;
-		prevTemp = step->temperature; // is normaly the same but this could change in futrure
+		prevTemp = step.temperature; // is normaly the same but this could change in futrure
 
 		string iso_string2 = this->to_iso_8601(holdEndTime);
-		ESP_LOGI(TAG, "Hold Time:%s, Temp:%f ", iso_string2.c_str(), (float)step->temperature);
+		ESP_LOGI(TAG, "Hold Time:%s, Temp:%f ", iso_string2.c_str(), (float)step.temperature);
 	}
 
-	// also add notifications
-	for (auto const &notification : this->notifications)
-	{
-		delete notification;
-	}
+	// also add notifications, the capacity is kept between runs
 	this->notifications.clear();
+	this->notifications.reserve(schedule->notifications.size());
+	this->nextNotification = 0;
 
 	for (auto const &notification : schedule->notifications)
 	{
-		auto notificationTime = execStep0->time + minutes(notification->timeFromStart) + seconds(extendNotifications);
+		auto notificationTime = execStep0.time + minutes(notification.timeFromStart) + seconds(extendNotifications);
 
-		// copy notification to new map
-		auto newNotification = new Notification();
-		newNotification->name = notification->name;
-		newNotification->message = notification->message;
-		newNotification->timeFromStart = notification->timeFromStart + (extendNotifications / 60); // in minutes
-		newNotification->timePoint = notificationTime;
-
-		this->notifications.push_back(newNotification);
+		// copy notification to the running ones
+		Notification &newNotification = this->notifications.emplace_back(notification);
+		newNotification.timeFromStart = notification.timeFromStart + (extendNotifications / 60); // in minutes
+		newNotification.timePoint = notificationTime;
+		newNotification.done = false;
 	}
 
+	// a new plan, earlier shifts mean nothing anymore
+	this->scheduleShifts.clear();
+
 	// increate version so client can follow changes
 	this->runningVersion++;
 }
@@ -1088,59 +1808,52 @@ void BrewEngine::recalculateScheduleAfterOverTime()
 {
 	ESP_LOGI(TAG, "Recalculate Schedule after OverTime");
 
-	int currentStepIndex = this->currentMashStep;
+	size_t currentStepIndex = this->currentMashStep;
 
-	auto currentPos = this->executionSteps.find(currentStepIndex);
-
-	if (currentPos == this->executionSteps.end())
+	if (currentStepIndex >= this->executionPlan.size())
 	{
 		ESP_LOGE(TAG, "Steps not availible anymore");
 		this->stop();
 		return;
 	}
 
-	auto currentStep = currentPos->second;
-	system_clock::time_point plannedEnd = currentStep->time;
+	system_clock::time_point plannedEnd = this->executionPlan.timeOf(currentStepIndex);
 
 	system_clock::time_point now = std::chrono::system_clock::now();
-	auto extraSeconds = chrono::duration_cast<chrono::seconds>(now - plannedEnd).count();
+	auto extraSeconds = chrono::duration_cast<chrono::seconds>(now - plannedEnd);
 
-	for (auto it = currentPos; it != this->executionSteps.end(); ++it)
-	{
-		auto step = it->second;
-		auto newTime = step->time + seconds(extraSeconds);
+	// the current and all following steps and notifications move with the same offset, so we only need to record it once
+	this->executionPlan.shift(currentStepIndex, extraSeconds);
 
-		string iso_string = this->to_iso_8601(step->time);
-		string iso_string2 = this->to_iso_8601(newTime);
+	string iso_string = this->to_iso_8601(plannedEnd);
+	string iso_string2 = this->to_iso_8601(plannedEnd + extraSeconds);
 
-		ESP_LOGI(TAG, "Time Changend From: %s, To:%s ", iso_string.c_str(), iso_string2.c_str());
+	ESP_LOGI(TAG, "Time Changend From: %s, To:%s, Total Offset: %lld", iso_string.c_str(), iso_string2.c_str(), (long long)this->executionPlan.offset().count());
 
-		step->time = newTime;
-	}
+	// increate version so client can follow changes
+	this->runningVersion++;
 
-	// also increase notifications
-	for (auto &notification : this->notifications)
+	this->scheduleShifts.push_back({this->runningVersion, currentStepIndex, extraSeconds});
+	if (this->scheduleShifts.size() > SCHEDULE_SHIFT_HISTORY)
 	{
-		auto newTime = notification->timePoint + seconds(extraSeconds);
-
-		string iso_string = this->to_iso_8601(notification->timePoint);
-		string iso_string2 = this->to_iso_8601(newTime);
-
-		ESP_LOGI(TAG, "Notification Time Changend From: %s, To:%s ", iso_string.c_str(), iso_string2.c_str());
-
-		notification->timePoint = newTime;
+		this->scheduleShifts.pop_front();
 	}
-
-	// increate version so client can follow changes
-	this->runningVersion++;
 }
 
 void BrewEngine::stop()
 {
 	this->controlRun = false;
+	this->delayedStartRun = false;
 	this->boostStatus = Off;
 	this->inOverTime = false;
 	this->statusText = "Idle";
+
+	if (this->heatUpRateDirty)
+	{
+		this->settingsManager->Set(BrewSettings::heatUpRate, std::clamp(this->heatUpRate, BrewSettings::heatUpRate.min, BrewSettings::heatUpRate.max));
+		this->settingsManager->Commit();
+		this->heatUpRateDirty = false;
+	}
 }
 
 void BrewEngine::startStir(const json &stirConfig)
@@ -1245,8 +1958,6 @@ void BrewEngine::readLoop(void *arg)
 {
 	BrewEngine *instance = (BrewEngine *)arg;
 
-	int it = 0;
-
 	while (instance->run)
 	{
 		vTaskDelay(pdMS_TO_TICKS(1000));
@@ -1257,6 +1968,8 @@ void BrewEngine::readLoop(void *arg)
 			continue;
 		}
 
+		int64_t readStart = esp_timer_get_time();
+
 		int nrOfSensors = 0;
 		float sum = 0.0;
 
@@ -1277,6 +1990,7 @@ void BrewEngine::readLoop(void *arg)
 			if (err != ESP_OK)
 			{
 				ESP_LOGW(TAG, "Error Reading from [%s], disabling sensor!", stringId.c_str());
+				sensor->errorCount++;
 				sensor->connected = false;
 				sensor->lastTemp = 0;
 				instance->currentTemperatures.erase(key);
@@ -1288,6 +2002,7 @@ void BrewEngine::readLoop(void *arg)
 			if (err != ESP_OK)
 			{
 				ESP_LOGW(TAG, "Error Reading from [%s], disabling sensor!", stringId.c_str());
+				sensor->errorCount++;
 				sensor->connected = false;
 				sensor->lastTemp = 0;
 				instance->currentTemperatures.erase(key);
@@ -1327,6 +2042,8 @@ void BrewEngine::readLoop(void *arg)
 			}
 		}
 
+		instance->readLoopTimes.record((float)(esp_timer_get_time() - readStart) / 1000000);
+
 		float avg = sum / nrOfSensors;
 
 		ESP_LOGD(TAG, "Avg Temperature: %.2f°", avg);
@@ -1336,36 +2053,31 @@ void BrewEngine::readLoop(void *arg)
 		// when controlrun is true we need to keep out data
 		if (instance->controlRun)
 		{
-			// we don't have that much ram so we log only every 5 cycles
-
-			it++;
-			if (it > 5)
+			// every cycle, older parts of the history are downsampled so it fits in ram
+			// we log in tenths of a degree, nothing new when that didn't change
+			if (instance->tempLog.empty() || TemperatureHistory::toTenths(instance->tempLog.back().temperature) != TemperatureHistory::toTenths(avg))
 			{
-				it = 0;
-				int lastTemp = 0;
+				// decided agains chrono just make it a hell lot more complex
+				time_t current_raw_time = time(0);
+				// System time: number of seconds since 00:00,
+				instance->tempLog.push(current_raw_time, avg);
 
-				if (!instance->tempLog.empty())
-				{
-					auto lastValue = instance->tempLog.rbegin();
-					lastTemp = lastValue->second;
-				}
-
-				if (lastTemp != (int)avg)
-				{
-					// decided agains chrono just make it a hell lot more complex
-					// instance->tempLog.insert(std::make_pair(std::chrono::system_clock::now(), (int)avg));
-					time_t current_raw_time = time(0);
-					// System time: number of seconds since 00:00,
-					instance->tempLog.insert(std::make_pair(current_raw_time, (int)avg));
+				ESP_LOGD(TAG, "Logging: %.1f°", avg);
+			}
+			else
+			{
+				ESP_LOGD(TAG, "Skip same");
+			}
 
-					ESP_LOGI(TAG, "Logging: %d°", (int)avg);
-				}
-				else
-				{
-					ESP_LOGI(TAG, "Skip same");
-				}
+			// the channels change less and there are more of them, so they are sampled at a fixed interval
+			time_t now = time(0);
+			if (now - instance->lastChannelLogTime >= CHANNEL_LOG_INTERVAL)
+			{
+				instance->logChannels(now);
 			}
 
+			instance->saveCheckpoint(now);
+
 			if (instance->mqttEnabled)
 			{
 				string iso_datetime = to_iso_8601(std::chrono::system_clock::now());
@@ -1379,6 +2091,27 @@ void BrewEngine::readLoop(void *arg)
 				esp_mqtt_client_publish(instance->mqttClient, instance->mqttTopic.c_str(), payload.c_str(), 0, 1, 1);
 			}
 		}
+		else
+		{
+			if (instance->brewLog.isOpen())
+			{
+				// run stopped, write what is left
+				instance->brewLog.close();
+			}
+
+			// a stopped run must not come back after a reboot
+			if (instance->checkpointSaved && !instance->pendingResume.has_value())
+			{
+				instance->clearCheckpoint();
+			}
+
+			if (instance->pendingResume.has_value())
+			{
+				instance->checkResume(time(0));
+			}
+		}
+
+		instance->pushTelemetry();
 	}
 
 	vTaskDelete(NULL);
@@ -1431,9 +2164,14 @@ void BrewEngine::pidLoop(void *arg)
 
 	while (instance->run && instance->controlRun)
 	{
+		float loopStartTemperature = instance->temperature;
+
 		// Output is %
 		int outputPercent = (int)pid.getOutput((double)instance->temperature, (double)instance->targetTemperature);
 		instance->pidOutput = outputPercent;
+		instance->pidP = pid.lastP;
+		instance->pidI = pid.lastI;
+		instance->pidD = pid.lastD;
 		ESP_LOGI(TAG, "Pid Output: %d Target: %f", instance->pidOutput, instance->targetTemperature);
 
 		// Manual override and boost
@@ -1492,7 +2230,8 @@ void BrewEngine::pidLoop(void *arg)
 		}
 
 		// we keep going for the desired pidlooptime and set the burn by percent
-		for (int i = 0; i < instance->pidLoopTime; i++)
+		int i = 0;
+		for (; i < instance->pidLoopTime; i++)
 		{
 			if (!instance->run || !instance->controlRun)
 			{
@@ -1541,6 +2280,19 @@ void BrewEngine::pidLoop(void *arg)
 
 			vTaskDelay(pdMS_TO_TICKS(1000));
 		}
+
+		// a full loop at full mash power tells us how fast we heat up, used to plan delayed starts
+		if (!instance->boilRun && outputPercent >= 100 && i >= 30 && i == instance->pidLoopTime)
+		{
+			float rate = (instance->temperature - loopStartTemperature) / ((float)i / 60);
+
+			if (rate > 0)
+			{
+				instance->heatUpRate = (instance->heatUpRate > 0) ? (instance->heatUpRate * 0.7) + (rate * 0.3) : rate;
+				instance->heatUpRateDirty = true;
+				ESP_LOGI(TAG, "Heat Up Rate: %.2f°/min", instance->heatUpRate);
+			}
+		}
 	}
 
 	instance->pidOutput = 0;
@@ -1567,6 +2319,7 @@ void BrewEngine::outputLoop(void *arg)
 			{
 				ESP_LOGD(TAG, "Output %s: On", heater->name.c_str());
 				gpio_set_level(heater->pinNr, instance->gpioHigh);
+				heater->energy += heater->watt; // on for a second
 			}
 			else
 			{
@@ -1601,13 +2354,13 @@ void BrewEngine::controlLoop(void *arg)
 
 		system_clock::time_point now = std::chrono::system_clock::now();
 
-		if (instance->executionSteps.size() >= instance->currentMashStep)
+		if (instance->currentMashStep < instance->executionPlan.size())
 		{ // there are more steps
-			int nextStepIndex = instance->currentMashStep;
+			size_t nextStepIndex = instance->currentMashStep;
 
-			auto nextStep = instance->executionSteps.at(nextStepIndex);
+			const ExecutionStep *nextStep = &instance->executionPlan.at(nextStepIndex);
 
-			system_clock::time_point nextAction = nextStep->time;
+			system_clock::time_point nextAction = instance->executionPlan.timeOf(nextStepIndex);
 
 			bool gotoNextStep = false;
 
@@ -1713,30 +2466,12 @@ void BrewEngine::controlLoop(void *arg)
 			}
 
 			// notifications, but only when not in overtime
-			if (!instance->inOverTime && !instance->notifications.empty())
+			if (!instance->inOverTime)
 			{
-				// filter out items that are not done
-				auto isNotDone = [](Notification *notification)
-				{ return notification->done == false; };
-
-				auto notDone = instance->notifications | views::filter(isNotDone);
-
-				if (!notDone.empty())
-				{
-					// they are sorted so we just have to check the first one
-					auto first = notDone.front();
-
-					if (now > first->timePoint)
-					{
-						ESP_LOGI(TAG, "Notify %s", first->name.c_str());
-
-						string buzzerName = "buzzer" + first->name;
-						xTaskCreate(&instance->buzzer, buzzerName.c_str(), 1024, instance, 10, NULL);
-
-						first->done = true;
-					}
-				}
+				instance->processNotifications(now);
 			}
+
+			instance->updateEta(now);
 		}
 		else
 		{
@@ -1780,566 +2515,1894 @@ void BrewEngine::reboot(void *arg)
 	esp_restart();
 }
 
-void BrewEngine::buzzer(void *arg)
+void BrewEngine::processNotifications(system_clock::time_point now)
 {
-	BrewEngine *instance = (BrewEngine *)arg;
-
-	if (instance->buzzer_PIN > 0)
+	// they are sorted so we just have to check the next one
+	if (this->nextNotification >= this->notifications.size())
 	{
-		auto buzzerMs = instance->buzzerTime * 1000;
-		gpio_set_level(instance->buzzer_PIN, instance->gpioHigh);
-		vTaskDelay(buzzerMs / portTICK_PERIOD_MS);
-		gpio_set_level(instance->buzzer_PIN, instance->gpioLow);
+		return;
 	}
 
-	vTaskDelete(NULL);
-}
-
-string BrewEngine::processCommand(const string &payLoad)
-{
-	ESP_LOGD(TAG, "payLoad %s", payLoad.c_str());
-
-	json jCommand = json::parse(payLoad);
-	string command = jCommand["command"];
-	json data = jCommand["data"];
+	auto offset = this->executionPlan.offset();
 
-	ESP_LOGD(TAG, "processCommand %s", command.c_str());
-	ESP_LOGD(TAG, "data %s", data.dump().c_str());
+	if (now <= this->notifications[this->nextNotification].timePoint + offset)
+	{
+		return;
+	}
 
-	json resultData = {};
-	string message = "";
-	bool success = true;
+	// everything that is due now goes out as one event, so we don't buzz multiple times for the same moment
+	auto event = new NotificationEvent();
+	event->time = now;
 
-	if (command == "Data")
+	while (this->nextNotification < this->notifications.size())
 	{
-		time_t lastLogDateTime = time(0);
+		Notification &notification = this->notifications[this->nextNotification];
 
-		json jTempLog = json::array({});
-		if (!this->tempLog.empty())
+		if (now <= notification.timePoint + offset)
 		{
-			auto lastLog = this->tempLog.rend();
-			lastLogDateTime = lastLog->first;
+			break;
+		}
 
-			// If we have a last date we only need to send the log increment
-			if (!data["lastDate"].is_null() && data["lastDate"].is_number())
-			{
-				time_t lastClientDate = (time_t)data["lastDate"];
-				ESP_LOGD(TAG, "lastClientDate %s", ctime(&lastClientDate));
+		ESP_LOGI(TAG, "Notify %s", notification.name.c_str());
 
-				// most efficient seems to loop reverse and add until date is reached
-				for (auto iter = this->tempLog.rbegin(); iter != this->tempLog.rend(); ++iter)
-				{
-					if (iter->first > lastClientDate)
-					{
-						json jTempLogItem;
-						jTempLogItem["time"] = iter->first;
-						jTempLogItem["temp"] = iter->second;
-						jTempLog.push_back(jTempLogItem);
-					}
-					else
-					{
-						break;
-					}
-				}
+		notification.done = true;
+		event->buzzer = event->buzzer || notification.buzzer;
+		event->notifications.push_back(notification);
+
+		this->nextNotification++;
+	}
+
+	if (xQueueSend(this->notificationQueue, &event, 0) != pdTRUE)
+	{
+		ESP_LOGW(TAG, "Notification queue full, dropping notification");
+		delete event;
+	}
+}
+
+void BrewEngine::notificationLoop(void *arg)
+{
+	BrewEngine *instance = (BrewEngine *)arg;
+
+	NotificationEvent *event;
+
+	while (instance->run)
+	{
+		if (xQueueReceive(instance->notificationQueue, &event, portMAX_DELAY) != pdTRUE)
+		{
+			continue;
+		}
+
+		// remote first, the buzzer blocks for buzzerTime
+		if (instance->mqttEnabled)
+		{
+			string payload = event->to_json().dump();
+			esp_mqtt_client_publish(instance->mqttClient, instance->mqttTopicNotification.c_str(), payload.c_str(), 0, 1, 0);
+		}
+
+		if (event->buzzer && instance->buzzer_PIN > 0)
+		{
+			auto buzzerMs = instance->buzzerTime * 1000;
+			gpio_set_level(instance->buzzer_PIN, instance->gpioHigh);
+			vTaskDelay(buzzerMs / portTICK_PERIOD_MS);
+			gpio_set_level(instance->buzzer_PIN, instance->gpioLow);
+		}
+
+		delete event;
+	}
+
+	vTaskDelete(NULL);
+}
+
+void BrewEngine::jobLoop(void *arg)
+{
+	BrewEngine *instance = (BrewEngine *)arg;
+
+	CommandJob *job;
+
+	while (instance->run)
+	{
+		if (xQueueReceive(instance->jobQueue, &job, portMAX_DELAY) != pdTRUE)
+		{
+			continue;
+		}
+
+		ESP_LOGI(TAG, "Running job %d: %.*s", job->id, (int)job->command->name.size(), job->command->name.data());
+
+		(instance->*(job->command->handler))(job->data, job->result);
+
+		job->done = true;
+	}
+
+	vTaskDelete(NULL);
+}
+
+CommandResult BrewEngine::processCommand(json &jCommand)
+{
+	if (!jCommand.is_object() || !jCommand["command"].is_string())
+	{
+		CommandResult result;
+		result.message = "Invalid command";
+		result.success = false;
+		return result;
+	}
+
+	string command = jCommand["command"];
+	json data = std::move(jCommand["data"]); // big payloads like schedules should only exist once
+
+	return this->runCommand(command, data);
+}
+
+CommandResult BrewEngine::runCommand(const string &command, json &data)
+{
+	ESP_LOGD(TAG, "processCommand %s", command.c_str());
+	ESP_LOGD(TAG, "data %s", data.dump().c_str());
+
+	CommandResult result;
+
+	const Command *found = findCommand(command);
+
+	if (found == nullptr)
+	{
+		result.message = "Unknown command: " + command;
+		result.success = false;
+	}
+	else if (found->job)
+	{
+		// finished jobs make room for new ones, the oldest first
+		while (this->jobs.size() >= API_JOB_HISTORY && this->jobs.front()->done)
+		{
+			delete this->jobs.front();
+			this->jobs.pop_front();
+		}
+
+		CommandJob *job = new CommandJob();
+		job->id = ++this->lastJobId;
+		job->command = found;
+		job->data = std::move(data);
+
+		if (this->jobs.size() >= API_JOB_HISTORY || xQueueSend(this->jobQueue, &job, 0) != pdTRUE)
+		{
+			delete job;
+			result.message = "Too many jobs running, try again later";
+			result.success = false;
+			return result;
+		}
+
+		this->jobs.push_back(job);
+		result.jobId = job->id;
+	}
+	else
+	{
+		(this->*(found->handler))(data, result);
+	}
+
+	return result;
+}
+
+const BrewEngine::Command *BrewEngine::findCommand(std::string_view name)
+{
+	// keep this sorted on name, we look it up with a binary search
+	static constexpr CommandTable<Command, 37> commands({{
+		{"BootIntoRecovery", &BrewEngine::handleBootIntoRecovery},
+		{"Data", &BrewEngine::handleData},
+		{"DeleteBrewLog", &BrewEngine::handleDeleteBrewLog},
+		{"DeleteMashSchedule", &BrewEngine::handleDeleteMashSchedule},
+		{"DetectTempSensors", &BrewEngine::handleDetectTempSensors}, // changes the sensors map other handlers read, so it stays on the httpd task
+		{"FactoryReset", &BrewEngine::handleFactoryReset},
+		{"GetBrewLog", &BrewEngine::handleGetBrewLog},
+		{"GetBrewLogs", &BrewEngine::handleGetBrewLogs},
+		{"GetChannelHistory", &BrewEngine::handleGetChannelHistory},
+		{"GetHeaterSettings", &BrewEngine::handleGetHeaterSettings},
+		{"GetHistory", &BrewEngine::handleGetHistory},
+		{"GetHistoryChannels", &BrewEngine::handleGetHistoryChannels},
+		{"GetJob", &BrewEngine::handleGetJob},
+		{"GetMashSchedules", &BrewEngine::handleGetMashSchedules},
+		{"GetPIDSettings", &BrewEngine::handleGetPIDSettings},
+		{"GetRunningSchedule", &BrewEngine::handleGetRunningSchedule},
+		{"GetSystemSettings", &BrewEngine::handleGetSystemSettings},
+		{"GetTempSettings", &BrewEngine::handleGetTempSettings},
+		{"GetWifiSettings", &BrewEngine::handleGetWifiSettings},
+		{"ReadyBy", &BrewEngine::handleReadyBy},
+		{"Reboot", &BrewEngine::handleReboot},
+		{"SaveHeaterSettings", &BrewEngine::handleSaveHeaterSettings},
+		{"SaveHistoryChannels", &BrewEngine::handleSaveHistoryChannels},
+		{"SaveMashSchedule", &BrewEngine::handleSaveMashSchedule},
+		{"SavePIDSettings", &BrewEngine::handleSavePIDSettings},
+		{"SaveSystemSettings", &BrewEngine::handleSaveSystemSettings},
+		{"SaveTempSettings", &BrewEngine::handleSaveTempSettings},
+		{"SaveWifiSettings", &BrewEngine::handleSaveWifiSettings},
+		{"ScanWifi", &BrewEngine::handleScanWifi, true},
+		{"SetMashSchedule", &BrewEngine::handleSetMashSchedule},
+		{"SetOverrideOutput", &BrewEngine::handleSetOverrideOutput},
+		{"SetTemp", &BrewEngine::handleSetTemp},
+		{"Start", &BrewEngine::handleStart},
+		{"StartAt", &BrewEngine::handleStartAt},
+		{"StartStir", &BrewEngine::handleStartStir},
+		{"Stop", &BrewEngine::handleStop},
+		{"StopStir", &BrewEngine::handleStopStir},
+	}});
+
+	return commands.find(name);
+}
+
+void BrewEngine::handleData(json &data, CommandResult &result)
+{
+	// If we have a last date we only need to send the log increment
+	std::optional<time_t> lastClientDate = std::nullopt;
+	if (!data["lastDate"].is_null() && data["lastDate"].is_number())
+	{
+		lastClientDate = (time_t)data["lastDate"];
+		ESP_LOGD(TAG, "lastClientDate %s", ctime(&lastClientDate.value()));
+	}
+
+	// the log can get long, so we stream it instead of building it up in memory
+	result.writeData = [this, lastClientDate](JsonWriter &writer)
+	{
+		time_t lastLogDateTime = time(0);
+		if (!this->tempLog.empty())
+		{
+			lastLogDateTime = this->tempLog.back().time;
+		}
+
+		writer.beginObject();
+
+		this->writeTelemetryState(writer);
+
+		writer.key("lastLogDateTime");
+		writer.value(lastLogDateTime);
+
+		writer.key("tempLog");
+		writer.beginArray();
+
+		// from where the client left off, a long history comes from a downsampled tier
+		time_t from = lastClientDate.has_value() ? lastClientDate.value() + 1 : 0;
+
+		this->tempLog.query(from, std::numeric_limits<time_t>::max(), HISTORY_MAX_POINTS, [&writer](const TieredHistory::Sample &sample)
+							{
+			writer.beginObject();
+			writer.key("time");
+			writer.value(sample.time);
+			writer.key("temp");
+			writer.value(sample.temperature);
+			writer.endObject(); });
+
+		writer.endArray();
+		writer.endObject();
+	};
+}
+
+json BrewEngine::telemetryState()
+{
+	json jState;
+	JsonWriter writer(jState);
+
+	writer.beginObject();
+	this->writeTelemetryState(writer);
+	writer.endObject();
+
+	return jState;
+}
+
+// the state fields without the surrounding object, so Data can stream them with the log after them
+void BrewEngine::writeTelemetryState(JsonWriter &writer)
+{
+	writer.key("temp");
+	writer.value((double)((int)(this->temperature * 10)) / 10); // round float to 1 digit for display
+
+	// currenttemps is an array of current temps, they are not necessarily all used for control
+	writer.key("temps");
+	writer.beginArray();
+	for (auto const &[key, val] : this->currentTemperatures)
+	{
+		writer.beginObject();
+		writer.key("sensor");
+		writer.value(to_string(key)); // js doesn't support unint64
+		writer.key("temp");
+		writer.value((double)((int)(val * 10)) / 10); // round float to 1 digit for display
+		writer.endObject();
+	}
+	writer.endArray();
+
+	writer.key("targetTemp");
+	writer.value((double)((int)(this->targetTemperature * 10)) / 10); // round float to 1 digit for display
+
+	writer.key("manualOverrideTargetTemp");
+	if (this->overrideTargetTemperature.has_value())
+	{
+		writer.value(this->overrideTargetTemperature.value());
+	}
+	else
+	{
+		writer.null();
+	}
+
+	writer.key("output");
+	writer.value(this->pidOutput);
+
+	writer.key("manualOverrideOutput");
+	if (this->manualOverrideOutput.has_value())
+	{
+		writer.value(this->manualOverrideOutput.value());
+	}
+	else
+	{
+		writer.null();
+	}
+
+	writer.key("status");
+	writer.value(this->statusText);
+
+	writer.key("stirStatus");
+	writer.value(this->stirStatusText);
+
+	writer.key("runningVersion");
+	writer.value(this->runningVersion);
+
+	writer.key("inOverTime");
+	writer.value(this->inOverTime);
+
+	writer.key("boostStatus");
+	writer.value((uint8_t)this->boostStatus);
+
+	writer.key("delayedStartTime");
+	if (this->delayedStartRun)
+	{
+		writer.value(system_clock::to_time_t(this->delayedStartTime));
+	}
+	else
+	{
+		writer.null();
+	}
+
+	writer.key("predictedEnd");
+	if (this->controlRun && !this->eta.stepTimes.empty())
+	{
+		writer.value(system_clock::to_time_t(this->eta.endTime));
+	}
+	else
+	{
+		writer.null();
+	}
+}
+
+void BrewEngine::pushTelemetry()
+{
+	const TemperatureHistory &recentLog = this->tempLog.recent();
+
+	if (this->telemetryClientCount == 0 || this->server == NULL)
+	{
+		this->telemetryDelta.skipLog(recentLog);
+		return;
+	}
+
+	json jState = this->telemetryState();
+
+	// only what changed since the last push goes out
+	json jDelta = this->telemetryDelta.update(jState, recentLog);
+
+	// serialized once here, all clients get the same frame
+	auto frame = new TelemetryFrame();
+
+	if (!jDelta.empty())
+	{
+		frame->delta = jDelta.dump();
+	}
+
+	if (this->telemetryNewClient.exchange(false))
+	{
+		frame->full = jState.dump();
+	}
+
+	if (frame->delta.empty() && frame->full.empty())
+	{
+		delete frame;
+		return;
+	}
+
+	// sockets belong to the httpd task, so we let it do the sending
+	if (httpd_queue_work(this->server, this->sendTelemetry, frame) != ESP_OK)
+	{
+		ESP_LOGW(TAG, "Unable to queue telemetry");
+		delete frame;
+	}
+}
+
+void BrewEngine::sendTelemetry(void *arg)
+{
+	TelemetryFrame *frame = (TelemetryFrame *)arg;
+	BrewEngine *instance = mainInstance;
+
+	auto send = [instance](int fd, const string &payload)
+	{
+		httpd_ws_frame_t wsFrame = {};
+		wsFrame.type = HTTPD_WS_TYPE_TEXT;
+		wsFrame.payload = (uint8_t *)payload.data();
+		wsFrame.len = payload.size();
+		httpd_ws_send_frame_async(instance->server, fd, &wsFrame);
+	};
+
+	auto isGone = [instance](int fd)
+	{ return httpd_ws_get_fd_info(instance->server, fd) != HTTPD_WS_CLIENT_WEBSOCKET; };
+
+	instance->telemetryClients.send(*frame, send, isGone);
+	instance->telemetryClientCount = instance->telemetryClients.size();
+
+	// connected after this frame was built, the next push has to bring the full state
+	if (instance->telemetryClients.waiting())
+	{
+		instance->telemetryNewClient = true;
+	}
+
+	delete frame;
+}
+
+void BrewEngine::handleGetHistory(json &data, CommandResult &result)
+{
+	time_t from = 0;
+	time_t to = std::numeric_limits<time_t>::max();
+	size_t points = HISTORY_MAX_POINTS;
+
+	if (!data["from"].is_null() && data["from"].is_number())
+	{
+		from = data["from"];
+	}
+	if (!data["to"].is_null() && data["to"].is_number())
+	{
+		to = data["to"];
+	}
+	if (!data["points"].is_null() && data["points"].is_number())
+	{
+		points = std::clamp<size_t>(data["points"].get<size_t>(), 3, HISTORY_MAX_POINTS);
+	}
+
+	result.writeData = [this, from, to, points](JsonWriter &writer)
+	{
+		writer.beginObject();
+
+		writer.key("samples");
+		writer.beginArray();
+		uint16_t bucketSeconds = this->tempLog.query(from, to, points, [&writer](const TieredHistory::Sample &sample)
+													 {
+			writer.beginObject();
+			writer.key("time");
+			writer.value(sample.time);
+			writer.key("temp");
+			writer.value(sample.temperature);
+			writer.endObject(); });
+		writer.endArray();
+
+		// 0 is full resolution, otherwise the samples are the min and max of buckets this long
+		writer.key("bucketSeconds");
+		writer.value(bucketSeconds);
+
+		writer.endObject();
+	};
+}
+
+void BrewEngine::handleGetChannelHistory(json &data, CommandResult &result)
+{
+	time_t from = 0;
+	time_t to = std::numeric_limits<time_t>::max();
+	size_t points = HISTORY_MAX_POINTS;
+
+	if (!data["from"].is_null() && data["from"].is_number())
+	{
+		from = data["from"];
+	}
+	if (!data["to"].is_null() && data["to"].is_number())
+	{
+		to = data["to"];
+	}
+	if (!data["points"].is_null() && data["points"].is_number())
+	{
+		points = std::clamp<size_t>(data["points"].get<size_t>(), 1, HISTORY_MAX_POINTS);
+	}
+
+	// all recorded channels, unless the client asks for some
+	std::vector<size_t> channels;
+	if (!data["channels"].is_null() && data["channels"].is_array())
+	{
+		for (auto &name : data["channels"])
+		{
+			size_t channel = name.is_string() ? this->channelLog.find(name.get<string>()) : string::npos;
+			if (channel != string::npos)
+			{
+				channels.push_back(channel);
 			}
-			else
+		}
+	}
+	else
+	{
+		for (auto const &channel : this->channelLog.channels())
+		{
+			size_t index = this->channelLog.find(channel.name);
+			if (index != string::npos)
 			{
-				for (auto iter = this->tempLog.rbegin(); iter != this->tempLog.rend(); ++iter)
-				{
-					json jTempLogItem;
-					jTempLogItem["time"] = iter->first;
-					jTempLogItem["temp"] = iter->second;
-					jTempLog.push_back(jTempLogItem);
-				}
+				channels.push_back(index);
 			}
 		}
+	}
+
+	result.writeData = [this, from, to, points, channels](JsonWriter &writer)
+	{
+		ChannelHistory::Range range = this->channelLog.range(from, to, points);
+
+		writer.beginObject();
+
+		// seconds between samples, longer when they are averaged to fit in points
+		writer.key("interval");
+		writer.value(CHANNEL_LOG_INTERVAL * range.every);
+
+		// columns, null where a channel had no value
+		writer.key("time");
+		writer.beginArray();
+		this->channelLog.times(range, [&writer](time_t time)
+							   { writer.value(time); });
+		writer.endArray();
+
+		writer.key("channels");
+		writer.beginObject();
+		for (size_t channel : channels)
+		{
+			writer.key(this->channelLog.channels()[channel].name);
+			writer.beginArray();
+			this->channelLog.values(channel, range, [&writer](float value)
+									{ writer.value(value); });
+			writer.endArray();
+		}
+		writer.endObject();
+
+		writer.endObject();
+	};
+}
+
+void BrewEngine::handleGetHistoryChannels(json &data, CommandResult &result)
+{
+	json jChannels = json::array({});
+
+	for (auto const &channel : this->historyChannelList())
+	{
+		json jChannel;
+		jChannel["name"] = channel.name;
+		jChannel["enabled"] = channel.enabled;
+		jChannel["recorded"] = this->channelLog.find(channel.name) != string::npos; // in the log of the current or last run
+		jChannels.push_back(jChannel);
+	}
+
+	result.data = jChannels;
+}
+
+void BrewEngine::handleSaveHistoryChannels(json &data, CommandResult &result)
+{
+	if (!data.is_object())
+	{
+		result.message = "Expected an object with a flag per channel";
+		result.success = false;
+		return;
+	}
+
+	for (auto &[name, enabled] : data.items())
+	{
+		if (enabled.is_boolean())
+		{
+			this->historyChannels.insert_or_assign(name, enabled.get<bool>());
+		}
+	}
+
+	json jChannels = json::object();
+	for (auto const &[name, enabled] : this->historyChannels)
+	{
+		jChannels[name] = enabled;
+	}
+
+	// serialize to MessagePack for size
+	vector<uint8_t> serialized = json::to_msgpack(jChannels);
+	this->settingsManager->Set(BrewSettings::historyChannels, serialized);
+
+	// the log of a running brew keeps its channels
+	result.message = "Saved, used from the next run";
+}
+
+void BrewEngine::handleGetRunningSchedule(json &data, CommandResult &result)
+{
+	// a client that has an older version only needs the shifts since, as long as they were all shifts and we still have them
+	std::optional<size_t> shiftCount = std::nullopt;
+	if (!data["since"].is_null() && data["since"].is_number())
+	{
+		uint16_t since = data["since"];
+		uint16_t gap = this->runningVersion - since;
+
+		if (gap <= this->scheduleShifts.size())
+		{
+			shiftCount = gap;
+		}
+	}
+
+	result.writeData = [this, shiftCount](JsonWriter &writer)
+	{
+		writer.beginObject();
 
-		// currenttemps is an array of current temps, they are not necessarily all used for control
-		json jCurrentTemps = json::array({});
-		for (auto const &[key, val] : this->currentTemperatures)
+		writer.key("version");
+		writer.value(this->runningVersion);
+
+		if (shiftCount.has_value())
 		{
-			json jCurrentTemp;
-			jCurrentTemp["sensor"] = to_string(key);			   // js doesn't support unint64
-			jCurrentTemp["temp"] = (double)((int)(val * 10)) / 10; // round float to 1 digit for display
-			jCurrentTemps.push_back(jCurrentTemp);
+			// steps from fromStep on and all notifications with a time move by extra seconds
+			writer.key("shifts");
+			writer.beginArray();
+			for (auto it = this->scheduleShifts.end() - shiftCount.value(); it != this->scheduleShifts.end(); ++it)
+			{
+				writer.beginObject();
+				writer.key("fromStep");
+				writer.value(it->fromStep);
+				writer.key("seconds");
+				writer.value(it->extra.count());
+				writer.endObject();
+			}
+			writer.endArray();
 		}
+		else
+		{
+			writer.key("steps");
+			this->executionPlan.write(writer);
+
+			writer.key("notifications");
+			writer.beginArray();
+			for (auto &notification : this->notifications)
+			{
+				writer.raw(notification.to_json(this->executionPlan.offset()).dump());
+			}
+			writer.endArray();
+		}
+
+		writer.key("eta");
+		this->eta.write(writer);
+
+		writer.endObject();
+	};
+}
+
+void BrewEngine::handleSetTemp(json &data, CommandResult &result)
+{
+	if (data["targetTemp"].is_null())
+	{
+		this->overrideTargetTemperature = std::nullopt;
+
+		// when not in a program also direclty set targtetemp
+		if (this->selectedMashScheduleName.empty() == true)
+		{
+			this->targetTemperature = 0;
+		}
+	}
+	else if (data["targetTemp"].is_number())
+	{
+
+		this->overrideTargetTemperature = (float)data["targetTemp"];
+
+		// when not in a program also direclty set targtetemp
+		if (this->selectedMashScheduleName.empty() == true)
+		{
+			this->targetTemperature = this->overrideTargetTemperature.value();
+		}
+	}
+	else
+	{
+		this->overrideTargetTemperature = std::nullopt;
+
+		result.message = "Incorrect data, integer or float expected!";
+		result.success = false;
+	}
+}
+
+void BrewEngine::handleSetOverrideOutput(json &data, CommandResult &result)
+{
+	if (data["output"].is_null() == false && data["output"].is_number())
+	{
+		this->manualOverrideOutput = (int)data["output"];
+	}
+	else
+	{
+		this->manualOverrideOutput = std::nullopt;
+	}
+
+	// reset so effect is immidiate
+	this->resetPitTime = true;
+}
+
+void BrewEngine::handleStart(json &data, CommandResult &result)
+{
+	if (data["selectedMashSchedule"].is_null())
+	{
+		this->selectedMashScheduleName.clear();
+	}
+	else
+	{
+		this->selectedMashScheduleName = (string)data["selectedMashSchedule"];
+	}
+
+	this->start();
+}
+
+void BrewEngine::handleStartAt(json &data, CommandResult &result)
+{
+	this->delayedStart(data, result, false);
+}
+
+void BrewEngine::handleReadyBy(json &data, CommandResult &result)
+{
+	this->delayedStart(data, result, true);
+}
+
+void BrewEngine::delayedStart(json &data, CommandResult &result, bool readyBy)
+{
+	if (this->controlRun || this->delayedStartRun)
+	{
+		result.message = "Already running!";
+		result.success = false;
+	}
+	else if (data["selectedMashSchedule"].is_null() || data["time"].is_null() || !data["time"].is_number())
+	{
+		result.message = "Incorrect data, selectedMashSchedule and time expected!";
+		result.success = false;
+	}
+	else
+	{
+		this->selectedMashScheduleName = (string)data["selectedMashSchedule"];
+
+		auto time = system_clock::from_time_t((time_t)data["time"]);
+		std::optional<system_clock::time_point> startTime = time;
+
+		this->delayedReadyBy = std::nullopt;
+
+		// for ready by we calculate when we need to start heating
+		if (readyBy)
+		{
+			this->delayedStartVolume = 0;
+			if (!data["volume"].is_null() && data["volume"].is_number())
+			{
+				this->delayedStartVolume = (float)data["volume"];
+			}
+
+			this->delayedReadyBy = time;
+			startTime = this->calculateDelayedStart(time, this->delayedStartVolume);
+		}
+
+		if (!startTime.has_value())
+		{
+			result.message = "Unable to predict heat up time, please provide the volume!";
+			result.success = false;
+		}
+		else
+		{
+			this->delayedStartTime = startTime.value();
+			this->delayedStartRun = true;
+			this->statusText = "Delayed Start";
+
+			// the task of an earlier StartAt can still be sleeping, it sees the new handle and ends
+			xTaskCreate(&this->delayedStartLoop, "delayedstart_task", 4096, this, 5, &this->delayedStartHandle);
+
+			result.data = {
+				{"startTime", system_clock::to_time_t(this->delayedStartTime)},
+			};
+		}
+	}
+}
+
+void BrewEngine::handleStartStir(json &data, CommandResult &result)
+{
+	this->startStir(data);
+}
+
+void BrewEngine::handleStop(json &data, CommandResult &result)
+{
+	this->stop();
+}
+
+void BrewEngine::handleStopStir(json &data, CommandResult &result)
+{
+	this->stopStir();
+}
+
+void BrewEngine::handleGetMashSchedules(json &data, CommandResult &result)
+{
+	// the saved ones, and the ones that are only set, like an import that wasn't saved
+	std::set<string> names;
+	{
+		std::lock_guard<std::mutex> lock(this->mashSchedulesLock);
+		this->scheduleStore.names([&names](const string &name)
+								  { names.insert(name); });
+		for (auto const &[name, schedule] : this->mashSchedules)
+		{
+			names.insert(name);
+		}
+	}
+
+	json jSchedules = json::array({});
+
+	for (auto const &name : names)
+	{
+		auto schedule = this->findMashSchedule(name, false);
+		if (schedule.has_value())
+		{
+			jSchedules.push_back(schedule->to_json());
+		}
+	}
+
+	result.data = jSchedules;
+}
+
+void BrewEngine::handleSaveMashSchedule(json &data, CommandResult &result)
+{
+	this->setMashSchedule(data);
+
+	this->saveMashSchedule(data["name"].get<string>());
+}
+
+// used by import function to set but not save
+void BrewEngine::handleSetMashSchedule(json &data, CommandResult &result)
+{
+	this->setMashSchedule(data);
+}
+
+void BrewEngine::handleDeleteMashSchedule(json &data, CommandResult &result)
+{
+	string deleteName = (string)data["name"];
+
+	std::lock_guard<std::mutex> lock(this->mashSchedulesLock);
+
+	auto pos = this->mashSchedules.find(deleteName);
+	bool saved = this->scheduleStore.contains(deleteName);
+
+	if (pos == this->mashSchedules.end() && !saved)
+	{
+		result.message = "Schedule with name: " + deleteName + " not found";
+		result.success = false;
+	}
+	else
+	{
+		if (pos != this->mashSchedules.end())
+		{
+			this->mashSchedules.erase(pos);
+		}
+		this->scheduleStore.remove(deleteName);
+	}
+}
+
+void BrewEngine::handleGetBrewLogs(json &data, CommandResult &result)
+{
+	json jLogs = json::array({});
+
+	this->brewLog.list([this, &jLogs](time_t id, size_t size)
+					   {
+		json jHeader = this->brewLog.readHeader(id);
+
+		json jLog;
+		jLog["id"] = id;
+		jLog["size"] = size;
+		jLog["open"] = this->brewLog.isOpen() && this->brewLog.id() == id;
+		jLog["boil"] = jHeader.value("boil", false);
+		if (jHeader.contains("schedule") && jHeader["schedule"].is_object())
+		{
+			jLog["schedule"] = jHeader["schedule"].value("name", "");
+		}
+		jLogs.push_back(jLog); });
+
+	result.data = jLogs;
+}
+
+void BrewEngine::handleGetBrewLog(json &data, CommandResult &result)
+{
+	if (data["id"].is_null() || !data["id"].is_number())
+	{
+		result.message = "Incorrect data, id expected!";
+		result.success = false;
+		return;
+	}
+
+	time_t id = data["id"];
+
+	if (this->brewLog.readHeader(id).empty())
+	{
+		result.message = "Brew log not found";
+		result.success = false;
+		return;
+	}
+
+	// a brew is a few thousand samples, so it is streamed straight from flash
+	result.writeData = [this, id](JsonWriter &writer)
+	{
+		writer.beginObject();
+
+		// rows of time and the values of the channels in the header
+		json jHeader;
+		writer.key("samples");
+		writer.beginArray();
+		this->brewLog.read(id, [&jHeader](const json &header)
+						   { jHeader = header; },
+						   [&writer](time_t time, const std::vector<float> &values)
+						   {
+			writer.beginArray();
+			writer.value(time);
+			for (float value : values)
+			{
+				writer.value(value);
+			}
+			writer.endArray(); });
+		writer.endArray();
+
+		writer.key("header");
+		writer.raw(jHeader.dump());
+
+		writer.endObject();
+	};
+}
+
+void BrewEngine::handleDeleteBrewLog(json &data, CommandResult &result)
+{
+	if (data["id"].is_null() || !data["id"].is_number())
+	{
+		result.message = "Incorrect data, id expected!";
+		result.success = false;
+		return;
+	}
+
+	if (!this->brewLog.remove(data["id"].get<time_t>()))
+	{
+		result.message = "Brew log not found or still running";
+		result.success = false;
+	}
+}
+
+void BrewEngine::handleGetPIDSettings(json &data, CommandResult &result)
+{
+	result.data = this->settingFieldsToJson(pidSettingFields());
+}
+
+void BrewEngine::handleSavePIDSettings(json &data, CommandResult &result)
+{
+	ESP_LOGI(TAG, "Saving PID Settings");
+
+	string invalid = this->saveSettingFields(data, pidSettingFields());
+	if (!invalid.empty())
+	{
+		result.success = false;
+		result.message = "Invalid value for " + invalid;
+		return;
+	}
+
+	if (data.contains("heatUpRate"))
+	{
+		this->heatUpRateDirty = false;
+	}
+
+	ESP_LOGI(TAG, "Saving PID Settings Done");
+}
+
+void BrewEngine::handleGetTempSettings(json &data, CommandResult &result)
+{
+	// Convert sensors to json
+	json jSensors = json::array({});
+
+	for (auto const &[key, val] : this->sensors)
+	{
+		json jSensor = val->to_json();
+		jSensors.push_back(jSensor);
+	}
+
+	result.data = jSensors;
+}
+
+void BrewEngine::handleSaveTempSettings(json &data, CommandResult &result)
+{
+	this->saveTempSensorSettings(data);
+}
+
+void BrewEngine::handleDetectTempSensors(json &data, CommandResult &result)
+{
+	this->detectOnewireTemperatureSensors();
+}
+
+void BrewEngine::handleGetHeaterSettings(json &data, CommandResult &result)
+{
+	// Convert heaters to json
+	json jHeaters = json::array({});
+
+	for (auto const &heater : this->heaters)
+	{
+		json jHeater = heater->to_json();
+		jHeaters.push_back(jHeater);
+	}
+
+	result.data = jHeaters;
+}
+
+void BrewEngine::handleGetJob(json &data, CommandResult &result)
+{
+	uint16_t id = 0;
+	if (!data["id"].is_null() && data["id"].is_number())
+	{
+		id = data["id"];
+	}
+
+	auto found = std::find_if(this->jobs.begin(), this->jobs.end(), [id](const CommandJob *job)
+							  { return job->id == id; });
+
+	if (found == this->jobs.end())
+	{
+		result.message = "Unknown job";
+		result.success = false;
+		return;
+	}
+
+	// still busy, same answer as when it was queued
+	if (!(*found)->done)
+	{
+		result.jobId = id;
+		return;
+	}
+
+	result = (*found)->result;
+}
+
+void BrewEngine::handleSaveHeaterSettings(json &data, CommandResult &result)
+{
+	if (this->controlRun)
+	{
+		result.message = "You cannot save heater settings while running!";
+		result.success = false;
+	}
+	else
+	{
+		this->saveHeaterSettings(data);
+	}
+}
+
+void BrewEngine::handleGetWifiSettings(json &data, CommandResult &result)
+{
+	// get data from wifi-connect
+	if (this->GetWifiSettingsJson)
+	{
+		result.data = this->GetWifiSettingsJson();
+	}
+}
+
+void BrewEngine::handleSaveWifiSettings(json &data, CommandResult &result)
+{
+	// save via wifi-connect
+	if (this->SaveWifiSettingsJson)
+	{
+		this->SaveWifiSettingsJson(data);
+	}
+	result.message = "Please restart device for changes to have effect!";
+}
+
+void BrewEngine::handleScanWifi(json &data, CommandResult &result)
+{
+	// scans for networks
+	if (this->ScanWifiJson)
+	{
+		result.data = this->ScanWifiJson();
+	}
+}
+
+void BrewEngine::handleGetSystemSettings(json &data, CommandResult &result)
+{
+	result.data = this->settingFieldsToJson(systemSettingFields());
+}
+
+void BrewEngine::handleSaveSystemSettings(json &data, CommandResult &result)
+{
+	string invalid = this->saveSystemSettingsJson(data);
+	if (!invalid.empty())
+	{
+		result.success = false;
+		result.message = "Invalid value for " + invalid;
+		return;
+	}
+
+	result.message = "Please restart device for changes to have effect!";
+}
+
+void BrewEngine::handleReboot(json &data, CommandResult &result)
+{
+	// don't lose settings that are still waiting for their commit
+	this->settingsManager->Commit();
+	xTaskCreate(&this->reboot, "reboot_task", 1024, this, 5, NULL);
+}
+
+void BrewEngine::handleFactoryReset(json &data, CommandResult &result)
+{
+	this->settingsManager->FactoryReset();
+	result.message = "Device will restart shortly, reconnect to factory wifi settings to continue!";
+	xTaskCreate(&this->reboot, "reboot_task", 1024, this, 5, NULL);
+}
+
+void BrewEngine::handleBootIntoRecovery(json &data, CommandResult &result)
+{
+	result.message = this->bootIntoRecovery();
+
+	if (result.message.find("Error") != std::string::npos)
+	{
+		result.success = false;
+	}
+	else
+	{
+		this->settingsManager->Commit();
+		xTaskCreate(&this->reboot, "reboot_task", 1024, this, 5, NULL);
+	}
+}
+
+httpd_handle_t BrewEngine::startWebserver(void)
+{
+
+	httpd_uri_t indexUri = {};
+	indexUri.uri = "/";
+	indexUri.method = HTTP_GET;
+	indexUri.handler = this->indexGetHandler;
+
+	httpd_uri_t logoUri = {};
+	logoUri.uri = "/logo.svg";
+	logoUri.method = HTTP_GET;
+	logoUri.handler = this->logoGetHandler;
+
+	httpd_uri_t manifestUri = {};
+	manifestUri.uri = "/manifest.json";
+	manifestUri.method = HTTP_GET;
+	manifestUri.handler = this->manifestGetHandler;
+
+	httpd_uri_t postUri = {};
+	postUri.uri = "/api";
+	postUri.method = HTTP_POST;
+	postUri.handler = this->apiPostHandler;
+
+	httpd_uri_t optionsUri = {};
+	optionsUri.uri = "/api";
+	optionsUri.method = HTTP_OPTIONS;
+	optionsUri.handler = this->apiOptionsHandler;
+
+	httpd_uri_t eventsUri = {};
+	eventsUri.uri = "/api/events";
+	eventsUri.method = HTTP_GET;
+	eventsUri.handler = this->eventsHandler;
+	eventsUri.is_websocket = true;
+
+	httpd_uri_t metricsUri = {};
+	metricsUri.uri = "/metrics";
+	metricsUri.method = HTTP_GET;
+	metricsUri.handler = this->metricsGetHandler;
+
+	httpd_uri_t historyUri = {};
+	historyUri.uri = "/api/history";
+	historyUri.method = HTTP_GET;
+	historyUri.handler = this->historyGetHandler;
+
+	httpd_uri_t otherUri = {};
+	otherUri.uri = "/*";
+	otherUri.method = HTTP_GET;
+	otherUri.handler = this->staticGetHandler;
+
+	httpd_handle_t server = NULL;
+	httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+	// whiout this the esp crashed whitout a proper warning
+	config.stack_size = 20480;
+	config.uri_match_fn = httpd_uri_match_wildcard;
+	config.max_uri_handlers = 12;
+	// websocket clients keep their socket, close the least recently used one instead of refusing new connections
+	// needs CONFIG_LWIP_MAX_SOCKETS of at least max_open_sockets + 3
+	config.max_open_sockets = 12;
+	config.lru_purge_enable = true;
+	config.close_fn = this->closeSocket;
+
+	// Start the httpd server
+	ESP_LOGI(TAG, "Starting server on port: '%d'", config.server_port);
+	if (httpd_start(&server, &config) == ESP_OK)
+	{
+		// Set URI handlers
+		httpd_register_uri_handler(server, &indexUri);
+		httpd_register_uri_handler(server, &logoUri);
+		httpd_register_uri_handler(server, &manifestUri);
+		httpd_register_uri_handler(server, &eventsUri); // before the wildcard, otherwise it gets redirected
+		httpd_register_uri_handler(server, &metricsUri);
+		httpd_register_uri_handler(server, &historyUri);
+		httpd_register_uri_handler(server, &otherUri);
+		httpd_register_uri_handler(server, &postUri);
+		httpd_register_uri_handler(server, &optionsUri);
+		return server;
+	}
+
+	ESP_LOGI(TAG, "Error starting server!");
+	return NULL;
+}
+
+void BrewEngine::logRemote(const string &message)
+{
+	if (this->mqttEnabled)
+	{
+		string iso_datetime = this->to_iso_8601(std::chrono::system_clock::now());
+		json jPayload;
+		jPayload["time"] = iso_datetime;
+		jPayload["level"] = "Debug";
+		jPayload["message"] = message;
+		string payload = jPayload.dump();
+
+		esp_mqtt_client_publish(this->mqttClient, this->mqttTopicLog.c_str(), payload.c_str(), 0, 1, 1);
+	}
+}
+
+void BrewEngine::stopWebserver(httpd_handle_t server)
+{
+	// Stop the httpd server
+	httpd_stop(server);
+}
+
+esp_err_t BrewEngine::sendWebFile(httpd_req_t *req, const unsigned char *start, const unsigned char *end, const char *type, const char *etag, bool gzipped)
+{
+	// files only change with a new firmware, the browser can keep them as long as the etag still matches
+	httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+	if (notModified(req, etag))
+	{
+		return ESP_OK;
+	}
+
+	httpd_resp_set_type(req, type);
+	if (gzipped)
+	{
+		httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+	}
+	httpd_resp_send(req, (const char *)start, end - start);
+
+	return ESP_OK;
+}
+
+// sets the etag, and answers with a 304 when the browser already has this version
+bool BrewEngine::notModified(httpd_req_t *req, const char *etag)
+{
+	httpd_resp_set_hdr(req, "ETag", etag);
+
+	size_t length = httpd_req_get_hdr_value_len(req, "If-None-Match");
+	if (length == 0)
+	{
+		return false;
+	}
+
+	string ifNoneMatch(length + 1, '\0');
+	if (httpd_req_get_hdr_value_str(req, "If-None-Match", ifNoneMatch.data(), ifNoneMatch.size()) != ESP_OK || !WebEtags::matches(ifNoneMatch, etag))
+	{
+		return false;
+	}
+
+	httpd_resp_set_status(req, "304 Not Modified");
+	httpd_resp_send(req, NULL, 0);
+	return true;
+}
+
+esp_err_t BrewEngine::sendStaticFile(httpd_req_t *req, const char *uri)
+{
+	if (!mainInstance->webFilesMounted)
+	{
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	string path = uri;
+	path = path.substr(0, path.find('?'));
+
+	if (path.find("..") != string::npos)
+	{
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	// we prefer the precompressed variant
+	string fsPath = "/www" + path;
+	bool gzipped = true;
+	FILE *file = fopen((fsPath + ".gz").c_str(), "r");
+
+	if (file == NULL)
+	{
+		gzipped = false;
+		file = fopen(fsPath.c_str(), "r");
+	}
+
+	if (file == NULL)
+	{
+		return ESP_ERR_NOT_FOUND;
+	}
+
+	// build assets have their hash in the name, so they never change
+	if (path.starts_with("/assets/"))
+	{
+		httpd_resp_set_hdr(req, "Cache-Control", "public, max-age=31536000, immutable");
+	}
+	else
+	{
+		httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+	}
+
+	const char *etag = mainInstance->webFileEtags.find(gzipped ? path + ".gz" : path);
+	if (etag != nullptr && notModified(req, etag))
+	{
+		fclose(file);
+		return ESP_OK;
+	}
+
+	httpd_resp_set_type(req, mimeType(path));
+	if (gzipped)
+	{
+		httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+	}
+
+	char buffer[1024];
+	size_t bytesRead;
+	esp_err_t ret = ESP_OK;
+
+	while ((bytesRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		ret = httpd_resp_send_chunk(req, buffer, bytesRead);
+		if (ret != ESP_OK)
+		{
+			break;
+		}
+	}
+
+	fclose(file);
+
+	if (ret != ESP_OK)
+	{
+		ESP_LOGW(TAG, "Sending %s failed", path.c_str());
+		return ESP_FAIL;
+	}
+
+	httpd_resp_send_chunk(req, NULL, 0);
+
+	return ESP_OK;
+}
+
+const char *BrewEngine::mimeType(const string &path)
+{
+	static const std::array<std::pair<std::string_view, const char *>, 12> types = {{
+		{".html", "text/html"},
+		{".js", "text/javascript"},
+		{".css", "text/css"},
+		{".svg", "image/svg+xml"},
+		{".json", "application/json"},
+		{".webmanifest", "application/manifest+json"},
+		{".png", "image/png"},
+		{".ico", "image/x-icon"},
+		{".woff2", "font/woff2"},
+		{".woff", "font/woff"},
+		{".ttf", "font/ttf"},
+		{".eot", "application/vnd.ms-fontobject"},
+	}};
+
+	for (auto const &[extension, type] : types)
+	{
+		if (path.ends_with(extension))
+		{
+			return type;
+		}
+	}
+
+	return "application/octet-stream";
+}
+
+esp_err_t BrewEngine::staticGetHandler(httpd_req_t *req)
+{
+	esp_err_t ret = sendStaticFile(req, req->uri);
+
+	if (ret == ESP_ERR_NOT_FOUND)
+	{
+		return otherGetHandler(req);
+	}
+
+	return ret;
+}
+
+esp_err_t BrewEngine::indexGetHandler(httpd_req_t *req)
+{
+	esp_err_t ret = sendStaticFile(req, "/index.html");
+
+	if (ret != ESP_ERR_NOT_FOUND)
+	{
+		return ret;
+	}
+
+	// ESP_LOGI(TAG, "index_get_handler");
+	extern const unsigned char index_html_start[] asm("_binary_index_html_gz_start");
+	extern const unsigned char index_html_end[] asm("_binary_index_html_gz_end");
+
+	return sendWebFile(req, index_html_start, index_html_end, "text/html", "\"" INDEX_HTML_GZ_HASH "\"", true);
+}
+
+esp_err_t BrewEngine::logoGetHandler(httpd_req_t *req)
+{
+	extern const unsigned char logo_svg_file_start[] asm("_binary_logo_svg_gz_start");
+	extern const unsigned char logo_svg_file_end[] asm("_binary_logo_svg_gz_end");
+
+	return sendWebFile(req, logo_svg_file_start, logo_svg_file_end, "image/svg+xml", "\"" LOGO_SVG_GZ_HASH "\"", true);
+}
+
+esp_err_t BrewEngine::manifestGetHandler(httpd_req_t *req)
+{
+	extern const unsigned char manifest_json_file_start[] asm("_binary_manifest_json_start");
+	extern const unsigned char manifest_json_file_end[] asm("_binary_manifest_json_end");
+
+	return sendWebFile(req, manifest_json_file_start, manifest_json_file_end, "application/json", "\"" MANIFEST_JSON_HASH "\"", false);
+}
+
+esp_err_t BrewEngine::otherGetHandler(httpd_req_t *req)
+{
+	httpd_resp_set_status(req, "307 Temporary Redirect");
+	httpd_resp_set_hdr(req, "Location", "/");
+	httpd_resp_send(req, "<html><body>Wrong</body></html>", 0); // Response body can be empty
 
-		resultData = {
-			{"temp", (double)((int)(this->temperature * 10)) / 10}, // round float to 1 digit for display
-			{"temps", jCurrentTemps},
-			{"targetTemp", (double)((int)(this->targetTemperature * 10)) / 10}, // round float to 1 digit for display,
-			{"manualOverrideTargetTemp", nullptr},
-			{"output", this->pidOutput},
-			{"manualOverrideOutput", nullptr},
-			{"status", this->statusText},
-			{"stirStatus", this->stirStatusText},
-			{"lastLogDateTime", lastLogDateTime},
-			{"tempLog", jTempLog},
-			{"runningVersion", this->runningVersion},
-			{"inOverTime", this->inOverTime},
-			{"boostStatus", this->boostStatus},
-		};
+	return ESP_OK;
+}
 
-		if (this->manualOverrideOutput.has_value())
-		{
-			resultData["manualOverrideOutput"] = this->manualOverrideOutput.value();
-		}
+esp_err_t BrewEngine::apiPostHandler(httpd_req_t *req)
+{
+	// parse while we receive, the body itself is never kept in memory
+	RequestReader reader(req, API_MAX_REQUEST_SIZE, API_MAX_RECV_TIMEOUTS);
 
-		if (this->overrideTargetTemperature.has_value())
-		{
-			resultData["manualOverrideTargetTemp"] = this->overrideTargetTemperature.value();
-		}
-	}
-	else if (command == "GetRunningSchedule")
+	if (reader.tooLarge())
 	{
-		json jRunningSchedule;
-		jRunningSchedule["version"] = this->runningVersion;
+		ESP_LOGW(TAG, "Api request too large: %d", req->content_len);
+		httpd_resp_send_err(req, HTTPD_413_CONTENT_TOO_LARGE, "Request too large");
+		return ESP_FAIL;
+	}
 
-		json jExecutionSteps = json::array({});
-		for (auto const &[key, val] : this->executionSteps)
-		{
-			json jExecutionStep = val->to_json();
-			jExecutionSteps.push_back(jExecutionStep);
-		}
-		jRunningSchedule["steps"] = jExecutionSteps;
+	// json unless the client asks for something else
+	ApiEncoding requestEncoding = apiEncoding(req, "Content-Type");
+	ApiEncoding responseEncoding = apiEncoding(req, "Accept");
 
-		json jNotifications = json::array({});
-		for (auto &notification : this->notifications)
-		{
-			json jNotification = notification->to_json();
-			jNotifications.push_back(jNotification);
-		}
-		jRunningSchedule["notifications"] = jNotifications;
+	json jCommand;
 
-		resultData = jRunningSchedule;
+	switch (requestEncoding)
+	{
+	case MessagePackEncoding:
+		jCommand = json::from_msgpack(reader.begin(), reader.end(), true, false);
+		break;
+	case CborEncoding:
+		jCommand = json::from_cbor(reader.begin(), reader.end(), true, false);
+		break;
+	default:
+		jCommand = json::parse(reader.begin(), reader.end(), nullptr, false);
+		break;
 	}
-	else if (command == "SetTemp")
+
+	if (reader.timedOut())
 	{
+		ESP_LOGW(TAG, "Api request timed out");
+		httpd_resp_send_err(req, HTTPD_408_REQ_TIMEOUT, "Request timed out");
+		return ESP_FAIL;
+	}
 
-		if (data["targetTemp"].is_null())
-		{
-			this->overrideTargetTemperature = std::nullopt;
+	if (reader.failed())
+	{
+		return ESP_FAIL;
+	}
 
-			// when not in a program also direclty set targtetemp
-			if (this->selectedMashScheduleName.empty() == true)
-			{
-				this->targetTemperature = 0;
-			}
-		}
-		else if (data["targetTemp"].is_number())
-		{
+	// an array is a batch, it gets an array of results in the same order
+	bool batch = jCommand.is_array();
 
-			this->overrideTargetTemperature = (float)data["targetTemp"];
+	if (jCommand.is_discarded() || !(jCommand.is_object() || batch) || (batch && jCommand.size() > API_MAX_BATCH_COMMANDS))
+	{
+		ESP_LOGW(TAG, "Invalid api request");
+		httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid request");
+		return ESP_FAIL;
+	}
 
-			// when not in a program also direclty set targtetemp
-			if (this->selectedMashScheduleName.empty() == true)
-			{
-				this->targetTemperature = this->overrideTargetTemperature.value();
-			}
-		}
-		else
-		{
-			this->overrideTargetTemperature = std::nullopt;
+	// all commands run before anything is sent, httpd handles one request at a time so no other api call gets in between
+	std::vector<CommandResult> results = runCommands(jCommand, [](json &jCommand)
+													 { return mainInstance->processCommand(jCommand); });
 
-			message = "Incorrect data, integer or float expected!";
-			success = false;
-		}
-	}
-	else if (command == "SetOverrideOutput")
+	auto writeResults = [&](JsonWriter &writer)
 	{
+		if (batch)
+		{
+			writer.beginArray();
+		}
 
-		if (data["output"].is_null() == false && data["output"].is_number())
+		for (auto &result : results)
 		{
-			this->manualOverrideOutput = (int)data["output"];
+			result.write(writer);
 		}
-		else
+
+		if (batch)
 		{
-			this->manualOverrideOutput = std::nullopt;
+			writer.endArray();
 		}
+	};
 
-		// reset so effect is immidiate
-		this->resetPitTime = true;
-	}
-	else if (command == "Start")
+	httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+	httpd_resp_set_hdr(req, "Vary", "Accept");
+
+	// binary encodings need the whole document, they are a lot smaller than json so we can afford that
+	if (responseEncoding != JsonEncoding)
 	{
-		if (data["selectedMashSchedule"].is_null())
+		json jResult;
+		JsonWriter writer(jResult);
+		writeResults(writer);
+
+		std::vector<uint8_t> payload;
+		if (responseEncoding == MessagePackEncoding)
 		{
-			this->selectedMashScheduleName.clear();
+			payload = json::to_msgpack(jResult);
+			httpd_resp_set_type(req, "application/msgpack");
 		}
 		else
 		{
-			this->selectedMashScheduleName = (string)data["selectedMashSchedule"];
+			payload = json::to_cbor(jResult);
+			httpd_resp_set_type(req, "application/cbor");
 		}
 
-		this->start();
-	}
-	else if (command == "StartStir")
-	{
-		this->startStir(data);
-	}
-	else if (command == "Stop")
-	{
-		this->stop();
-	}
-	else if (command == "StopStir")
-	{
-		this->stopStir();
+		httpd_resp_send(req, (const char *)payload.data(), payload.size());
+
+		return ESP_OK;
 	}
-	else if (command == "GetMashSchedules")
-	{
 
-		json jSchedules = json::array({});
+	httpd_resp_set_type(req, "text/plain");
 
-		for (auto const &[key, val] : this->mashSchedules)
-		{
-			json jSchedule = val->to_json();
-			jSchedules.push_back(jSchedule);
-		}
+	// written out in chunks as it's generated, so peak memory doesn't depend on the size of the response
+	JsonWriter writer([req](const char *chunk, size_t length)
+					  { return httpd_resp_send_chunk(req, chunk, length) == ESP_OK; });
 
-		resultData = jSchedules;
-	}
-	else if (command == "SaveMashSchedule")
-	{
-		this->setMashSchedule(data);
+	writeResults(writer);
 
-		this->saveMashSchedules();
-	}
-	else if (command == "SetMashSchedule") // used by import function to set but not save
+	if (!writer.flush())
 	{
-		this->setMashSchedule(data);
+		ESP_LOGW(TAG, "Sending api response failed");
+		return ESP_FAIL;
 	}
-	else if (command == "DeleteMashSchedule")
-	{
-		string deleteName = (string)data["name"];
 
-		auto pos = this->mashSchedules.find(deleteName);
+	httpd_resp_send_chunk(req, NULL, 0);
 
-		if (pos == this->mashSchedules.end())
-		{
-			message = "Schedule with name: " + deleteName + " not found";
-			success = false;
-		}
-		else
-		{
-			this->mashSchedules.erase(pos);
-			this->saveMashSchedules();
-		}
-	}
-	else if (command == "GetPIDSettings")
-	{
-		resultData = {
-			{"kP", this->mashkP},
-			{"kI", this->mashkI},
-			{"kD", this->mashkD},
-			{"boilkP", this->boilkP},
-			{"boilkI", this->boilkI},
-			{"boilkD", this->boilkD},
-			{"pidLoopTime", this->pidLoopTime},
-			{"stepInterval", this->stepInterval},
-			{"boostModeUntil", this->boostModeUntil},
-		};
-	}
-	else if (command == "SavePIDSettings")
+	return ESP_OK;
+}
+
+std::optional<string> BrewEngine::queryValue(const string &query, const char *key, size_t maxLength)
+{
+	string value(maxLength, '\0');
+	if (httpd_query_key_value(query.c_str(), key, value.data(), value.size()) != ESP_OK)
 	{
-		this->mashkP = data["kP"].get<double>();
-		this->mashkI = data["kI"].get<double>();
-		this->mashkD = data["kD"].get<double>();
-		this->boilkP = data["boilkP"].get<double>();
-		this->boilkI = data["boilkI"].get<double>();
-		this->boilkD = data["boilkD"].get<double>();
-		this->pidLoopTime = data["pidLoopTime"].get<uint16_t>();
-		this->stepInterval = data["stepInterval"].get<uint16_t>();
-		this->boostModeUntil = data["boostModeUntil"].get<uint8_t>();
-		this->savePIDSettings();
+		return std::nullopt;
 	}
-	else if (command == "GetTempSettings")
-	{
-		// Convert sensors to json
-		json jSensors = json::array({});
 
-		for (auto const &[key, val] : this->sensors)
-		{
-			json jSensor = val->to_json();
-			jSensors.push_back(jSensor);
-		}
+	value.resize(strlen(value.c_str()));
+	return value;
+}
 
-		resultData = jSensors;
-	}
-	else if (command == "SaveTempSettings")
-	{
-		this->saveTempSensorSettings(data);
-	}
-	else if (command == "DetectTempSensors")
+// GET /api/history?format=csv|bin&from=&to=&channels=a,b&log=id
+// exports the history of the running brew, or a brew log from flash when log is given, streamed row by row
+esp_err_t BrewEngine::historyGetHandler(httpd_req_t *req)
+{
+	BrewEngine *instance = mainInstance;
+
+	string query;
+	size_t queryLength = httpd_req_get_url_query_len(req);
+	if (queryLength > 0)
 	{
-		this->detectOnewireTemperatureSensors();
+		query.resize(queryLength + 1);
+		httpd_req_get_url_query_str(req, query.data(), query.size());
+		query.resize(queryLength);
 	}
-	else if (command == "GetHeaterSettings")
-	{
-		// Convert heaters to json
-		json jHeaters = json::array({});
 
-		for (auto const &heater : this->heaters)
-		{
-			json jHeater = heater->to_json();
-			jHeaters.push_back(jHeater);
-		}
+	HistoryExport::Format format = (queryValue(query, "format").value_or("csv") == "bin") ? HistoryExport::Binary : HistoryExport::Csv;
 
-		resultData = jHeaters;
-	}
-	else if (command == "SaveHeaterSettings")
+	time_t from = 0;
+	time_t to = std::numeric_limits<time_t>::max();
+	std::optional<time_t> logId = std::nullopt;
+	if (auto value = queryValue(query, "from"))
 	{
-		if (this->controlRun)
-		{
-			message = "You cannot save heater settings while running!";
-			success = false;
-		}
-		else
-		{
-			this->saveHeaterSettings(data);
-		}
+		from = std::strtoll(value->c_str(), nullptr, 10);
 	}
-	else if (command == "GetWifiSettings")
+	if (auto value = queryValue(query, "to"))
 	{
-		// get data from wifi-connect
-		if (this->GetWifiSettingsJson)
-		{
-			resultData = this->GetWifiSettingsJson();
-		}
+		to = std::strtoll(value->c_str(), nullptr, 10);
 	}
-	else if (command == "SaveWifiSettings")
+	if (auto value = queryValue(query, "log"))
 	{
-		// save via wifi-connect
-		if (this->SaveWifiSettingsJson)
-		{
-			this->SaveWifiSettingsJson(data);
-		}
-		message = "Please restart device for changes to have effect!";
+		logId = std::strtoll(value->c_str(), nullptr, 10);
 	}
-	else if (command == "ScanWifi")
+
+	// empty is every channel
+	std::vector<string> requested;
+	if (auto value = queryValue(query, "channels", 512))
 	{
-		// scans for networks
-		if (this->ScanWifiJson)
+		std::stringstream names(value.value());
+		string name;
+		while (std::getline(names, name, ','))
 		{
-			resultData = this->ScanWifiJson();
+			if (!name.empty())
+			{
+				requested.push_back(name);
+			}
 		}
 	}
-	else if (command == "GetSystemSettings")
+
+	auto wanted = [&requested](const string &name)
 	{
-		resultData = {
-			{"onewirePin", this->oneWire_PIN},
-			{"stirPin", this->stir_PIN},
-			{"buzzerPin", this->buzzer_PIN},
-			{"buzzerTime", this->buzzerTime},
-			{"invertOutputs", this->invertOutputs},
-			{"mqttUri", this->mqttUri},
-			{"temperatureScale", this->temperatureScale},
-		};
+		return requested.empty() || std::find(requested.begin(), requested.end(), name) != requested.end();
+	};
+
+	if (logId.has_value() && instance->brewLog.readHeader(logId.value()).empty())
+	{
+		httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Brew log not found");
+		return ESP_FAIL;
 	}
-	else if (command == "SaveSystemSettings")
+
+	if (format == HistoryExport::Binary)
 	{
-		this->saveSystemSettingsJson(data);
-		message = "Please restart device for changes to have effect!";
+		httpd_resp_set_type(req, "application/octet-stream");
+		httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"history.bin\"");
 	}
-	else if (command == "Reboot")
+	else
 	{
-		xTaskCreate(&this->reboot, "reboot_task", 1024, this, 5, NULL);
+		httpd_resp_set_type(req, "text/csv");
+		httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"history.csv\"");
 	}
-	else if (command == "FactoryReset")
+
+	// like the api, so analysis tools and the dev ui can fetch it from another origin
+	httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+	HistoryExport writer(format, [req](const char *chunk, size_t length)
+						 { return httpd_resp_send_chunk(req, chunk, length) == ESP_OK; });
+
+	if (logId.has_value())
 	{
-		this->settingsManager->FactoryReset();
-		message = "Device will restart shortly, reconnect to factory wifi settings to continue!";
-		xTaskCreate(&this->reboot, "reboot_task", 1024, this, 5, NULL);
+		// the log has its own channel order, we pick the ones that were asked for
+		std::vector<size_t> picked;
+		std::vector<float> row;
+		instance->brewLog.read(logId.value(), [&](const json &header)
+							   {
+			std::vector<ChannelHistory::Channel> channels;
+			size_t index = 0;
+			for (auto &channel : header["channels"])
+			{
+				string name = channel["name"].get<string>();
+				if (wanted(name))
+				{
+					channels.push_back({name, channel["scale"].get<uint8_t>(), true});
+					picked.push_back(index);
+				}
+				index++;
+			}
+			row.resize(picked.size());
+			writer.begin(channels); },
+							   [&](time_t time, const std::vector<float> &values)
+							   {
+			if (time < from || time > to || !writer.ok())
+			{
+				return;
+			}
+
+			for (size_t i = 0; i < picked.size(); i++)
+			{
+				row[i] = values[picked[i]];
+			}
+			writer.row(time, row); });
 	}
-	else if (command == "BootIntoRecovery")
+	else
 	{
-		message = this->bootIntoRecovery();
+		const ChannelHistory &log = instance->channelLog;
 
-		if (message.find("Error") != std::string::npos)
+		std::vector<ChannelHistory::Channel> channels;
+		std::vector<size_t> picked;
+		for (auto const &channel : log.channels())
 		{
-			success = false;
+			size_t index = log.find(channel.name);
+			if (index != string::npos && wanted(channel.name))
+			{
+				channels.push_back(channel);
+				picked.push_back(index);
+			}
 		}
-		else
+		writer.begin(channels);
+
+		// full resolution, one row at a time
+		ChannelHistory::Range range = log.range(from, to, 0);
+		std::vector<float> row(picked.size());
+		for (size_t i = range.first; i < range.last && writer.ok(); i++)
 		{
-			xTaskCreate(&this->reboot, "reboot_task", 1024, this, 5, NULL);
+			for (size_t c = 0; c < picked.size(); c++)
+			{
+				row[c] = log.valueAt(picked[c], i);
+			}
+			writer.row(log.timeAt(i), row);
 		}
 	}
 
-	json jResultPayload;
-	jResultPayload["data"] = resultData;
-	jResultPayload["success"] = success;
-
-	if (message != "")
+	if (!writer.flush())
 	{
-		jResultPayload["message"] = message;
+		ESP_LOGW(TAG, "History export aborted, client went away");
+		return ESP_FAIL;
 	}
 
-	string resultPayload = jResultPayload.dump();
-
-	return resultPayload;
+	httpd_resp_send_chunk(req, NULL, 0);
+	return ESP_OK;
 }
 
-httpd_handle_t BrewEngine::startWebserver(void)
+esp_err_t BrewEngine::metricsGetHandler(httpd_req_t *req)
 {
+	BrewEngine *instance = mainInstance;
 
-	httpd_uri_t indexUri;
-	indexUri.uri = "/";
-	indexUri.method = HTTP_GET;
-	indexUri.handler = this->indexGetHandler;
-
-	httpd_uri_t logoUri;
-	logoUri.uri = "/logo.svg";
-	logoUri.method = HTTP_GET;
-	logoUri.handler = this->logoGetHandler;
+	httpd_resp_set_type(req, "text/plain; version=0.0.4");
 
-	httpd_uri_t manifestUri;
-	manifestUri.uri = "/manifest.json";
-	manifestUri.method = HTTP_GET;
-	manifestUri.handler = this->manifestGetHandler;
+	MetricsWriter writer([req](const char *chunk, size_t length)
+						 { return httpd_resp_send_chunk(req, chunk, length) == ESP_OK; });
 
-	httpd_uri_t postUri;
-	postUri.uri = "/api";
-	postUri.method = HTTP_POST;
-	postUri.handler = this->apiPostHandler;
+	writer.family("brew_temperature", "gauge", "Average temperature of the control sensors, in the configured scale.");
+	writer.sample("brew_temperature", instance->temperature);
 
-	httpd_uri_t optionsUri;
-	optionsUri.uri = "/api";
-	optionsUri.method = HTTP_OPTIONS;
-	optionsUri.handler = this->apiOptionsHandler;
+	writer.family("brew_target_temperature", "gauge", "Current target temperature.");
+	writer.sample("brew_target_temperature", instance->targetTemperature);
 
-	httpd_uri_t otherUri;
-	otherUri.uri = "/*";
-	otherUri.method = HTTP_GET;
-	otherUri.handler = this->otherGetHandler;
+	// a family has to be one block, header first, so we go over the sensors once per family
+	writer.family("brew_sensor_temperature", "gauge", "Last temperature per sensor.");
+	for (auto const &[id, sensor] : instance->sensors)
+	{
+		writer.sample("brew_sensor_temperature", "sensor", to_string(id), sensor->lastTemp);
+	}
 
-	httpd_handle_t server = NULL;
-	httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-	// whiout this the esp crashed whitout a proper warning
-	config.stack_size = 20480;
-	config.uri_match_fn = httpd_uri_match_wildcard;
+	writer.family("brew_sensor_connected", "gauge", "1 when the sensor is connected.");
+	for (auto const &[id, sensor] : instance->sensors)
+	{
+		writer.sample("brew_sensor_connected", "sensor", to_string(id), sensor->connected ? 1 : 0);
+	}
 
-	// Start the httpd server
-	ESP_LOGI(TAG, "Starting server on port: '%d'", config.server_port);
-	if (httpd_start(&server, &config) == ESP_OK)
+	writer.family("brew_sensor_errors_total", "counter", "Failed sensor reads since boot.");
+	for (auto const &[id, sensor] : instance->sensors)
 	{
-		// Set URI handlers
-		httpd_register_uri_handler(server, &indexUri);
-		httpd_register_uri_handler(server, &logoUri);
-		httpd_register_uri_handler(server, &manifestUri);
-		httpd_register_uri_handler(server, &otherUri);
-		httpd_register_uri_handler(server, &postUri);
-		httpd_register_uri_handler(server, &optionsUri);
-		return server;
+		writer.sample("brew_sensor_errors_total", "sensor", to_string(id), sensor->errorCount);
 	}
 
-	ESP_LOGI(TAG, "Error starting server!");
-	return NULL;
-}
+	writer.family("brew_running", "gauge", "1 while a schedule is running.");
+	writer.sample("brew_running", instance->controlRun ? 1 : 0);
 
-void BrewEngine::logRemote(const string &message)
-{
-	if (this->mqttEnabled)
+	writer.family("brew_pid_output_percent", "gauge", "Output of the pid controller.");
+	writer.sample("brew_pid_output_percent", instance->pidOutput);
+
+	writer.family("brew_pid_term", "gauge", "Proportional, integral and derivative part of the last pid output.");
+	writer.sample("brew_pid_term", "term", "p", instance->pidP);
+	writer.sample("brew_pid_term", "term", "i", instance->pidI);
+	writer.sample("brew_pid_term", "term", "d", instance->pidD);
+
+	writer.family("brew_heater_duty_percent", "gauge", "Part of the pid loop the heater is on.");
+	for (auto const &heater : instance->heaters)
 	{
-		string iso_datetime = this->to_iso_8601(std::chrono::system_clock::now());
-		json jPayload;
-		jPayload["time"] = iso_datetime;
-		jPayload["level"] = "Debug";
-		jPayload["message"] = message;
-		string payload = jPayload.dump();
+		writer.sample("brew_heater_duty_percent", "heater", heater->name, heater->burnTime);
+	}
 
-		esp_mqtt_client_publish(this->mqttClient, this->mqttTopicLog.c_str(), payload.c_str(), 0, 1, 1);
+	writer.family("brew_heater_energy_joules_total", "counter", "Energy used by the heater since boot.");
+	for (auto const &heater : instance->heaters)
+	{
+		writer.sample("brew_heater_energy_joules_total", "heater", heater->name, heater->energy);
 	}
-}
 
-void BrewEngine::stopWebserver(httpd_handle_t server)
-{
-	// Stop the httpd server
-	httpd_stop(server);
-}
+	writer.family("brew_read_loop_duration_seconds", "histogram", "Time spent reading all sensors.");
+	writer.histogram("brew_read_loop_duration_seconds", instance->readLoopTimes);
 
-esp_err_t BrewEngine::indexGetHandler(httpd_req_t *req)
-{
-	// ESP_LOGI(TAG, "index_get_handler");
-	extern const unsigned char index_html_start[] asm("_binary_index_html_gz_start");
-	extern const unsigned char index_html_end[] asm("_binary_index_html_gz_end");
-	const size_t index_html_size = (index_html_end - index_html_start);
-	httpd_resp_set_type(req, "text/html");
-	httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
-	httpd_resp_send(req, (const char *)index_html_start, index_html_size);
+	writer.family("brew_heap_free_bytes", "gauge", "Free heap.");
+	writer.sample("brew_heap_free_bytes", esp_get_free_heap_size());
 
-	return ESP_OK;
-}
+	writer.family("brew_heap_min_free_bytes", "gauge", "Lowest free heap since boot.");
+	writer.sample("brew_heap_min_free_bytes", esp_get_minimum_free_heap_size());
 
-esp_err_t BrewEngine::logoGetHandler(httpd_req_t *req)
-{
-	extern const unsigned char logo_svg_file_start[] asm("_binary_logo_svg_gz_start");
-	extern const unsigned char logo_svg_file_end[] asm("_binary_logo_svg_gz_end");
-	const size_t logo_svg_file_size = (logo_svg_file_end - logo_svg_file_start);
-	httpd_resp_set_type(req, "image/svg+xml");
-	httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
-	httpd_resp_send(req, (const char *)logo_svg_file_start, logo_svg_file_size);
+	writer.family("brew_task_stack_free_bytes", "gauge", "Lowest free stack of the long running tasks.");
+	writer.sample("brew_task_stack_free_bytes", "task", "httpd", uxTaskGetStackHighWaterMark(NULL));
+	if (instance->readLoopHandle != NULL)
+	{
+		writer.sample("brew_task_stack_free_bytes", "task", "readloop", uxTaskGetStackHighWaterMark(instance->readLoopHandle));
+	}
+	if (instance->notificationLoopHandle != NULL)
+	{
+		writer.sample("brew_task_stack_free_bytes", "task", "notification", uxTaskGetStackHighWaterMark(instance->notificationLoopHandle));
+	}
+	if (instance->jobLoopHandle != NULL)
+	{
+		writer.sample("brew_task_stack_free_bytes", "task", "job", uxTaskGetStackHighWaterMark(instance->jobLoopHandle));
+	}
 
-	return ESP_OK;
-}
+	wifi_ap_record_t apInfo = {};
+	if (esp_wifi_sta_get_ap_info(&apInfo) == ESP_OK)
+	{
+		writer.family("brew_wifi_rssi_dbm", "gauge", "Signal strength of the access point we are connected to.");
+		writer.sample("brew_wifi_rssi_dbm", apInfo.rssi);
+	}
 
-esp_err_t BrewEngine::manifestGetHandler(httpd_req_t *req)
-{
-	extern const unsigned char manifest_json_file_start[] asm("_binary_manifest_json_start");
-	extern const unsigned char manifest_json_file_end[] asm("_binary_manifest_json_end");
-	const size_t manifest_json_file_size = (manifest_json_file_end - manifest_json_file_start);
-	httpd_resp_set_type(req, "application/json");
-	httpd_resp_send(req, (const char *)manifest_json_file_start, manifest_json_file_size);
+	if (instance->mqttEnabled)
+	{
+		writer.family("brew_mqtt_outbox_bytes", "gauge", "Mqtt messages waiting to be sent.");
+		writer.sample("brew_mqtt_outbox_bytes", esp_mqtt_client_get_outbox_size(instance->mqttClient));
+	}
+
+	if (!writer.flush())
+	{
+		ESP_LOGW(TAG, "Sending metrics failed");
+		return ESP_FAIL;
+	}
+
+	httpd_resp_send_chunk(req, NULL, 0);
 
 	return ESP_OK;
 }
 
-esp_err_t BrewEngine::otherGetHandler(httpd_req_t *req)
+// called by httpd for every socket it closes, so a websocket client that leaves is dropped right away
+void BrewEngine::closeSocket(httpd_handle_t hd, int sockfd)
 {
-	httpd_resp_set_status(req, "307 Temporary Redirect");
-	httpd_resp_set_hdr(req, "Location", "/");
-	httpd_resp_send(req, "<html><body>Wrong</body></html>", 0); // Response body can be empty
+	BrewEngine *instance = mainInstance;
 
-	return ESP_OK;
+	instance->telemetryClients.remove(sockfd);
+	instance->telemetryClientCount = instance->telemetryClients.size();
+
+	// with a close_fn set httpd leaves the closing to us
+	close(sockfd);
 }
 
-esp_err_t BrewEngine::apiPostHandler(httpd_req_t *req)
+esp_err_t BrewEngine::eventsHandler(httpd_req_t *req)
 {
-	string stringBuffer;
-	char buf[256];
-	uint32_t ret;
-	uint32_t remaining = req->content_len;
+	// the handshake, from now on we push telemetry to this socket
+	if (req->method == HTTP_GET)
+	{
+		int fd = httpd_req_to_sockfd(req);
+		ESP_LOGI(TAG, "Telemetry client connected: %d", fd);
+
+		mainInstance->telemetryClients.add(fd);
+		mainInstance->telemetryClientCount = mainInstance->telemetryClients.size();
+		mainInstance->telemetryNewClient = true;
+
+		return ESP_OK;
+	}
+
+	// we don't expect anything from clients, but we still need to read the frame
+	httpd_ws_frame_t wsFrame = {};
+	esp_err_t ret = httpd_ws_recv_frame(req, &wsFrame, 0);
 
-	while (remaining > 0)
+	if (ret != ESP_OK)
 	{
-		// Read the data
-		int nBytes = (std::min<uint32_t>)(remaining, sizeof(buf));
+		return ret;
+	}
 
-		if ((ret = httpd_req_recv(req, buf, nBytes)) <= 0)
-		{
-			if (ret == HTTPD_SOCK_ERR_TIMEOUT)
-			{
-				// Timeout, just continue
-				continue;
-			}
+	if (wsFrame.len > 256)
+	{
+		return ESP_FAIL;
+	}
 
-			return ESP_FAIL;
-		}
+	if (wsFrame.len > 0)
+	{
+		uint8_t buf[256];
+		wsFrame.payload = buf;
+		ret = httpd_ws_recv_frame(req, &wsFrame, wsFrame.len);
+	}
 
-		size_t bytes_read = ret;
+	return ret;
+}
 
-		remaining -= bytes_read;
+// encoding named by a content-type or accept header, json when it is missing or unknown
+ApiEncoding BrewEngine::apiEncoding(httpd_req_t *req, const char *header)
+{
+	size_t length = httpd_req_get_hdr_value_len(req, header);
+	if (length == 0)
+	{
+		return JsonEncoding;
+	}
 
-		// append to buffer
-		stringBuffer.append((char *)buf, bytes_read);
+	string value(length + 1, '\0');
+	if (httpd_req_get_hdr_value_str(req, header, value.data(), value.size()) != ESP_OK)
+	{
+		return JsonEncoding;
 	}
 
-	string commandResult = mainInstance->processCommand(stringBuffer);
+	if (value.find("application/msgpack") != string::npos || value.find("application/x-msgpack") != string::npos)
+	{
+		return MessagePackEncoding;
+	}
 
-	const char *returnBuf = commandResult.c_str();
-	httpd_resp_set_type(req, "text/plain");
-	httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-	httpd_resp_sendstr(req, returnBuf);
+	if (value.find("application/cbor") != string::npos)
+	{
+		return CborEncoding;
+	}
 
-	return ESP_OK;
+	return JsonEncoding;
 }
 
 // needed for cors
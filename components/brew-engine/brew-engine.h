@@ -8,11 +8,17 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "freertos/event_groups.h"
 
 #include "esp_log.h"
 #include <esp_http_server.h>
 #include "esp_ota_ops.h"
+#include "esp_wifi.h"
+#include "esp_spiffs.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_random.h"
 #include "driver/gpio.h"
 
 #include <iostream>
@@ -23,7 +29,17 @@
 #include <iomanip>
 #include <ranges>
 #include <map>
+#include <deque>
+#include <set>
+#include <atomic>
+#include <mutex>
 #include <vector>
+#include <array>
+#include <limits>
+#include <algorithm>
+#include <string_view>
+#include <tuple>
+#include <unistd.h>
 
 #include "onewire_bus.h"
 #include "ds18b20.h"
@@ -36,14 +52,42 @@
 
 #include "mash-schedule.h"
 #include "execution-step.h"
+#include "execution-plan.h"
+#include "delayed-start.h"
+#include "eta-predictor.h"
 #include "temperature-sensor.h"
 #include "notification.h"
+#include "tiered-history.h"
+#include "channel-history.h"
+#include "brew-log.h"
+#include "run-checkpoint.h"
+#include "json-writer.h"
+#include "command-result.h"
+#include "command-table.h"
+#include "web-etags.h"
+#include "telemetry-delta.h"
+#include "telemetry-clients.h"
+#include "request-reader.h"
+#include "metrics-writer.h"
+#include "history-export.h"
+#include "schedule-store.h"
 
 #include "settings-manager.h"
+#include "brew-settings.h"
 
 #include "nlohmann_json.hpp"
 
 #define ONEWIRE_MAX_DS18B20 10
+#define API_MAX_REQUEST_SIZE 32768 // largest api body we accept, a big schedule is about 20k
+#define API_MAX_RECV_TIMEOUTS 3    // consecutive receive timeouts before we drop a request
+#define API_MAX_BATCH_COMMANDS 16  // commands in one batched api request
+#define API_JOB_HISTORY 4          // finished jobs we keep for clients to poll
+#define HISTORY_MAX_POINTS 600     // most history samples in one response, more gets downsampled
+#define SCHEDULE_SHIFT_HISTORY 16  // overtime shifts we remember for clients catching up, beyond that they get everything
+#define CHANNEL_LOG_INTERVAL 10    // seconds between samples of the per sensor and output history
+#define BREWLOG_FLUSH_INTERVAL 300 // seconds between writes of the brew log to flash
+#define BREWLOG_MIN_FREE 32768     // bytes we keep free on the log partition for a new brew, older logs are removed for it
+#define CHECKPOINT_INTERVAL 300    // seconds between checkpoints of a running brew when nothing else changed
 
 enum TemperatureScale
 {
@@ -58,12 +102,28 @@ enum BoostStatus
     Rest = 2
 };
 
+// wire format of api requests and responses
+enum ApiEncoding
+{
+    JsonEncoding = 0,
+    MessagePackEncoding = 1,
+    CborEncoding = 2
+};
+
 using namespace std;
 using namespace std::chrono;
 using std::cout;
 using std::endl;
 using json = nlohmann::json;
 
+// one overtime shift of the running schedule, made at version
+struct ScheduleShift
+{
+    uint16_t version;
+    size_t fromStep;
+    seconds extra;
+};
+
 class BrewEngine
 {
 private:
@@ -72,25 +132,51 @@ private:
     static void outputLoop(void *arg);
     static void controlLoop(void *arg);
     static void stirLoop(void *arg);
+    static void delayedStartLoop(void *arg);
     static void reboot(void *arg);
     static void factoryReset(void *arg);
-    static void buzzer(void *arg);
+    static void notificationLoop(void *arg);
+    static void jobLoop(void *arg);
 
     void readTempSensorSettings();
     void detectOnewireTemperatureSensors();
     void initOneWire();
     void initMqtt();
     void initHeaters();
+    void initWebFiles();
+    void initBrewLogStorage();
     void readSystemSettings();
     void readSettings();
-    void saveMashSchedules();
+    void migrateSettings();
+    std::optional<MashSchedule> findMashSchedule(const string &name, bool keep = true);
+    void saveMashSchedule(const string &name);
+    void migrateMashSchedules();
     void setMashSchedule(const json &jSchedule);
-    void savePIDSettings();
-    void saveSystemSettingsJson(const json &config);
+    string saveSystemSettingsJson(const json &config);
+    static auto systemSettingFields();
+    static auto pidSettingFields();
+    template <typename Fields>
+    void readSettingFields(const Fields &fields);
+    template <typename Fields>
+    json settingFieldsToJson(const Fields &fields);
+    template <typename Fields>
+    string saveSettingFields(const json &data, const Fields &fields);
     void addDefaultMash();
     void start();
-    void loadSchedule();
+    void startRunTasks();
+    void readCheckpoint();
+    RunCheckpoint currentCheckpoint();
+    void saveCheckpoint(time_t now);
+    void clearCheckpoint();
+    void checkResume(time_t now);
+    void resume(const RunCheckpoint &checkpoint, time_t now);
+    std::optional<system_clock::time_point> calculateDelayedStart(system_clock::time_point readyBy, float volume);
+    uint mashWattage();
+    float availableHeatUpRate();
+    void updateEta(system_clock::time_point now);
+    void loadSchedule(system_clock::time_point startTime, float startTemperature);
     void recalculateScheduleAfterOverTime();
+    void processNotifications(system_clock::time_point now);
     void stop();
     void logRemote(const string &message);
     void addDefaultHeaters();
@@ -98,51 +184,148 @@ private:
     void saveHeaterSettings(const json &jHeaters);
 
     void saveTempSensorSettings(const json &jTempSensors);
+    void readHistoryChannelSettings();
+    std::vector<ChannelHistory::Channel> historyChannelList();
+    void configureChannelLog();
+    void logChannels(time_t now);
+    void openBrewLog(time_t now);
+    void flushBrewLog();
+    void pruneBrewLogs(size_t needed);
     void startStir(const json &stirConfig);
     void stopStir();
     string bootIntoRecovery();
 
-    string processCommand(const string &payLoad);
+    CommandResult processCommand(json &jCommand);
+    CommandResult runCommand(const string &command, json &data);
+
+    // api commands, looked up by name in findCommand
+    struct Command
+    {
+        std::string_view name;
+        void (BrewEngine::*handler)(json &data, CommandResult &result);
+        bool job = false; // slow commands run on the job task so they don't block the api
+    };
+    static const Command *findCommand(std::string_view name);
+
+    // a queued slow command, jobs run one at a time
+    struct CommandJob
+    {
+        uint16_t id;
+        const Command *command;
+        json data;
+        CommandResult result;
+        std::atomic<bool> done = false;
+    };
+
+    void handleData(json &data, CommandResult &result);
+    void handleGetRunningSchedule(json &data, CommandResult &result);
+    void handleSetTemp(json &data, CommandResult &result);
+    void handleSetOverrideOutput(json &data, CommandResult &result);
+    void handleStart(json &data, CommandResult &result);
+    void handleStartAt(json &data, CommandResult &result);
+    void handleReadyBy(json &data, CommandResult &result);
+    void handleStartStir(json &data, CommandResult &result);
+    void handleStop(json &data, CommandResult &result);
+    void handleStopStir(json &data, CommandResult &result);
+    void handleGetMashSchedules(json &data, CommandResult &result);
+    void handleSaveMashSchedule(json &data, CommandResult &result);
+    void handleSetMashSchedule(json &data, CommandResult &result);
+    void handleDeleteMashSchedule(json &data, CommandResult &result);
+    void handleGetBrewLogs(json &data, CommandResult &result);
+    void handleGetBrewLog(json &data, CommandResult &result);
+    void handleDeleteBrewLog(json &data, CommandResult &result);
+    void handleGetPIDSettings(json &data, CommandResult &result);
+    void handleSavePIDSettings(json &data, CommandResult &result);
+    void handleGetTempSettings(json &data, CommandResult &result);
+    void handleSaveTempSettings(json &data, CommandResult &result);
+    void handleDetectTempSensors(json &data, CommandResult &result);
+    void handleGetHeaterSettings(json &data, CommandResult &result);
+    void handleGetHistory(json &data, CommandResult &result);
+    void handleGetChannelHistory(json &data, CommandResult &result);
+    void handleGetHistoryChannels(json &data, CommandResult &result);
+    void handleSaveHistoryChannels(json &data, CommandResult &result);
+    void handleGetJob(json &data, CommandResult &result);
+    void handleSaveHeaterSettings(json &data, CommandResult &result);
+    void handleGetWifiSettings(json &data, CommandResult &result);
+    void handleSaveWifiSettings(json &data, CommandResult &result);
+    void handleScanWifi(json &data, CommandResult &result);
+    void handleGetSystemSettings(json &data, CommandResult &result);
+    void handleSaveSystemSettings(json &data, CommandResult &result);
+    void handleReboot(json &data, CommandResult &result);
+    void handleFactoryReset(json &data, CommandResult &result);
+    void handleBootIntoRecovery(json &data, CommandResult &result);
+    void delayedStart(json &data, CommandResult &result, bool readyBy);
 
     httpd_handle_t startWebserver(void);
     void stopWebserver(httpd_handle_t server);
+    static esp_err_t sendWebFile(httpd_req_t *req, const unsigned char *start, const unsigned char *end, const char *type, const char *etag, bool gzipped);
+    static bool notModified(httpd_req_t *req, const char *etag);
+    static esp_err_t sendStaticFile(httpd_req_t *req, const char *uri);
+    static const char *mimeType(const string &path);
     static esp_err_t indexGetHandler(httpd_req_t *req);
+    static esp_err_t staticGetHandler(httpd_req_t *req);
     static esp_err_t logoGetHandler(httpd_req_t *req);
     static esp_err_t manifestGetHandler(httpd_req_t *req);
     static esp_err_t otherGetHandler(httpd_req_t *req);
     static esp_err_t apiPostHandler(httpd_req_t *req);
     static esp_err_t apiOptionsHandler(httpd_req_t *req);
+    static ApiEncoding apiEncoding(httpd_req_t *req, const char *header);
+    static esp_err_t eventsHandler(httpd_req_t *req);
+    static void closeSocket(httpd_handle_t hd, int sockfd);
+    static esp_err_t metricsGetHandler(httpd_req_t *req);
+    static esp_err_t historyGetHandler(httpd_req_t *req);
+    static std::optional<string> queryValue(const string &query, const char *key, size_t maxLength = 64);
+
+    // telemetry push
+    json telemetryState();
+    void writeTelemetryState(JsonWriter &writer);
+    void pushTelemetry();
+    static void sendTelemetry(void *arg);
 
     // small helpers
     static string to_iso_8601(std::chrono::time_point<std::chrono::system_clock> t);
 
     SettingsManager *settingsManager;
     httpd_handle_t server;
+    bool webFilesMounted = false; // ui from the www partition, when there is none we serve the embedded one
+    WebEtags webFileEtags;
 
     TemperatureScale temperatureScale = Celsius;
     float temperature = 0;                                         // average temp, we use float beceasue ds18b20_get_temperature returns float, no point in going more percise
     float targetTemperature = 0;                                   // requested temp
     std::optional<float> overrideTargetTemperature = std::nullopt; // manualy overwritten temp
     std::map<uint64_t, float> currentTemperatures;                 // map with last temp for each sensor
-    std::map<time_t, int8_t> tempLog;                              // integer log of averages, only used to show running history on web
+    TieredHistory tempLog;                                         // log of averages, only used to show running history on web
+    ChannelHistory channelLog;                                     // log of each sensor, target and output, channels are set on start
+    std::vector<float> channelValues;                              // values for the next channel sample, kept so logging doesn't allocate
+    time_t lastChannelLogTime = 0;
+    std::map<string, bool> historyChannels;                        // enabled flag per channel name, channels that aren't in it are logged
+    BrewLog brewLog;                                               // channels of each run on flash, only written by the read loop
+    time_t runStartTime = 0;                                       // start of the current run, the brew log of a new run starts a new file
 
     // pid
     uint8_t pidOutput = 0;
     std::optional<int8_t> manualOverrideOutput = std::nullopt;
+    double pidP = 0; // terms of the last pid output, only for metrics
+    double pidI = 0;
+    double pidD = 0;
 
-    double mashkP = 10;
-    double mashkI = 1;
-    double mashkD = 10;
+    double mashkP = BrewSettings::mashkP.defaultValue;
+    double mashkI = BrewSettings::mashkI.defaultValue;
+    double mashkD = BrewSettings::mashkD.defaultValue;
 
-    double boilkP = 10;
-    double boilkI = 2;
-    double boilkD = 2;
+    double boilkP = BrewSettings::boilkP.defaultValue;
+    double boilkI = BrewSettings::boilkI.defaultValue;
+    double boilkD = BrewSettings::boilkD.defaultValue;
 
     uint16_t pidLoopTime = 60; // time in seconds for a full loop,
     bool resetPitTime = false; // bool to reset pit , we do this when out target changes
     float tempMargin = 0.5;    // we don't want to nitpick about 0.5°C, water heating is not that percise
 
-    uint8_t boostModeUntil = 85;
+    uint8_t boostModeUntil = BrewSettings::boostModeUntil.defaultValue;
+
+    float heatUpRate = 0;         // degrees per minute at full mash power, learned while boosting or configured, 0 is unknown
+    bool heatUpRateDirty = false; // learned but not saved yet, we only save on stop to spare the flash
 
     // execution
     bool run = false;
@@ -151,17 +334,35 @@ private:
     bool skipTempLoop = false; // When we are changing temp settings we temporarily need to skip our temp loop
     BoostStatus boostStatus;   // Status of boost
 
+    // delayed start
+    bool delayedStartRun = false;                           // true while waiting to start
+    TaskHandle_t delayedStartHandle = NULL;                 // the waiting task, an older one that sees another handle ends
+    system_clock::time_point delayedStartTime;              // when we will call start
+    std::optional<system_clock::time_point> delayedReadyBy; // when set the start time is recalculated while waiting
+    float delayedStartVolume = 0;                           // liters, only used when no heatUpRate is known
+
     bool inOverTime = false; // when a step time isn't reached we go in overtime, we need this to know that we need recalcualtion
 
+    // resume after reboot, checkpoints are only written and cleared by the read loop
+    RunCheckpoint lastCheckpoint;                              // last one written, to skip writes when nothing changed
+    bool checkpointSaved = false;                              // there is a checkpoint in nvs
+    std::optional<RunCheckpoint> pendingResume = std::nullopt; // interrupted run found at boot, resumed once the clock is set
+
     string statusText = "Idle";
-    std::map<string, MashSchedule *> mashSchedules;
+    // the httpd task changes schedules while the read loop and delayed start use them, both only go through findMashSchedule
+    std::mutex mashSchedulesLock;                 // guards mashSchedules and scheduleStore
+    std::map<string, MashSchedule> mashSchedules; // the ones that are in use, saved ones are read from scheduleStore when needed
+    ScheduleStore scheduleStore;
     string selectedMashScheduleName;
     uint16_t currentMashStep;
 
-    std::map<uint16_t, ExecutionStep *> executionSteps; // calculated real steps
+    ExecutionPlan executionPlan; // calculated real steps
     uint16_t currentExecutionStep = 0;
     uint16_t stepInterval = 60;  // calcualte a substep every x seconds
     uint16_t runningVersion = 0; // we increase our version after recalc, so client can keep uptodate with planning
+    std::deque<ScheduleShift> scheduleShifts; // shifts since the schedule was loaded, newest last
+    EtaPredictor eta;            // predicted completion of the running steps
+    time_t lastPublishedEnd = 0; // last predicted end we sent to mqtt
 
     // IO
     uint8_t gpioHigh = 1;
@@ -176,7 +377,13 @@ private:
 
     uint8_t buzzerTime; // in seconds
 
-    std::deque<Notification *> notifications;
+    std::vector<Notification> notifications; // of the running schedule, copied from it when the plan is made
+    size_t nextNotification = 0;            // notifications are sorted on time, everything before this one is done
+    QueueHandle_t notificationQueue = NULL; // due notifications for the notification task
+
+    QueueHandle_t jobQueue = NULL;  // jobs for the job task
+    std::deque<CommandJob *> jobs; // queued, running and recently finished jobs, only changed by the http task
+    uint16_t lastJobId = 0;
 
     string mqttUri;
 
@@ -185,6 +392,20 @@ private:
     esp_mqtt_client_handle_t mqttClient;
     string mqttTopic = "";
     string mqttTopicLog = "";
+    string mqttTopicNotification = "";
+    string mqttTopicEta = "";
+
+    // telemetry push over websocket
+    TelemetryClients telemetryClients;              // only touched from the httpd task
+    std::atomic<uint8_t> telemetryClientCount = 0;  // so the read loop can skip all work when nobody listens
+    std::atomic<bool> telemetryNewClient = false;   // set by the handler, the next push also serializes the full state
+    TelemetryDelta telemetryDelta;
+
+    // monitoring, tasks that live as long as the engine
+    TaskHandle_t readLoopHandle = NULL;
+    TaskHandle_t notificationLoopHandle = NULL;
+    TaskHandle_t jobLoopHandle = NULL;
+    LoopHistogram readLoopTimes; // time spent reading the sensors each second
 
     // stirring/pumping
     TaskHandle_t stirLoopHandle = NULL;
@@ -0,0 +1,467 @@
+#ifndef _BrewLog_H_
+#define _BrewLog_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <dirent.h>
+#include <functional>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "channel-history.h"
+#include "nlohmann_json.hpp"
+
+using namespace std;
+using json = nlohmann::json;
+
+// Log of a brew on flash, one file per brew so old ones can be listed, read and removed on their own.
+// A file starts with a json header line (schedule, start time, pid settings, channels), followed by blocks of samples.
+// Samples are collected in ram and written a block at a time, so the flash only sees a write every few minutes.
+// A block holds the time and channel values as varints of the difference to the previous sample, it starts from zero
+// so every block can be read without the ones before it. A reboot can cut off the last block, reopening the log for a
+// resumed run first truncates the file to the last complete block so the blocks of the resumed run follow a valid one.
+class BrewLog
+{
+public:
+    BrewLog(size_t blockSize = 1024)
+    {
+        this->block.reserve(blockSize);
+        this->blockSize = blockSize;
+    }
+
+    // where the logs are kept, empty when there is no storage
+    void setDirectory(const string &directory)
+    {
+        this->directory = directory;
+    }
+
+    bool available() const
+    {
+        return !this->directory.empty();
+    }
+
+    bool isOpen() const
+    {
+        return this->start != 0;
+    }
+
+    // start time of the open log, which is also its id
+    time_t id() const
+    {
+        return this->start;
+    }
+
+    time_t lastFlushTime() const
+    {
+        return this->lastFlush;
+    }
+
+    // creates the log, header gets the start time and the enabled channels added
+    // when the log already exists, like for a run resumed after a reboot, we add to it if it has the same channels
+    bool open(time_t start, json header, const std::vector<ChannelHistory::Channel> &channels)
+    {
+        this->close();
+
+        json jChannels = json::array({});
+        this->channels.clear();
+        for (size_t i = 0; i < channels.size(); i++)
+        {
+            if (channels[i].enabled)
+            {
+                jChannels.push_back({{"name", channels[i].name}, {"scale", channels[i].scale}});
+                this->channels.push_back({i, channels[i].scale});
+            }
+        }
+
+        header["start"] = start;
+        header["channels"] = jChannels;
+
+        json existing = this->readHeader(start);
+        if (!existing.empty())
+        {
+            if (existing["channels"] != jChannels)
+            {
+                return false;
+            }
+
+            if (!this->dropCutOffBlock(start, jChannels.size()))
+            {
+                return false;
+            }
+
+            this->start = start;
+            this->lastFlush = start;
+            this->startBlock();
+
+            return true;
+        }
+
+        FILE *file = fopen(this->path(start).c_str(), "wb");
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        string line = header.dump() + "\n";
+        bool written = fwrite(line.data(), 1, line.size(), file) == line.size();
+        fclose(file);
+
+        if (!written)
+        {
+            std::remove(this->path(start).c_str());
+            return false;
+        }
+
+        this->start = start;
+        this->lastFlush = start;
+        this->startBlock();
+
+        return true;
+    }
+
+    // one value for every channel that was passed to open, like ChannelHistory::push
+    // returns false when a full block could not be written
+    bool append(time_t time, const std::vector<float> &values)
+    {
+        if (!this->isOpen())
+        {
+            return false;
+        }
+
+        bool good = true;
+
+        // worst case a sample is a 5 byte time and 3 bytes per value
+        if (this->block.size() + 5 + (3 * this->channels.size()) > this->blockSize)
+        {
+            good = this->flush();
+        }
+
+        if (this->samples == 0)
+        {
+            this->previousTime = this->start;
+            this->previous.assign(this->channels.size(), 0);
+        }
+
+        writeVarint(this->block, (uint32_t)(time - this->previousTime));
+        this->previousTime = time;
+
+        for (size_t c = 0; c < this->channels.size(); c++)
+        {
+            float value = (this->channels[c].index < values.size()) ? values[this->channels[c].index] : NAN;
+            int16_t stored = ChannelHistory::toFixed(value, this->channels[c].scale);
+
+            writeVarint(this->block, zigzag((int32_t)stored - this->previous[c]));
+            this->previous[c] = stored;
+        }
+
+        this->samples++;
+
+        return good;
+    }
+
+    // writes the collected samples, the block is dropped when that fails so a full flash doesn't stall the log
+    bool flush()
+    {
+        if (!this->isOpen() || this->samples == 0)
+        {
+            return true;
+        }
+
+        size_t length = this->block.size() - blockHeaderSize;
+        this->block[0] = blockMagic;
+        this->block[1] = length & 0xFF;
+        this->block[2] = (length >> 8) & 0xFF;
+        this->block[3] = this->samples & 0xFF;
+        this->block[4] = (this->samples >> 8) & 0xFF;
+
+        bool written = false;
+        FILE *file = fopen(this->path(this->start).c_str(), "ab");
+        if (file != nullptr)
+        {
+            written = fwrite(this->block.data(), 1, this->block.size(), file) == this->block.size();
+            fclose(file);
+        }
+
+        this->lastFlush = this->previousTime;
+        this->startBlock();
+
+        return written;
+    }
+
+    void close()
+    {
+        this->flush();
+        this->start = 0;
+    }
+
+    // logs in the directory, oldest first
+    void list(std::function<void(time_t id, size_t size)> output) const
+    {
+        std::vector<std::pair<time_t, size_t>> logs;
+
+        DIR *dir = opendir(this->directory.c_str());
+        if (dir == nullptr)
+        {
+            return;
+        }
+
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != nullptr)
+        {
+            long long id;
+            char extension[5];
+            if (sscanf(entry->d_name, "%lld.%4s", &id, extension) != 2 || string(extension) != "log")
+            {
+                continue;
+            }
+
+            size_t size = 0;
+            FILE *file = fopen(this->path(id).c_str(), "rb");
+            if (file != nullptr)
+            {
+                fseek(file, 0, SEEK_END);
+                size = ftell(file);
+                fclose(file);
+            }
+
+            logs.push_back({(time_t)id, size});
+        }
+        closedir(dir);
+
+        std::sort(logs.begin(), logs.end());
+        for (auto const &[id, size] : logs)
+        {
+            output(id, size);
+        }
+    }
+
+    // json::object() when the log doesn't exist or is damaged
+    json readHeader(time_t id) const
+    {
+        FILE *file = fopen(this->path(id).c_str(), "rb");
+        if (file == nullptr)
+        {
+            return json::object();
+        }
+
+        json header = readHeaderLine(file);
+        fclose(file);
+
+        return header;
+    }
+
+    // reads a log back, output gets the values of the channels in the header in that order, nan for no value
+    bool read(time_t id, std::function<void(const json &header)> outputHeader, std::function<void(time_t time, const std::vector<float> &values)> output) const
+    {
+        FILE *file = fopen(this->path(id).c_str(), "rb");
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        json header = readHeaderLine(file);
+        if (!header.contains("start") || !header.contains("channels"))
+        {
+            fclose(file);
+            return false;
+        }
+
+        outputHeader(header);
+
+        time_t start = header["start"].get<time_t>();
+        std::vector<float> scales;
+        for (auto &channel : header["channels"])
+        {
+            scales.push_back(channel["scale"].get<float>());
+        }
+
+        std::vector<uint8_t> data;
+        std::vector<int16_t> previous(scales.size());
+        std::vector<float> values(scales.size());
+
+        uint16_t count;
+        while (readBlock(file, scales.size(), data, count))
+        {
+            size_t position = 0;
+            time_t time = start;
+            std::fill(previous.begin(), previous.end(), 0);
+
+            for (uint16_t s = 0; s < count; s++)
+            {
+                uint32_t delta;
+                readVarint(data, position, delta);
+                time += delta;
+
+                for (size_t c = 0; c < scales.size(); c++)
+                {
+                    uint32_t encoded;
+                    readVarint(data, position, encoded);
+                    previous[c] = (int16_t)(previous[c] + unzigzag(encoded));
+                    values[c] = (previous[c] == ChannelHistory::missing) ? NAN : (float)previous[c] / scales[c];
+                }
+
+                output(time, values);
+            }
+        }
+
+        fclose(file);
+        return true;
+    }
+
+    bool remove(time_t id) const
+    {
+        if (id == this->start)
+        {
+            return false; // still being written
+        }
+
+        return std::remove(this->path(id).c_str()) == 0;
+    }
+
+protected:
+private:
+    static const uint8_t blockMagic = 0xB1;
+    static const size_t blockHeaderSize = 5; // magic, payload length and sample count
+
+    struct Column
+    {
+        size_t index; // in the channels passed to open
+        uint8_t scale;
+    };
+
+    string path(time_t id) const
+    {
+        return this->directory + "/" + std::to_string((long long)id) + ".log";
+    }
+
+    void startBlock()
+    {
+        this->block.assign(blockHeaderSize, 0);
+        this->samples = 0;
+    }
+
+    // reads the next block, false at the end of the file or when the block is incomplete
+    // a block only counts when its samples decode to exactly its length
+    static bool readBlock(FILE *file, size_t channelCount, std::vector<uint8_t> &data, uint16_t &count)
+    {
+        uint8_t blockHeader[blockHeaderSize];
+        if (fread(blockHeader, 1, blockHeaderSize, file) != blockHeaderSize || blockHeader[0] != blockMagic)
+        {
+            return false;
+        }
+
+        size_t length = blockHeader[1] | (blockHeader[2] << 8);
+        count = blockHeader[3] | (blockHeader[4] << 8);
+
+        data.resize(length);
+        if (fread(data.data(), 1, length, file) != length)
+        {
+            return false;
+        }
+
+        size_t position = 0;
+        uint32_t value;
+        for (size_t v = 0; v < (size_t)count * (1 + channelCount); v++)
+        {
+            if (!readVarint(data, position, value))
+            {
+                return false;
+            }
+        }
+
+        return count > 0 && position == length;
+    }
+
+    // truncates the log after its last complete block, a block cut off by a reboot would hide everything written after it
+    bool dropCutOffBlock(time_t id, size_t channelCount) const
+    {
+        FILE *file = fopen(this->path(id).c_str(), "rb");
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        readHeaderLine(file);
+        long end = ftell(file);
+
+        std::vector<uint8_t> data;
+        uint16_t count;
+        while (readBlock(file, channelCount, data, count))
+        {
+            end = ftell(file);
+        }
+
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fclose(file);
+
+        return end == size || truncate(this->path(id).c_str(), end) == 0;
+    }
+
+    static json readHeaderLine(FILE *file)
+    {
+        string line;
+        int c;
+        while ((c = fgetc(file)) != EOF && c != '\n')
+        {
+            line += (char)c;
+        }
+
+        json header = json::parse(line, nullptr, false);
+        return header.is_object() ? header : json::object();
+    }
+
+    static uint32_t zigzag(int32_t value)
+    {
+        return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    }
+
+    static int32_t unzigzag(uint32_t value)
+    {
+        return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+    }
+
+    static void writeVarint(std::vector<uint8_t> &data, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            data.push_back((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        data.push_back(value);
+    }
+
+    static bool readVarint(const std::vector<uint8_t> &data, size_t &position, uint32_t &value)
+    {
+        value = 0;
+        for (uint8_t shift = 0; shift < 35 && position < data.size(); shift += 7)
+        {
+            uint8_t byte = data[position++];
+            value |= (uint32_t)(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    string directory;
+    size_t blockSize;
+
+    // the open log
+    time_t start = 0;
+    time_t lastFlush = 0;
+    std::vector<Column> channels;
+
+    // block that is being filled
+    std::vector<uint8_t> block;
+    uint16_t samples = 0;
+    time_t previousTime = 0;
+    std::vector<int16_t> previous;
+};
+
+#endif /* _BrewLog_H_ */
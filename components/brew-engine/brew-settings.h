@@ -0,0 +1,55 @@
+#ifndef _BrewSettings_H_
+#define _BrewSettings_H_
+
+#include "sdkconfig.h"
+#include "driver/gpio.h"
+#include "setting.h"
+
+// Everything the brew engine keeps in nvs.
+// Reading, saving, the api and its validation all work from these, a new setting only needs an entry here
+// and a line in the field list of its group in brew-engine.cpp.
+namespace BrewSettings
+{
+#if defined(CONFIG_InvertOutputs)
+    inline constexpr bool defaultInvertOutputs = true;
+#else
+    inline constexpr bool defaultInvertOutputs = false;
+#endif
+
+#if defined(CONFIG_SCALE_FAHRENHEIT)
+    inline constexpr uint8_t defaultTemperatureScale = 1;
+#else
+    inline constexpr uint8_t defaultTemperatureScale = 0;
+#endif
+
+    // system, used from the next boot
+    inline constexpr Setting<uint16_t> onewirePin{"onewirePin", "onewirePin", CONFIG_ONEWIRE, 0, GPIO_NUM_MAX - 1};
+    inline constexpr Setting<uint16_t> stirPin{"stirPin", "stirPin", CONFIG_STIR, 0, GPIO_NUM_MAX - 1};
+    inline constexpr Setting<uint16_t> buzzerPin{"buzzerPin", "buzzerPin", CONFIG_BUZZER, 0, GPIO_NUM_MAX - 1};
+    inline constexpr Setting<uint8_t> buzzerTime{"buzzerTime", "buzzerTime", 2, 0, 60};
+    inline constexpr Setting<bool> invertOutputs{"invertOutputs", "invertOutputs", defaultInvertOutputs};
+    inline constexpr TextSetting mqttUri{"mqttUri", "mqttUri", CONFIG_MQTT_URI, 256};
+    inline constexpr Setting<uint8_t> temperatureScale{"tempScale", "temperatureScale", defaultTemperatureScale, 0, 1}; // 0 Celsius, 1 Fahrenheit
+
+    // pid
+    inline constexpr Setting<double> mashkP{"mashKp", "kP", 10, 0, 1000};
+    inline constexpr Setting<double> mashkI{"mashKi", "kI", 1, 0, 1000};
+    inline constexpr Setting<double> mashkD{"mashKd", "kD", 10, 0, 1000};
+    inline constexpr Setting<double> boilkP{"boilKp", "boilkP", 10, 0, 1000};
+    inline constexpr Setting<double> boilkI{"boilKi", "boilkI", 2, 0, 1000};
+    inline constexpr Setting<double> boilkD{"boilKd", "boilkD", 2, 0, 1000};
+    inline constexpr Setting<uint16_t> pidLoopTime{"pidLoopTime", "pidLoopTime", CONFIG_PID_LOOPTIME, 1, 3600};
+    inline constexpr Setting<uint16_t> stepInterval{"stepInterval", "stepInterval", CONFIG_PID_LOOPTIME, 1, 3600}; // we use same as pidloop time
+    inline constexpr Setting<uint8_t> boostModeUntil{"boostModeUntil", "boostModeUntil", 85, 0, 100};
+    inline constexpr Setting<float> heatUpRate{"heatRate", "heatUpRate", 0, 0, 50}; // degrees per minute, 0 is unknown
+
+    // serialized, each one is saved on its own so it is committed right away
+    inline constexpr BlobSetting scheduleIndex{"schedindex"}; // committed with the schedule record, see schedule-store.h
+    inline constexpr BlobSetting legacySchedules{"mashschedules", Persistence::Immediate}; // all schedules in one, moved to records on boot
+    inline constexpr BlobSetting heaters{"heaters", Persistence::Immediate};
+    inline constexpr BlobSetting tempSensors{"tempsensors", Persistence::Immediate};
+    inline constexpr BlobSetting historyChannels{"histchannels", Persistence::Immediate};
+    inline constexpr BlobSetting checkpoint{"checkpoint", Persistence::Immediate}; // has to survive a power loss
+}
+
+#endif /* _BrewSettings_H_ */
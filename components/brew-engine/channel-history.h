@@ -0,0 +1,252 @@
+#ifndef _ChannelHistory_H_
+#define _ChannelHistory_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ring-index.h"
+
+using namespace std;
+
+// History of several values at once, like the individual sensors, target and outputs.
+// Stored column by column in one block that is allocated once: a time column and per enabled channel a column of
+// 16 bit fixed point values. When it is full the oldest samples are overwritten.
+class ChannelHistory
+{
+public:
+    struct Channel
+    {
+        string name;
+        uint8_t scale; // stored as value * scale, 10 for tenths of a degree, 1 for percentages
+        bool enabled;
+    };
+
+    // a range of samples, read in buckets of every samples so at most maxPoints come out
+    struct Range
+    {
+        size_t first;
+        size_t last;
+        size_t every;
+    };
+
+    static constexpr int16_t missing = std::numeric_limits<int16_t>::min(); // no value, like a disconnected sensor
+
+    // value as it is stored, missing when there is none
+    static int16_t toFixed(float value, uint8_t scale)
+    {
+        if (!std::isfinite(value))
+        {
+            return missing;
+        }
+
+        long scaled = std::lround(value * scale);
+        return (int16_t)std::clamp<long>(scaled, missing + 1, std::numeric_limits<int16_t>::max());
+    }
+
+    // sets the memory budget, also clears
+    void reserve(size_t bytes)
+    {
+        this->block.assign(bytes, 0);
+        this->configure(this->list);
+    }
+
+    // new set of channels, only enabled ones take memory, also clears
+    void configure(const std::vector<Channel> &channels)
+    {
+        this->list = channels;
+        this->columns.clear();
+
+        size_t sampleSize = sizeof(uint32_t);
+        for (size_t i = 0; i < this->list.size(); i++)
+        {
+            if (this->list[i].enabled)
+            {
+                this->columns.push_back(i);
+                sampleSize += sizeof(int16_t);
+            }
+        }
+
+        this->ring.resize(this->block.size() / sampleSize);
+        this->clear();
+    }
+
+    void clear()
+    {
+        this->ring.clear();
+        this->baseTime = 0;
+    }
+
+    bool empty() const
+    {
+        return this->ring.empty();
+    }
+
+    size_t size() const
+    {
+        return this->ring.size();
+    }
+
+    const std::vector<Channel> &channels() const
+    {
+        return this->list;
+    }
+
+    // index in channels(), npos when unknown or not recorded
+    size_t find(std::string_view name) const
+    {
+        for (size_t column : this->columns)
+        {
+            if (this->list[column].name == name)
+            {
+                return column;
+            }
+        }
+        return string::npos;
+    }
+
+    // one value for every channel in channels(), in that order, nan when there is none
+    void push(time_t time, const std::vector<float> &values)
+    {
+        if (this->ring.capacity() == 0)
+        {
+            return;
+        }
+
+        if (this->ring.empty())
+        {
+            this->baseTime = time;
+        }
+
+        size_t position = this->ring.push();
+
+        uint32_t offset = (uint32_t)(time - this->baseTime);
+        std::memcpy(&this->block[position * sizeof(uint32_t)], &offset, sizeof(offset));
+
+        for (size_t c = 0; c < this->columns.size(); c++)
+        {
+            const Channel &channel = this->list[this->columns[c]];
+            float value = (this->columns[c] < values.size()) ? values[this->columns[c]] : NAN;
+            int16_t stored = toFixed(value, channel.scale);
+
+            std::memcpy(&this->block[this->valueOffset(c, position)], &stored, sizeof(stored));
+        }
+    }
+
+    // 0 is the oldest sample
+    time_t timeAt(size_t index) const
+    {
+        uint32_t offset;
+        std::memcpy(&offset, &this->block[this->ring.position(index) * sizeof(uint32_t)], sizeof(offset));
+        return this->baseTime + offset;
+    }
+
+    // nan when the channel had no value
+    float valueAt(size_t channel, size_t index) const
+    {
+        for (size_t c = 0; c < this->columns.size(); c++)
+        {
+            if (this->columns[c] == channel)
+            {
+                return this->read(c, this->ring.position(index));
+            }
+        }
+        return NAN;
+    }
+
+    // samples between from and to, in buckets so no more than maxPoints come out
+    Range range(time_t from, time_t to, size_t maxPoints) const
+    {
+        Range range;
+        range.first = (from > 0) ? this->indexAfter(from - 1) : 0;
+        range.last = std::max(this->indexAfter(to), range.first);
+
+        size_t count = range.last - range.first;
+        range.every = (maxPoints > 0 && count > maxPoints) ? (count + maxPoints - 1) / maxPoints : 1;
+
+        return range;
+    }
+
+    // time of the first sample in each bucket
+    void times(const Range &range, std::function<void(time_t time)> output) const
+    {
+        for (size_t i = range.first; i < range.last; i += range.every)
+        {
+            output(this->timeAt(i));
+        }
+    }
+
+    // average of each bucket, nan when none of its samples had a value
+    void values(size_t channel, const Range &range, std::function<void(float value)> output) const
+    {
+        size_t column = std::find(this->columns.begin(), this->columns.end(), channel) - this->columns.begin();
+        if (column == this->columns.size())
+        {
+            return;
+        }
+
+        float scale = this->list[channel].scale;
+
+        for (size_t i = range.first; i < range.last; i += range.every)
+        {
+            size_t end = std::min(i + range.every, range.last);
+
+            int32_t sum = 0;
+            uint32_t found = 0;
+            for (size_t j = i; j < end; j++)
+            {
+                int16_t value = this->raw(column, this->ring.position(j));
+                if (value != missing)
+                {
+                    sum += value;
+                    found++;
+                }
+            }
+
+            output((found > 0) ? (float)sum / found / scale : NAN);
+        }
+    }
+
+protected:
+private:
+    // the time column comes first, then one column per enabled channel
+    size_t valueOffset(size_t column, size_t position) const
+    {
+        size_t capacity = this->ring.capacity();
+        return (capacity * sizeof(uint32_t)) + (((column * capacity) + position) * sizeof(int16_t));
+    }
+
+    int16_t raw(size_t column, size_t position) const
+    {
+        int16_t value;
+        std::memcpy(&value, &this->block[this->valueOffset(column, position)], sizeof(value));
+        return value;
+    }
+
+    float read(size_t column, size_t position) const
+    {
+        int16_t value = this->raw(column, position);
+        return (value == missing) ? NAN : (float)value / this->list[this->columns[column]].scale;
+    }
+
+    // first sample that is newer than time, size() when there is none
+    size_t indexAfter(time_t time) const
+    {
+        return firstAfter(this->ring.size(), time, [this](size_t index)
+                          { return this->timeAt(index); });
+    }
+
+    std::vector<uint8_t> block;
+    std::vector<Channel> list;
+    std::vector<size_t> columns; // channel index of each stored column
+    RingIndex ring;
+    time_t baseTime = 0;
+};
+
+#endif /* _ChannelHistory_H_ */
@@ -0,0 +1,64 @@
+#ifndef _ChunkedOutput_H_
+#define _ChunkedOutput_H_
+
+#include <cstddef>
+#include <functional>
+#include <string_view>
+
+using namespace std;
+
+// Collects small writes in a buffer and hands them to the output in chunks, like httpd_resp_send_chunk.
+// After the output failed once everything else is dropped, the writers built on it only have to check at the end.
+class ChunkedOutput
+{
+public:
+    ChunkedOutput() = default;
+
+    ChunkedOutput(std::function<bool(const char *data, size_t length)> output)
+    {
+        this->output = output;
+    }
+
+    void writeChar(char c)
+    {
+        if (this->used == sizeof(this->buffer))
+        {
+            this->flush();
+        }
+        this->buffer[this->used++] = c;
+    }
+
+    void write(std::string_view text)
+    {
+        for (char c : text)
+        {
+            this->writeChar(c);
+        }
+    }
+
+    // sends what is left in the buffer, returns false when the output failed at some point
+    bool flush()
+    {
+        if (this->used > 0 && this->good)
+        {
+            this->good = this->output(this->buffer, this->used);
+        }
+        this->used = 0;
+
+        return this->good;
+    }
+
+    bool ok() const
+    {
+        return this->good;
+    }
+
+protected:
+private:
+    std::function<bool(const char *data, size_t length)> output;
+    char buffer[512];
+    size_t used = 0;
+    bool good = true;
+};
+
+#endif /* _ChunkedOutput_H_ */
@@ -0,0 +1,99 @@
+#ifndef _CommandResult_H_
+#define _CommandResult_H_
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+#include "nlohmann_json.hpp"
+#include "json-writer.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+// result of an api command, wrapped in the response payload
+struct CommandResult
+{
+    json data = {};
+    std::function<void(JsonWriter &writer)> writeData; // when set, data is streamed by this instead of serialized from data
+    string message = "";
+    bool success = true;
+    std::optional<uint16_t> jobId = std::nullopt; // the command runs as a job, poll GetJob with this for the real result
+
+    // serializes streamed data now, it no longer shows what later commands change
+    void materialize()
+    {
+        if (!this->writeData)
+        {
+            return;
+        }
+
+        string serialized;
+        JsonWriter writer([&serialized](const char *chunk, size_t length)
+                          {
+            serialized.append(chunk, length);
+            return true; });
+        this->writeData(writer);
+        writer.flush();
+
+        this->writeData = [serialized = std::move(serialized)](JsonWriter &writer)
+        { writer.raw(serialized); };
+    }
+
+    void write(JsonWriter &writer)
+    {
+        writer.beginObject();
+
+        writer.key("data");
+        if (this->writeData)
+        {
+            this->writeData(writer);
+        }
+        else
+        {
+            writer.raw(this->data.dump());
+        }
+
+        writer.key("success");
+        writer.value(this->success);
+
+        if (this->jobId.has_value())
+        {
+            writer.key("jobId");
+            writer.value(this->jobId.value());
+        }
+
+        if (this->message != "")
+        {
+            writer.key("message");
+            writer.value(this->message);
+        }
+
+        writer.endObject();
+    }
+};
+
+// runs a request, one command or an array of them with the results in the same order
+// each result of a batch shows the state right after its own command, so streamed ones are serialized before the next command runs
+inline std::vector<CommandResult> runCommands(json &jCommand, std::function<CommandResult(json &jCommand)> process)
+{
+    std::vector<CommandResult> results;
+
+    if (!jCommand.is_array())
+    {
+        results.push_back(process(jCommand));
+        return results;
+    }
+
+    results.reserve(jCommand.size());
+    for (auto &jBatchCommand : jCommand)
+    {
+        results.push_back(process(jBatchCommand));
+        results.back().materialize();
+    }
+
+    return results;
+}
+
+#endif /* _CommandResult_H_ */
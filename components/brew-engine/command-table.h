@@ -0,0 +1,59 @@
+#ifndef _CommandTable_H_
+#define _CommandTable_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+using namespace std;
+
+namespace CommandTableSchema
+{
+    // not constexpr and never defined, a table that calls it doesn't compile
+    void commandsAreNotSortedOnName();
+}
+
+// Commands looked up by name with a binary search, Command needs a string_view name.
+// The table is built at compile time, one that isn't sorted on name or has a name twice doesn't compile.
+template <typename Command, size_t N>
+class CommandTable
+{
+public:
+    consteval CommandTable(std::array<Command, N> commands)
+        : commands(commands)
+    {
+        for (size_t i = 1; i < N; i++)
+        {
+            if (!(commands[i - 1].name < commands[i].name))
+            {
+                CommandTableSchema::commandsAreNotSortedOnName();
+            }
+        }
+    }
+
+    // nullptr when there is no command with this name
+    constexpr const Command *find(std::string_view name) const
+    {
+        auto it = std::lower_bound(this->commands.begin(), this->commands.end(), name, [](const Command &c, std::string_view n)
+                                   { return c.name < n; });
+
+        if (it == this->commands.end() || it->name != name)
+        {
+            return nullptr;
+        }
+
+        return &(*it);
+    }
+
+    constexpr const std::array<Command, N> &all() const
+    {
+        return this->commands;
+    }
+
+protected:
+private:
+    std::array<Command, N> commands;
+};
+
+#endif /* _CommandTable_H_ */
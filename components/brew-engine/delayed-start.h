@@ -0,0 +1,39 @@
+#ifndef _DelayedStart_H_
+#define _DelayedStart_H_
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace std;
+
+// When a delayed start has to begin heating so the first step is reached by the time it should be ready
+class DelayedStart
+{
+public:
+    // what heaters of this wattage do to this volume of water when nothing is learned yet, water needs 4186 J per liter per degree
+    static float estimatedRate(uint32_t watt, float volume)
+    {
+        if (watt == 0 || volume <= 0)
+        {
+            return 0;
+        }
+
+        return ((float)watt * 60) / (volume * 4186);
+    }
+
+    // minutes to give the heat up before a delayed start has to be ready, the first step takes at least its step time
+    static float heatUpMinutes(float temperature, float target, float degreesPerMinute, int stepTime)
+    {
+        float degreesToGo = std::max(target - temperature, 0.0f);
+
+        // we take 10% and 5 minutes extra for losses and the pid slowing down near target, better a bit early then late
+        float minutes = ((degreesToGo / degreesPerMinute) * 1.1) + 5;
+
+        return std::max(minutes, (float)stepTime);
+    }
+
+protected:
+private:
+};
+
+#endif /* _DelayedStart_H_ */
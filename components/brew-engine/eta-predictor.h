@@ -0,0 +1,127 @@
+#ifndef _EtaPredictor_H_
+#define _EtaPredictor_H_
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "nlohmann_json.hpp"
+#include "json-writer.h"
+#include "execution-plan.h"
+
+using namespace std;
+using namespace std::chrono;
+using json = nlohmann::json;
+
+// Predicts when the remaining steps will really be done, planned times go stale once a ramp falls behind
+class EtaPredictor
+{
+public:
+    std::vector<system_clock::time_point> stepTimes; // predicted completion per execution step
+    system_clock::time_point endTime;
+
+    void clear()
+    {
+        this->stepTimes.clear();
+        this->endTime = system_clock::time_point();
+    }
+
+    // forward simulates the steps from currentStep on, degreesPerMinute is what the available wattage can do, 0 when unknown
+    void update(const ExecutionPlan &plan, size_t currentStep, system_clock::time_point now, float temperature, float degreesPerMinute, float tempMargin)
+    {
+        if (plan.empty())
+        {
+            this->clear();
+            return;
+        }
+
+        // done steps keep their last prediction, so we only fill them once
+        if (this->stepTimes.size() != plan.size())
+        {
+            this->stepTimes.resize(plan.size());
+            for (size_t i = 0; i < plan.size(); i++)
+            {
+                this->stepTimes[i] = plan.timeOf(i);
+            }
+        }
+
+        system_clock::time_point simTime = now;
+        float simTemperature = temperature;
+        auto delay = seconds(0);
+
+        for (size_t i = currentStep; i < plan.size(); i++)
+        {
+            const ExecutionStep &step = plan.at(i);
+
+            system_clock::time_point planned = plan.timeOf(i) + delay;
+            if (planned < simTime)
+            {
+                planned = simTime;
+            }
+
+            // the pid follows the target, so we heat at most at full power until we get there
+            float reachable = step.temperature;
+            if (degreesPerMinute > 0 && step.temperature > simTemperature)
+            {
+                float minutes = (float)duration_cast<seconds>(planned - simTime).count() / 60;
+                reachable = std::min(step.temperature, simTemperature + (degreesPerMinute * minutes));
+            }
+
+            system_clock::time_point done = planned;
+
+            // only extended steps wait for the temperature, others just move on
+            if (step.extendIfNeeded && degreesPerMinute > 0 && (step.temperature - reachable) >= tempMargin)
+            {
+                float extraMinutes = (step.temperature - tempMargin - reachable) / degreesPerMinute;
+                done = planned + seconds((int)(extraMinutes * 60));
+                reachable = step.temperature;
+            }
+
+            delay = duration_cast<seconds>(done - plan.timeOf(i));
+            if (delay < seconds(0))
+            {
+                delay = seconds(0);
+            }
+
+            this->stepTimes[i] = done;
+            simTime = done;
+            simTemperature = reachable;
+        }
+
+        this->endTime = this->stepTimes.back();
+    }
+
+    json to_json()
+    {
+        json jSteps = json::array({});
+        for (auto const &time : this->stepTimes)
+        {
+            jSteps.push_back(duration_cast<seconds>(time.time_since_epoch()).count());
+        }
+
+        json jEta;
+        jEta["steps"] = jSteps;
+        jEta["end"] = duration_cast<seconds>(this->endTime.time_since_epoch()).count();
+
+        return jEta;
+    }
+
+    void write(JsonWriter &writer) const
+    {
+        writer.beginObject();
+        writer.key("steps");
+        writer.beginArray();
+        for (auto const &time : this->stepTimes)
+        {
+            writer.value(duration_cast<seconds>(time.time_since_epoch()).count());
+        }
+        writer.endArray();
+        writer.key("end");
+        writer.value(duration_cast<seconds>(this->endTime.time_since_epoch()).count());
+        writer.endObject();
+    }
+
+protected:
+private:
+};
+
+#endif /* _EtaPredictor_H_ */
@@ -0,0 +1,142 @@
+#ifndef _ExecutionPlan_H_
+#define _ExecutionPlan_H_
+
+#include <chrono>
+#include <functional>
+#include <vector>
+#include "json-writer.h"
+#include "execution-step.h"
+#include "ring-index.h"
+
+using namespace std;
+using namespace std::chrono;
+
+// Flat, contiguous list of calculated steps.
+// Step times are kept as planned at load, overtime is applied as an offset on top so we never have to rewrite the plan.
+class ExecutionPlan
+{
+public:
+    void clear()
+    {
+        this->steps.clear();
+        this->shifts.clear();
+        this->totalOffset = seconds(0);
+    }
+
+    void push_back(const ExecutionStep &step)
+    {
+        this->steps.push_back(step);
+    }
+
+    size_t size() const
+    {
+        return this->steps.size();
+    }
+
+    bool empty() const
+    {
+        return this->steps.empty();
+    }
+
+    const ExecutionStep &at(size_t index) const
+    {
+        return this->steps.at(index);
+    }
+
+    // time of a step including all overtime that happened before or at it
+    system_clock::time_point timeOf(size_t index) const
+    {
+        return this->steps[index].time + this->offsetOf(index);
+    }
+
+    // total overtime so far, applies to the current and all following steps
+    seconds offset() const
+    {
+        return this->totalOffset;
+    }
+
+    // moves a step and everything after it, overtime only moves forward so this is an append
+    void shift(size_t fromIndex, seconds extra)
+    {
+        this->totalOffset += extra;
+
+        if (!this->shifts.empty() && this->shifts.back().fromIndex >= fromIndex)
+        {
+            // same step went into overtime again, just accumulate
+            this->shifts.back().offset = this->totalOffset;
+            return;
+        }
+
+        this->shifts.push_back({fromIndex, this->totalOffset});
+    }
+
+    // every shift as the step it starts at and the time it added, in order, so they can be stored and replayed with shift
+    void eachShift(std::function<void(size_t fromIndex, seconds extra)> output) const
+    {
+        seconds previous = seconds(0);
+        for (auto const &shift : this->shifts)
+        {
+            output(shift.fromIndex, shift.offset - previous);
+            previous = shift.offset;
+        }
+    }
+
+    // first step that is planned after the given time, size() when there is none
+    size_t indexAfter(system_clock::time_point time) const
+    {
+        return firstAfter(this->steps.size(), time, [this](size_t index)
+                          { return this->timeOf(index); });
+    }
+
+    void write(JsonWriter &writer) const
+    {
+        writer.beginArray();
+
+        size_t shiftIndex = 0;
+        seconds offset = seconds(0);
+
+        for (size_t i = 0; i < this->steps.size(); i++)
+        {
+            // shifts are sorted on step, so we can walk them along with the steps
+            while (shiftIndex < this->shifts.size() && this->shifts[shiftIndex].fromIndex <= i)
+            {
+                offset = this->shifts[shiftIndex].offset;
+                shiftIndex++;
+            }
+
+            this->steps[i].write(writer, offset);
+        }
+
+        writer.endArray();
+    }
+
+protected:
+private:
+    struct Shift
+    {
+        size_t fromIndex;
+        seconds offset; // accumulated offset from this step on
+    };
+
+    seconds offsetOf(size_t index) const
+    {
+        // last shift that starts at or before index, there are only as many shifts as overtimes so this stays tiny
+        seconds offset = seconds(0);
+        for (auto const &shift : this->shifts)
+        {
+            if (shift.fromIndex > index)
+            {
+                break;
+            }
+            offset = shift.offset;
+        }
+
+        return offset;
+    }
+
+    std::vector<ExecutionStep> steps;
+    std::vector<Shift> shifts;
+    seconds totalOffset = seconds(0);
+};
+
+#endif /* _ExecutionPlan_H_ */
@@ -2,31 +2,33 @@
 #define _ExecutionStep_H_
 
 #include <chrono>
-#include "nlohmann_json.hpp"
+#include "json-writer.h"
 
 using namespace std;
 using namespace std::chrono;
-using json = nlohmann::json;
 
 class ExecutionStep
 {
 public:
     system_clock::time_point time;
-    float temperature;
-    bool extendIfNeeded;
-    bool allowBoost;
+    float temperature = 0;
+    bool extendIfNeeded = false;
+    bool allowBoost = false;
 
-    json to_json()
+    void write(JsonWriter &writer, std::chrono::seconds offset = std::chrono::seconds(0)) const
     {
-        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(this->time.time_since_epoch()).count();
-
-        json jStep;
-        jStep["temperature"] = this->temperature;
-        jStep["time"] = seconds;
-        jStep["extendIfNeeded"] = this->extendIfNeeded;
-        jStep["allowBoost"] = this->allowBoost;
-
-        return jStep;
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(this->time.time_since_epoch() + offset).count();
+
+        writer.beginObject();
+        writer.key("temperature");
+        writer.value(this->temperature);
+        writer.key("time");
+        writer.value(seconds);
+        writer.key("extendIfNeeded");
+        writer.value(this->extendIfNeeded);
+        writer.key("allowBoost");
+        writer.value(this->allowBoost);
+        writer.endObject();
     };
 
 protected:
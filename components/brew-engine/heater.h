@@ -19,6 +19,7 @@ public:
     uint8_t burnTime; // runtime burn Time flag, doesn't go to json, in %
     bool burn;        // runtime burn flag true means burn now
     bool enabled;     // runtime flag to make it easyer to filter in loops, is set based on mode and mash/boil
+    uint64_t energy = 0; // runtime, joules used since boot, doesn't go to json
 
     json to_json()
     {
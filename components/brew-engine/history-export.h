@@ -0,0 +1,127 @@
+#ifndef _HistoryExport_H_
+#define _HistoryExport_H_
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "channel-history.h"
+#include "chunked-output.h"
+
+using namespace std;
+
+// Writes history rows as csv or a compact binary format straight to an output in small chunks,
+// so an export takes the same memory no matter how long the range is.
+// Binary is "BRWH", version, channel count, per channel a length prefixed name and its scale,
+// then per row the time as uint32 and per channel the int16 fixed point value (value * scale, -32768 for none), all little endian.
+class HistoryExport
+{
+public:
+    enum Format
+    {
+        Csv = 0,
+        Binary = 1
+    };
+
+    HistoryExport(Format format, std::function<bool(const char *data, size_t length)> output)
+    {
+        this->format = format;
+        this->out = ChunkedOutput(output);
+    }
+
+    void begin(const std::vector<ChannelHistory::Channel> &channels)
+    {
+        this->scales.clear();
+        for (auto const &channel : channels)
+        {
+            this->scales.push_back(channel.scale);
+        }
+
+        if (this->format == Csv)
+        {
+            this->out.write("time");
+            for (auto const &channel : channels)
+            {
+                this->out.writeChar(',');
+                this->out.write(channel.name);
+            }
+            this->out.writeChar('\n');
+            return;
+        }
+
+        this->out.write("BRWH");
+        this->out.writeChar(1);
+        this->out.writeChar((char)channels.size());
+        for (auto const &channel : channels)
+        {
+            std::string_view name = std::string_view(channel.name).substr(0, 255);
+            this->out.writeChar((char)name.size());
+            this->out.write(name);
+            this->out.writeChar((char)channel.scale);
+        }
+    }
+
+    // values in the order of the channels passed to begin, nan for none
+    void row(time_t time, const std::vector<float> &values)
+    {
+        if (this->format == Csv)
+        {
+            char chars[24];
+            int length = snprintf(chars, sizeof(chars), "%lld", (long long)time);
+            this->out.write(std::string_view(chars, length));
+
+            for (size_t i = 0; i < this->scales.size(); i++)
+            {
+                this->out.writeChar(',');
+
+                float value = (i < values.size()) ? values[i] : NAN;
+                if (std::isfinite(value))
+                {
+                    // as many decimals as are stored
+                    length = snprintf(chars, sizeof(chars), "%.*f", this->scales[i] >= 10 ? 1 : 0, value);
+                    this->out.write(std::string_view(chars, length));
+                }
+            }
+            this->out.writeChar('\n');
+            return;
+        }
+
+        uint32_t seconds = (uint32_t)time;
+        for (uint8_t shift = 0; shift < 32; shift += 8)
+        {
+            this->out.writeChar((char)((seconds >> shift) & 0xFF));
+        }
+
+        for (size_t i = 0; i < this->scales.size(); i++)
+        {
+            float value = (i < values.size()) ? values[i] : NAN;
+            uint16_t stored = (uint16_t)ChannelHistory::toFixed(value, this->scales[i]);
+            this->out.writeChar((char)(stored & 0xFF));
+            this->out.writeChar((char)(stored >> 8));
+        }
+    }
+
+    // sends what is left in the buffer, returns false when the output failed at some point
+    bool flush()
+    {
+        return this->out.flush();
+    }
+
+    bool ok() const
+    {
+        return this->out.ok();
+    }
+
+protected:
+private:
+    Format format;
+    std::vector<uint8_t> scales;
+
+    ChunkedOutput out;
+};
+
+#endif /* _HistoryExport_H_ */
@@ -0,0 +1,305 @@
+#ifndef _JsonWriter_H_
+#define _JsonWriter_H_
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <concepts>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "nlohmann_json.hpp"
+#include "chunked-output.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+// Writes json straight to an output in small chunks, so big responses never have to exist in memory as a whole.
+// Output is a callback so it can go to a socket (httpd_resp_send_chunk) or a string.
+// It can also build a json value instead, for encodings that need the whole document like msgpack.
+class JsonWriter
+{
+public:
+    JsonWriter(std::function<bool(const char *data, size_t length)> output)
+    {
+        this->out = ChunkedOutput(output);
+    }
+
+    JsonWriter(json &target)
+    {
+        this->target = &target;
+    }
+
+    void beginObject()
+    {
+        if (this->target != nullptr)
+        {
+            this->containers.push_back(this->add(json::object()));
+            return;
+        }
+
+        this->separator();
+        this->out.writeChar('{');
+        this->push();
+    }
+
+    void endObject()
+    {
+        if (this->target != nullptr)
+        {
+            this->containers.pop_back();
+            return;
+        }
+
+        this->depth--;
+        this->out.writeChar('}');
+    }
+
+    void beginArray()
+    {
+        if (this->target != nullptr)
+        {
+            this->containers.push_back(this->add(json::array()));
+            return;
+        }
+
+        this->separator();
+        this->out.writeChar('[');
+        this->push();
+    }
+
+    void endArray()
+    {
+        if (this->target != nullptr)
+        {
+            this->containers.pop_back();
+            return;
+        }
+
+        this->depth--;
+        this->out.writeChar(']');
+    }
+
+    void key(std::string_view name)
+    {
+        if (this->target != nullptr)
+        {
+            this->pendingKey = name;
+            return;
+        }
+
+        this->separator();
+        this->writeString(name);
+        this->out.writeChar(':');
+        this->afterKey = true;
+    }
+
+    void value(std::string_view text)
+    {
+        if (this->target != nullptr)
+        {
+            this->add(string(text));
+            return;
+        }
+
+        this->separator();
+        this->writeString(text);
+    }
+
+    void value(const char *text)
+    {
+        this->value(std::string_view(text));
+    }
+
+    void value(bool boolean)
+    {
+        if (this->target != nullptr)
+        {
+            this->add(boolean);
+            return;
+        }
+
+        this->separator();
+        this->out.write(boolean ? "true" : "false");
+    }
+
+    template <std::integral T>
+    void value(T number)
+    {
+        if (this->target != nullptr)
+        {
+            this->add(number);
+            return;
+        }
+
+        this->separator();
+        char chars[24];
+        auto result = std::to_chars(chars, chars + sizeof(chars), number);
+        this->out.write(std::string_view(chars, result.ptr - chars));
+    }
+
+    template <std::floating_point T>
+    void value(T number)
+    {
+        // json has no nan or inf
+        if (!std::isfinite(number))
+        {
+            this->null();
+            return;
+        }
+
+        if (this->target != nullptr)
+        {
+            this->add(number);
+            return;
+        }
+
+        this->separator();
+
+        char chars[32];
+        auto result = std::to_chars(chars, chars + sizeof(chars), number);
+        this->out.write(std::string_view(chars, result.ptr - chars));
+    }
+
+    void null()
+    {
+        if (this->target != nullptr)
+        {
+            this->add(nullptr);
+            return;
+        }
+
+        this->separator();
+        this->out.write("null");
+    }
+
+    // an already serialized json value
+    void raw(std::string_view serialized)
+    {
+        if (this->target != nullptr)
+        {
+            this->add(json::parse(serialized));
+            return;
+        }
+
+        this->separator();
+        this->out.write(serialized);
+    }
+
+    // sends what is left in the buffer, returns false when the output failed at some point
+    bool flush()
+    {
+        return this->out.flush();
+    }
+
+    bool ok() const
+    {
+        return this->out.ok();
+    }
+
+protected:
+private:
+    static const uint8_t maxDepth = 32;
+
+    // places a value in the innermost open container, we only ever add to that one so the pointers stay valid
+    json *add(json value)
+    {
+        if (this->containers.empty())
+        {
+            *this->target = std::move(value);
+            return this->target;
+        }
+
+        json *container = this->containers.back();
+        if (container->is_object())
+        {
+            json &added = (*container)[this->pendingKey];
+            added = std::move(value);
+            return &added;
+        }
+
+        container->push_back(std::move(value));
+        return &container->back();
+    }
+
+    void push()
+    {
+        if (this->depth < maxDepth)
+        {
+            this->hasItems[this->depth] = false;
+        }
+        this->depth++;
+    }
+
+    // a comma before every item except the first, nothing after a key
+    void separator()
+    {
+        if (this->afterKey)
+        {
+            this->afterKey = false;
+            return;
+        }
+
+        if (this->depth > 0 && this->depth <= maxDepth)
+        {
+            if (this->hasItems[this->depth - 1])
+            {
+                this->out.writeChar(',');
+            }
+            this->hasItems[this->depth - 1] = true;
+        }
+    }
+
+    void writeString(std::string_view text)
+    {
+        this->out.writeChar('"');
+
+        for (char c : text)
+        {
+            switch (c)
+            {
+            case '"':
+                this->out.write("\\\"");
+                break;
+            case '\\':
+                this->out.write("\\\\");
+                break;
+            case '\n':
+                this->out.write("\\n");
+                break;
+            case '\r':
+                this->out.write("\\r");
+                break;
+            case '\t':
+                this->out.write("\\t");
+                break;
+            default:
+                if ((unsigned char)c < 0x20)
+                {
+                    char escaped[7];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+                    this->out.write(escaped);
+                }
+                else
+                {
+                    this->out.writeChar(c);
+                }
+            }
+        }
+
+        this->out.writeChar('"');
+    }
+
+    ChunkedOutput out; // unused when building a json value
+
+    bool hasItems[maxDepth];
+    uint8_t depth = 0;
+    bool afterKey = false;
+
+    json *target = nullptr;
+    std::vector<json *> containers;
+    string pendingKey;
+};
+
+#endif /* _JsonWriter_H_ */
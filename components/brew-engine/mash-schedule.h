@@ -1,7 +1,8 @@
 #ifndef _MashSchedule_H_
 #define _MashSchedule_H_
 
-#include <deque>
+#include <algorithm>
+#include <vector>
 #include "nlohmann_json.hpp"
 #include "mash-step.h"
 #include "notification.h"
@@ -9,14 +10,15 @@
 using namespace std;
 using json = nlohmann::json;
 
+// Steps and notifications are kept by value, so a schedule is a few allocations that are released together with it.
 class MashSchedule
 {
 public:
     string name;
-    bool boil;      // if true boil else mash
-    bool temporary; // will not be saved to flash
-    std::deque<MashStep *> steps;
-    std::deque<Notification *> notifications;
+    bool boil = false;      // if true boil else mash
+    bool temporary = false; // will not be saved to flash
+    std::vector<MashStep> steps;
+    std::vector<Notification> notifications;
 
     json to_json()
     {
@@ -30,18 +32,18 @@ public:
 
         json jSteps = json::array({});
 
-        for (auto const &step : this->steps)
+        for (auto &step : this->steps)
         {
-            json jStep = step->to_json();
+            json jStep = step.to_json();
             jSteps.push_back(jStep);
         }
 
         jSchedule["steps"] = jSteps;
 
         json jNotifications = json::array({});
-        for (auto const &notification : this->notifications)
+        for (auto &notification : this->notifications)
         {
-            json jNotification = notification->to_json();
+            json jNotification = notification.to_json();
             jNotifications.push_back(jNotification);
         }
 
@@ -72,28 +74,27 @@ public:
             this->temporary = false;
         }
 
-        json steps = jsonData["steps"];
+        const json &steps = jsonData["steps"];
 
-        for (auto &el : steps.items())
+        this->steps.clear();
+        this->steps.reserve(steps.size());
+        for (auto &jStep : steps)
         {
-            auto jStep = el.value();
-
-            auto step = new MashStep();
-            step->from_json(jStep);
-            this->steps.push_back(step);
+            MashStep &step = this->steps.emplace_back();
+            step.from_json(jStep);
         }
 
-        json notifications = jsonData["notifications"];
+        this->notifications.clear();
 
-        if (notifications.is_array())
+        if (jsonData.contains("notifications") && jsonData["notifications"].is_array())
         {
-            for (auto &el : notifications.items())
-            {
-                auto jNotification = el.value();
+            const json &notifications = jsonData["notifications"];
 
-                auto notification = new Notification();
-                notification->from_json(jNotification);
-                this->notifications.push_back(notification);
+            this->notifications.reserve(notifications.size());
+            for (auto &jNotification : notifications)
+            {
+                Notification &notification = this->notifications.emplace_back();
+                notification.from_json(jNotification);
             }
         }
     };
@@ -101,15 +102,15 @@ public:
     void sort_steps()
     {
         // sort our steps by index
-        sort(this->steps.begin(), this->steps.end(), [](MashStep *s1, MashStep *s2)
-             { return (s1->index < s2->index); });
+        sort(this->steps.begin(), this->steps.end(), [](const MashStep &s1, const MashStep &s2)
+             { return (s1.index < s2.index); });
     }
 
     void sort_notifications()
     {
         // sort our notifications by time
-        sort(this->notifications.begin(), this->notifications.end(), [](Notification *n1, Notification *n2)
-             { return (n1->timeFromStart < n2->timeFromStart); });
+        sort(this->notifications.begin(), this->notifications.end(), [](const Notification &n1, const Notification &n2)
+             { return (n1.timeFromStart < n2.timeFromStart); });
     }
 
 protected:
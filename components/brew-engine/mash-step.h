@@ -8,13 +8,13 @@ using json = nlohmann::json;
 class MashStep
 {
 public:
-    uint index;
+    uint index = 0;
     string name;
-    int temperature;
-    int stepTime;
-    int time;
-    bool extendStepTimeIfNeeded; // if true, we extend the step time untit we reach our temperatue
-    bool allowBoost;             // if true, we allow boost mode for this step
+    int temperature = 0;
+    int stepTime = 0;
+    int time = 0;
+    bool extendStepTimeIfNeeded = false; // if true, we extend the step time untit we reach our temperatue
+    bool allowBoost = false;             // if true, we allow boost mode for this step
 
     json to_json()
     {
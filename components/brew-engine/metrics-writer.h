@@ -0,0 +1,157 @@
+#ifndef _MetricsWriter_H_
+#define _MetricsWriter_H_
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string_view>
+#include "chunked-output.h"
+
+using namespace std;
+
+// Fixed bucket histogram of loop durations, updated by one task and read by the metrics endpoint
+class LoopHistogram
+{
+public:
+    static constexpr std::array<float, 8> buckets = {0.005, 0.01, 0.05, 0.1, 0.5, 1, 2, 5}; // upper bounds in seconds
+
+    std::array<uint32_t, buckets.size()> counts = {};
+    uint32_t count = 0;
+    float sum = 0;
+
+    void record(float seconds)
+    {
+        for (size_t i = 0; i < buckets.size(); i++)
+        {
+            if (seconds <= buckets[i])
+            {
+                this->counts[i]++;
+            }
+        }
+        this->count++;
+        this->sum += seconds;
+    }
+};
+
+// Writes the prometheus text format straight to an output in small chunks, like JsonWriter does for json
+class MetricsWriter
+{
+public:
+    MetricsWriter(std::function<bool(const char *data, size_t length)> output)
+    {
+        this->out = ChunkedOutput(output);
+    }
+
+    // help and type lines, once before the samples of a metric
+    void family(std::string_view name, std::string_view type, std::string_view help)
+    {
+        this->out.write("# HELP ");
+        this->out.write(name);
+        this->out.write(" ");
+        this->out.write(help);
+        this->out.write("\n# TYPE ");
+        this->out.write(name);
+        this->out.write(" ");
+        this->out.write(type);
+        this->out.write("\n");
+    }
+
+    void sample(std::string_view name, double value)
+    {
+        this->out.write(name);
+        this->out.write(" ");
+        this->writeValue(value);
+        this->out.write("\n");
+    }
+
+    void sample(std::string_view name, std::string_view label, std::string_view labelValue, double value)
+    {
+        this->out.write(name);
+        this->out.write("{");
+        this->out.write(label);
+        this->out.write("=\"");
+        this->writeLabelValue(labelValue);
+        this->out.write("\"} ");
+        this->writeValue(value);
+        this->out.write("\n");
+    }
+
+    void histogram(std::string_view name, const LoopHistogram &histogram)
+    {
+        char bound[16];
+        for (size_t i = 0; i < LoopHistogram::buckets.size(); i++)
+        {
+            snprintf(bound, sizeof(bound), "%g", LoopHistogram::buckets[i]);
+            this->bucket(name, bound, histogram.counts[i]);
+        }
+        this->bucket(name, "+Inf", histogram.count);
+
+        this->out.write(name);
+        this->out.write("_sum ");
+        this->writeValue(histogram.sum);
+        this->out.write("\n");
+
+        this->out.write(name);
+        this->out.write("_count ");
+        this->writeValue(histogram.count);
+        this->out.write("\n");
+    }
+
+    // sends what is left in the buffer, returns false when the output failed at some point
+    bool flush()
+    {
+        return this->out.flush();
+    }
+
+protected:
+private:
+    void bucket(std::string_view name, std::string_view bound, uint32_t count)
+    {
+        this->out.write(name);
+        this->out.write("_bucket{le=\"");
+        this->out.write(bound);
+        this->out.write("\"} ");
+        this->writeValue(count);
+        this->out.write("\n");
+    }
+
+    void writeValue(double value)
+    {
+        if (std::isnan(value))
+        {
+            this->out.write("NaN");
+            return;
+        }
+
+        char chars[32];
+        int length = snprintf(chars, sizeof(chars), "%.10g", value);
+        this->out.write(std::string_view(chars, length));
+    }
+
+    // names come from the user, so quotes, backslashes and newlines need escaping
+    void writeLabelValue(std::string_view value)
+    {
+        for (char c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                this->out.writeChar('\\');
+                this->out.writeChar(c);
+            }
+            else if (c == '\n')
+            {
+                this->out.write("\\n");
+            }
+            else
+            {
+                this->out.writeChar(c);
+            }
+        }
+    }
+
+    ChunkedOutput out;
+};
+
+#endif /* _MetricsWriter_H_ */
@@ -2,6 +2,7 @@
 #define _Notification_H_
 
 #include <chrono>
+#include <vector>
 #include "nlohmann_json.hpp"
 
 using namespace std;
@@ -13,17 +14,17 @@ class Notification
 public:
     string name;
     string message;
-    int timeFromStart;
+    int timeFromStart = 0;
     system_clock::time_point timePoint;
-    bool buzzer;
-    bool done;
+    bool buzzer = false;
+    bool done = false;
 
-    json to_json()
+    json to_json(std::chrono::seconds offset = std::chrono::seconds(0))
     {
         int seconds = 0;
         if (this->timePoint.time_since_epoch() != decltype(this->timePoint)::duration::zero())
         {
-            seconds = std::chrono::duration_cast<std::chrono::seconds>(this->timePoint.time_since_epoch()).count();
+            seconds = std::chrono::duration_cast<std::chrono::seconds>(this->timePoint.time_since_epoch() + offset).count();
         }
 
         json jNotification;
@@ -44,7 +45,7 @@ public:
         this->buzzer = jsonData["buzzer"].get<bool>();
         this->done = false; // this can never come from json, always from control loop
 
-        if (!jsonData["message"].is_null() && jsonData["message"].is_string())
+        if (jsonData.contains("message") && jsonData["message"].is_string())
         {
             this->message = jsonData["message"];
         }
@@ -54,4 +55,36 @@ protected:
 private:
 };
 
+// One or more notifications that came due together, handed to the notification task
+class NotificationEvent
+{
+public:
+    system_clock::time_point time;
+    bool buzzer = false;
+    std::vector<Notification> notifications;
+
+    json to_json()
+    {
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(this->time.time_since_epoch()).count();
+
+        json jNotifications = json::array({});
+        for (auto &notification : this->notifications)
+        {
+            json jNotification;
+            jNotification["name"] = notification.name;
+            jNotification["message"] = notification.message;
+            jNotifications.push_back(jNotification);
+        }
+
+        json jEvent;
+        jEvent["time"] = seconds;
+        jEvent["notifications"] = jNotifications;
+
+        return jEvent;
+    }
+
+protected:
+private:
+};
+
 #endif
@@ -42,6 +42,11 @@ private:
 public:
     bool debug = false;
 
+    // terms of the last output, for monitoring
+    double lastP = 0;
+    double lastI = 0;
+    double lastD = 0;
+
     PIDController(double p, double i, double d)
     {
         if (p == 0 || i == 0 || d == 0)
@@ -97,6 +102,10 @@ public:
         }
         previousError = error;
 
+        lastP = p;
+        lastI = i;
+        lastD = d;
+
         double output = p + i + d;
 
         if (debug)
@@ -0,0 +1,152 @@
+#ifndef _RequestReader_H_
+#define _RequestReader_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <esp_http_server.h>
+
+using namespace std;
+
+// Pulls a request body from the socket in small chunks while a parser consumes it, so the body is never buffered as a whole.
+// begin()/end() give an input iterator pair that json::parse and json::from_msgpack can read from directly.
+class RequestReader
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = char;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const char *;
+        using reference = char;
+
+        Iterator(RequestReader *reader = nullptr)
+        {
+            this->reader = reader;
+        }
+
+        char operator*() const
+        {
+            return this->reader->buffer[this->reader->position];
+        }
+
+        Iterator &operator++()
+        {
+            this->reader->position++;
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            ++(*this);
+            return previous;
+        }
+
+        // the end iterator has no reader, we are there when the body is read or the socket failed
+        bool operator==(const Iterator &other) const
+        {
+            return this->atEnd() == other.atEnd();
+        }
+
+        bool operator!=(const Iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        bool atEnd() const
+        {
+            return this->reader == nullptr || !this->reader->fill();
+        }
+
+        RequestReader *reader;
+    };
+
+    RequestReader(httpd_req_t *req, size_t maxSize, uint8_t maxTimeouts)
+    {
+        this->req = req;
+        this->maxSize = maxSize;
+        this->maxTimeouts = maxTimeouts;
+
+        // a body over the limit isn't read at all
+        this->remaining = this->tooLarge() ? 0 : req->content_len;
+    }
+
+    Iterator begin()
+    {
+        return Iterator(this);
+    }
+
+    Iterator end()
+    {
+        return Iterator();
+    }
+
+    bool tooLarge() const
+    {
+        return this->req->content_len > this->maxSize;
+    }
+
+    // socket gave up or kept timing out, whatever was parsed is incomplete
+    bool failed() const
+    {
+        return this->error;
+    }
+
+    bool timedOut() const
+    {
+        return this->timeouts >= this->maxTimeouts;
+    }
+
+protected:
+private:
+    // makes sure there is an unread byte in the buffer, false when there is nothing left
+    bool fill()
+    {
+        if (this->position < this->length)
+        {
+            return true;
+        }
+
+        while (this->remaining > 0 && !this->error)
+        {
+            size_t toRead = (std::min<size_t>)(this->remaining, sizeof(this->buffer));
+            int ret = httpd_req_recv(this->req, this->buffer, toRead);
+
+            if (ret > 0)
+            {
+                this->remaining -= ret;
+                this->length = ret;
+                this->position = 0;
+                this->timeouts = 0;
+                return true;
+            }
+
+            // a slow client gets a few chances, but we don't wait forever
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT && ++this->timeouts < this->maxTimeouts)
+            {
+                continue;
+            }
+
+            this->error = true;
+        }
+
+        return false;
+    }
+
+    httpd_req_t *req;
+    char buffer[256];
+    size_t length = 0;
+    size_t position = 0;
+    size_t remaining;
+    size_t maxSize;
+    uint8_t timeouts = 0;
+    uint8_t maxTimeouts;
+    bool error = false;
+};
+
+#endif /* _RequestReader_H_ */
@@ -0,0 +1,93 @@
+#ifndef _RingIndex_H_
+#define _RingIndex_H_
+
+#include <cstddef>
+
+using namespace std;
+
+// Bookkeeping of a fixed size ring buffer, the owner keeps the data itself in whatever layout suits it.
+// Indexes run from 0 for the oldest entry, positions are the slots in the owner's storage.
+class RingIndex
+{
+public:
+    // new capacity, also clears
+    void resize(size_t capacity)
+    {
+        this->slots = capacity;
+        this->clear();
+    }
+
+    void clear()
+    {
+        this->head = 0;
+        this->count = 0;
+    }
+
+    size_t capacity() const
+    {
+        return this->slots;
+    }
+
+    bool empty() const
+    {
+        return this->count == 0;
+    }
+
+    size_t size() const
+    {
+        return this->count;
+    }
+
+    // slot for a new entry, when full that is the one of the oldest, which then drops out
+    // only call with a capacity
+    size_t push()
+    {
+        if (this->count < this->slots)
+        {
+            this->count++;
+            return (this->head + this->count - 1) % this->slots;
+        }
+
+        size_t position = this->head;
+        this->head = (this->head + 1) % this->slots;
+        return position;
+    }
+
+    size_t position(size_t index) const
+    {
+        return (this->head + index) % this->slots;
+    }
+
+protected:
+private:
+    size_t slots = 0;
+    size_t head = 0; // oldest entry
+    size_t count = 0;
+};
+
+// first of size entries whose time is after time, size when there is none
+// timeOf gives the time of an entry by index, they have to be in order
+template <typename Time, typename TimeOf>
+size_t firstAfter(size_t size, Time time, TimeOf timeOf)
+{
+    size_t low = 0;
+    size_t high = size;
+
+    while (low < high)
+    {
+        size_t mid = low + (high - low) / 2;
+
+        if (timeOf(mid) <= time)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+#endif /* _RingIndex_H_ */
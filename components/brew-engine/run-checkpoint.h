@@ -0,0 +1,124 @@
+#ifndef _RunCheckpoint_H_
+#define _RunCheckpoint_H_
+
+#include <ctime>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "nlohmann_json.hpp"
+
+using namespace std;
+using json = nlohmann::json;
+
+// What we need to pick up a run after a reboot.
+// The plan is not stored, it is calculated again from the schedule, its start time and temperature, and the shifts.
+class RunCheckpoint
+{
+public:
+    string schedule;                                  // empty for a run without schedule
+    json temporarySchedule = nullptr;                 // the schedule itself when it was imported and never saved
+    time_t planStart = 0;                             // time of the first step of the plan
+    float startTemperature = 0;                       // temperature of the first step of the plan
+    std::vector<std::pair<uint16_t, int32_t>> shifts; // overtime as step index and seconds added from there
+    uint16_t step = 0;
+    uint16_t nextNotification = 0;
+    bool inOverTime = false;
+    uint8_t boostStatus = 0;
+    std::optional<float> overrideTargetTemperature = std::nullopt;
+    std::optional<int8_t> manualOverrideOutput = std::nullopt;
+    float targetTemperature = 0; // only used without schedule, otherwise the plan sets it
+    bool boil = false;
+    time_t runStart = 0;
+    time_t savedAt = 0; // last time we know the run was still going
+
+    // same run state, savedAt aside
+    bool sameState(const RunCheckpoint &other) const
+    {
+        return std::tie(this->schedule, this->planStart, this->startTemperature, this->shifts, this->step, this->nextNotification, this->inOverTime,
+                        this->boostStatus, this->overrideTargetTemperature, this->manualOverrideOutput, this->targetTemperature, this->boil, this->runStart) ==
+               std::tie(other.schedule, other.planStart, other.startTemperature, other.shifts, other.step, other.nextNotification, other.inOverTime,
+                        other.boostStatus, other.overrideTargetTemperature, other.manualOverrideOutput, other.targetTemperature, other.boil, other.runStart);
+    }
+
+    json to_json()
+    {
+        json jShifts = json::array({});
+        for (auto const &[step, extra] : this->shifts)
+        {
+            jShifts.push_back({step, extra});
+        }
+
+        json jCheckpoint;
+        jCheckpoint["schedule"] = this->schedule;
+        if (!this->temporarySchedule.is_null())
+        {
+            jCheckpoint["temporarySchedule"] = this->temporarySchedule;
+        }
+        jCheckpoint["planStart"] = this->planStart;
+        jCheckpoint["startTemp"] = this->startTemperature;
+        jCheckpoint["shifts"] = jShifts;
+        jCheckpoint["step"] = this->step;
+        jCheckpoint["nextNotify"] = this->nextNotification;
+        jCheckpoint["overTime"] = this->inOverTime;
+        jCheckpoint["boost"] = this->boostStatus;
+        jCheckpoint["overrideTemp"] = this->overrideTargetTemperature.has_value() ? json(this->overrideTargetTemperature.value()) : json(nullptr);
+        jCheckpoint["overrideOut"] = this->manualOverrideOutput.has_value() ? json(this->manualOverrideOutput.value()) : json(nullptr);
+        jCheckpoint["target"] = this->targetTemperature;
+        jCheckpoint["boil"] = this->boil;
+        jCheckpoint["runStart"] = this->runStart;
+        jCheckpoint["savedAt"] = this->savedAt;
+
+        return jCheckpoint;
+    }
+
+    // throws a json exception when a field is missing or has the wrong type, the caller drops the checkpoint then
+    void from_json(const json &jsonData)
+    {
+        this->schedule = jsonData.at("schedule").get<string>();
+        this->planStart = jsonData.at("planStart").get<time_t>();
+        this->startTemperature = jsonData.at("startTemp").get<float>();
+        this->step = jsonData.at("step").get<uint16_t>();
+        this->nextNotification = jsonData.at("nextNotify").get<uint16_t>();
+        this->inOverTime = jsonData.at("overTime").get<bool>();
+        this->boostStatus = jsonData.at("boost").get<uint8_t>();
+        this->targetTemperature = jsonData.at("target").get<float>();
+        this->boil = jsonData.at("boil").get<bool>();
+        this->runStart = jsonData.at("runStart").get<time_t>();
+        this->savedAt = jsonData.at("savedAt").get<time_t>();
+
+        this->temporarySchedule = nullptr;
+        if (jsonData.contains("temporarySchedule") && jsonData["temporarySchedule"].is_object())
+        {
+            this->temporarySchedule = jsonData["temporarySchedule"];
+        }
+
+        const json &jShifts = jsonData.at("shifts");
+        if (!jShifts.is_array())
+        {
+            throw json::type_error::create(302, "shifts is not an array", &jShifts);
+        }
+
+        this->shifts.clear();
+        for (auto &shift : jShifts)
+        {
+            this->shifts.push_back({shift.at(0).get<uint16_t>(), shift.at(1).get<int32_t>()});
+        }
+
+        this->overrideTargetTemperature = std::nullopt;
+        if (jsonData.contains("overrideTemp") && jsonData["overrideTemp"].is_number())
+        {
+            this->overrideTargetTemperature = jsonData["overrideTemp"].get<float>();
+        }
+        this->manualOverrideOutput = std::nullopt;
+        if (jsonData.contains("overrideOut") && jsonData["overrideOut"].is_number())
+        {
+            this->manualOverrideOutput = jsonData["overrideOut"].get<int8_t>();
+        }
+    }
+
+protected:
+private:
+};
+
+#endif /* _RunCheckpoint_H_ */
@@ -0,0 +1,177 @@
+#ifndef _ScheduleStore_H_
+#define _ScheduleStore_H_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "nlohmann_json.hpp"
+#include "settings-manager.h"
+#include "brew-settings.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+// Mash schedules in nvs, each one under a key of its own so saving or deleting one doesn't rewrite the others.
+// A small index holds the names and the number of their record, records are only read when a schedule is needed.
+class ScheduleStore
+{
+public:
+    void init(SettingsManager *settingsManager)
+    {
+        this->settingsManager = settingsManager;
+    }
+
+    // reads the index, false when there is none yet
+    bool load()
+    {
+        this->records.clear();
+
+        vector<uint8_t> serialized = this->settingsManager->Get(BrewSettings::scheduleIndex, vector<uint8_t>());
+        if (serialized.empty())
+        {
+            return false;
+        }
+
+        json jIndex = json::from_msgpack(serialized, true, false);
+        if (!jIndex.is_array())
+        {
+            return false;
+        }
+
+        for (auto &jRecord : jIndex)
+        {
+            if (jRecord.is_array() && jRecord.size() == 2 && jRecord[0].is_string() && jRecord[1].is_number_unsigned())
+            {
+                this->records.insert_or_assign(jRecord[0].get<string>(), jRecord[1].get<uint16_t>());
+            }
+        }
+
+        return true;
+    }
+
+    bool empty() const
+    {
+        return this->records.empty();
+    }
+
+    bool contains(const string &name) const
+    {
+        return this->records.contains(name);
+    }
+
+    void names(std::function<void(const string &name)> output) const
+    {
+        for (auto const &[name, record] : this->records)
+        {
+            output(name);
+        }
+    }
+
+    // the schedule as saved, null when it doesn't exist or is damaged
+    json read(const string &name)
+    {
+        auto found = this->records.find(name);
+        if (found == this->records.end())
+        {
+            return nullptr;
+        }
+
+        auto serialized = this->settingsManager->ReadBlob(key(found->second));
+        if (!serialized.has_value())
+        {
+            return nullptr;
+        }
+
+        json jSchedule = json::from_msgpack(serialized.value(), true, false);
+        return jSchedule.is_object() ? jSchedule : json(nullptr);
+    }
+
+    // writes only this schedule, the index only changes for a new one
+    void save(const json &jSchedule)
+    {
+        string name = jSchedule["name"].get<string>();
+
+        auto found = this->records.find(name);
+        bool added = (found == this->records.end());
+        uint16_t record = added ? this->freeRecord() : found->second;
+
+        // serialize to MessagePack for size
+        vector<uint8_t> serialized = json::to_msgpack(jSchedule);
+        this->settingsManager->Write(key(record), serialized);
+
+        // the record goes first, a reboot in between leaves an unused record instead of an index entry without one
+        if (added)
+        {
+            this->records.insert_or_assign(name, record);
+            this->saveIndex();
+        }
+
+        this->settingsManager->Commit();
+    }
+
+    void remove(const string &name)
+    {
+        auto found = this->records.find(name);
+        if (found == this->records.end())
+        {
+            return;
+        }
+
+        uint16_t record = found->second;
+        this->records.erase(found);
+
+        // the index goes first, a reboot in between leaves an unused record instead of an index entry without one
+        // erasing isn't debounced like the index, so it has to be committed before
+        this->saveIndex();
+        this->settingsManager->Commit();
+
+        this->settingsManager->Erase(key(record));
+        this->settingsManager->Commit();
+    }
+
+protected:
+private:
+    static string key(uint16_t record)
+    {
+        return "sched" + std::to_string(record);
+    }
+
+    // lowest number that isn't used
+    uint16_t freeRecord() const
+    {
+        std::vector<bool> used(this->records.size() + 1, false);
+        for (auto const &[name, record] : this->records)
+        {
+            if (record < used.size())
+            {
+                used[record] = true;
+            }
+        }
+
+        uint16_t record = 0;
+        while (used[record])
+        {
+            record++;
+        }
+
+        return record;
+    }
+
+    void saveIndex()
+    {
+        json jIndex = json::array({});
+        for (auto const &[name, record] : this->records)
+        {
+            jIndex.push_back({name, record});
+        }
+
+        this->settingsManager->Set(BrewSettings::scheduleIndex, json::to_msgpack(jIndex));
+    }
+
+    SettingsManager *settingsManager = nullptr;
+    std::map<string, uint16_t> records; // name and record number
+};
+
+#endif /* _ScheduleStore_H_ */
@@ -0,0 +1,78 @@
+#ifndef _TelemetryClients_H_
+#define _TelemetryClients_H_
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// one serialized telemetry push, shared by all websocket clients
+struct TelemetryFrame
+{
+    string delta; // changes since the previous push
+    string full;  // complete state, only when a client just connected
+};
+
+// The websocket clients of the telemetry push, only used from the httpd task.
+// A new client is pending until it got a full state, deltas are useless to it before that.
+class TelemetryClients
+{
+public:
+    void add(int fd)
+    {
+        this->pending.push_back(fd);
+    }
+
+    void remove(int fd)
+    {
+        std::erase(this->active, fd);
+        std::erase(this->pending, fd);
+    }
+
+    size_t size() const
+    {
+        return this->active.size() + this->pending.size();
+    }
+
+    // clients that still wait for a frame with the full state
+    bool waiting() const
+    {
+        return !this->pending.empty();
+    }
+
+    // the full state goes to pending clients when the frame has one, they get the deltas from then on
+    // a client that connected after the frame was built stays pending until the next one with a full state
+    void send(const TelemetryFrame &frame, std::function<void(int fd, const string &payload)> send, std::function<bool(int fd)> isGone)
+    {
+        // drop clients that went away
+        std::erase_if(this->active, isGone);
+        std::erase_if(this->pending, isGone);
+
+        if (!frame.full.empty())
+        {
+            for (int fd : this->pending)
+            {
+                send(fd, frame.full);
+                this->active.push_back(fd);
+            }
+            this->pending.clear();
+        }
+
+        if (!frame.delta.empty())
+        {
+            for (int fd : this->active)
+            {
+                send(fd, frame.delta);
+            }
+        }
+    }
+
+protected:
+private:
+    std::vector<int> active;
+    std::vector<int> pending;
+};
+
+#endif /* _TelemetryClients_H_ */
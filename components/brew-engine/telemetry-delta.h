@@ -0,0 +1,66 @@
+#ifndef _TelemetryDelta_H_
+#define _TelemetryDelta_H_
+
+#include <ctime>
+#include "nlohmann_json.hpp"
+#include "temperature-history.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+// What changed since the previous telemetry push: the state fields that differ and the log entries that are new.
+// One delta is serialized per push and goes to every client, a client that connects later starts with the full state.
+class TelemetryDelta
+{
+public:
+    // empty object when nothing changed
+    json update(const json &state, const TemperatureHistory &recentLog)
+    {
+        json jDelta = json::object();
+        for (auto &[key, value] : state.items())
+        {
+            if (!this->lastState.contains(key) || this->lastState[key] != value)
+            {
+                jDelta[key] = value;
+            }
+        }
+
+        json jTempLog = json::array({});
+        for (size_t i = recentLog.indexAfter(this->lastLogTime); i < recentLog.size(); i++)
+        {
+            TemperatureHistory::Sample sample = recentLog.at(i);
+
+            json jTempLogItem;
+            jTempLogItem["time"] = sample.time;
+            jTempLogItem["temp"] = sample.temperature;
+            jTempLog.push_back(jTempLogItem);
+
+            this->lastLogTime = sample.time;
+        }
+
+        if (!jTempLog.empty())
+        {
+            jDelta["tempLog"] = jTempLog;
+        }
+
+        this->lastState = state;
+
+        return jDelta;
+    }
+
+    // while nobody listens, a client that connects later gets the log from the history api, not the whole recent tier
+    void skipLog(const TemperatureHistory &recentLog)
+    {
+        if (recentLog.size() > 0)
+        {
+            this->lastLogTime = recentLog.at(recentLog.size() - 1).time;
+        }
+    }
+
+protected:
+private:
+    json lastState;         // state of the last push
+    time_t lastLogTime = 0; // last log entry we pushed
+};
+
+#endif /* _TelemetryDelta_H_ */
@@ -0,0 +1,102 @@
+#ifndef _TemperatureHistory_H_
+#define _TemperatureHistory_H_
+
+#include <cmath>
+#include <cstdint>
+#include <ctime>
+#include <vector>
+#include "ring-index.h"
+
+using namespace std;
+
+// Fixed size ring buffer of logged temperatures, allocated once so a long run can't eat the heap.
+// Times are kept as seconds after the first sample and temperatures in tenths of a degree, 6 bytes per sample.
+// When it is full the oldest samples are overwritten.
+// The columns hold absolute values instead of deltas to the previous sample: at and indexAfter need any sample without
+// reading the ones before it, and overwriting the oldest sample would break a chain of deltas.
+class TemperatureHistory
+{
+public:
+    struct Sample
+    {
+        time_t time;
+        float temperature;
+    };
+
+    // sets the memory budget, also clears
+    void reserve(size_t bytes)
+    {
+        size_t capacity = bytes / (sizeof(uint32_t) + sizeof(int16_t));
+        this->offsets.assign(capacity, 0);
+        this->tenths.assign(capacity, 0);
+        this->ring.resize(capacity);
+        this->clear();
+    }
+
+    void clear()
+    {
+        this->ring.clear();
+        this->baseTime = 0;
+    }
+
+    bool empty() const
+    {
+        return this->ring.empty();
+    }
+
+    size_t size() const
+    {
+        return this->ring.size();
+    }
+
+    // temperature as it would be stored, to check if a new sample adds anything
+    static int16_t toTenths(float temperature)
+    {
+        return (int16_t)std::lround(temperature * 10);
+    }
+
+    void push(time_t time, float temperature)
+    {
+        if (this->ring.capacity() == 0)
+        {
+            return;
+        }
+
+        if (this->ring.empty())
+        {
+            this->baseTime = time;
+        }
+
+        size_t position = this->ring.push();
+        this->offsets[position] = (uint32_t)(time - this->baseTime);
+        this->tenths[position] = toTenths(temperature);
+    }
+
+    // 0 is the oldest sample
+    Sample at(size_t index) const
+    {
+        size_t position = this->ring.position(index);
+        return {this->baseTime + this->offsets[position], (float)this->tenths[position] / 10};
+    }
+
+    Sample back() const
+    {
+        return this->at(this->ring.size() - 1);
+    }
+
+    // first sample that is newer than time, size() when there is none
+    size_t indexAfter(time_t time) const
+    {
+        return firstAfter(this->ring.size(), time, [this](size_t index)
+                          { return this->at(index).time; });
+    }
+
+protected:
+private:
+    std::vector<uint32_t> offsets; // seconds after baseTime
+    std::vector<int16_t> tenths;
+    RingIndex ring;
+    time_t baseTime = 0;
+};
+
+#endif /* _TemperatureHistory_H_ */
@@ -18,6 +18,7 @@ public:
     float compensateAbsolute;
     float compensateRelative;
     float lastTemp;
+    uint32_t errorCount = 0; // runtime, failed reads since boot
     ds18b20_device_handle_t handle;
 
     json to_json()
@@ -0,0 +1,271 @@
+#ifndef _TieredHistory_H_
+#define _TieredHistory_H_
+
+#include <array>
+#include <cmath>
+#include <ctime>
+#include <functional>
+#include <utility>
+#include "temperature-history.h"
+
+using namespace std;
+
+// Temperature history over a whole brew day in a fixed memory budget.
+// The first tier keeps every sample for the recent past, the next tiers keep the min and max of each bucket,
+// so they reach further back at a lower resolution without losing peaks.
+// Queries pick the finest tier that covers the requested range and thin it out with largest-triangle-three-buckets.
+class TieredHistory
+{
+public:
+    using Sample = TemperatureHistory::Sample;
+
+    // bucket length per tier in seconds, 0 is raw, and the share of the memory budget it gets
+    static constexpr std::array<uint16_t, 3> bucketSeconds = {0, 30, 300};
+    static constexpr std::array<uint8_t, 3> budgetPercent = {50, 25, 25};
+
+    void reserve(size_t bytes)
+    {
+        for (size_t i = 0; i < this->tiers.size(); i++)
+        {
+            this->tiers[i].samples.reserve(bytes * budgetPercent[i] / 100);
+        }
+        this->clear();
+    }
+
+    void clear()
+    {
+        for (auto &tier : this->tiers)
+        {
+            tier.samples.clear();
+            tier.bucketCount = 0;
+        }
+    }
+
+    bool empty() const
+    {
+        return this->tiers[0].samples.empty();
+    }
+
+    Sample back() const
+    {
+        return this->tiers[0].samples.back();
+    }
+
+    // full resolution samples, for following the log as it grows
+    const TemperatureHistory &recent() const
+    {
+        return this->tiers[0].samples;
+    }
+
+    void push(time_t time, float temperature)
+    {
+        this->tiers[0].samples.push(time, temperature);
+
+        for (size_t i = 1; i < this->tiers.size(); i++)
+        {
+            Tier &tier = this->tiers[i];
+
+            // a sample after the bucket closes it
+            if (tier.bucketCount > 0 && time >= tier.bucketStart + bucketSeconds[i])
+            {
+                tier.flush();
+            }
+
+            if (tier.bucketCount == 0)
+            {
+                tier.bucketStart = time - (time % bucketSeconds[i]);
+                tier.min = {time, temperature};
+                tier.max = {time, temperature};
+            }
+            else if (temperature < tier.min.temperature)
+            {
+                tier.min = {time, temperature};
+            }
+            else if (temperature > tier.max.temperature)
+            {
+                tier.max = {time, temperature};
+            }
+
+            tier.bucketCount++;
+        }
+    }
+
+    // calls output with at most maxPoints samples between from and to, oldest first
+    // returns the bucket length of the tier that was used, 0 for full resolution
+    uint16_t query(time_t from, time_t to, size_t maxPoints, std::function<void(const Sample &sample)> output) const
+    {
+        // the finest tier that reaches back far enough, or else the one that reaches back furthest
+        size_t best = 0;
+        for (size_t i = 0; i < this->tiers.size(); i++)
+        {
+            const TemperatureHistory &samples = this->tiers[i].samples;
+            if (samples.empty())
+            {
+                continue;
+            }
+
+            if (samples.at(0).time <= from)
+            {
+                best = i;
+                break;
+            }
+
+            if (this->tiers[best].samples.empty() || samples.at(0).time < this->tiers[best].samples.at(0).time)
+            {
+                best = i;
+            }
+        }
+
+        // the bucket that is still open, otherwise the last minutes would be missing
+        const Tier &tier = this->tiers[best];
+        Sample open[2];
+        size_t openCount = 0;
+        if (best > 0 && tier.bucketCount > 0)
+        {
+            Sample bucket[2] = {tier.min, tier.max};
+            if (bucket[1].time < bucket[0].time)
+            {
+                std::swap(bucket[0], bucket[1]);
+            }
+
+            for (size_t i = 0; i < 2; i++)
+            {
+                if (bucket[i].time >= from && bucket[i].time <= to && (i == 0 || bucket[1].time != bucket[0].time))
+                {
+                    open[openCount++] = bucket[i];
+                }
+            }
+        }
+
+        // the open samples get their slots first, so together they stay within maxPoints
+        size_t skipOpen = (openCount > maxPoints) ? openCount - maxPoints : 0;
+
+        const TemperatureHistory &samples = tier.samples;
+        size_t first = (from > 0) ? samples.indexAfter(from - 1) : 0;
+        size_t last = samples.indexAfter(to);
+
+        lttb(samples, first, last, maxPoints - (openCount - skipOpen), output);
+
+        for (size_t i = skipOpen; i < openCount; i++)
+        {
+            output(open[i]);
+        }
+
+        return bucketSeconds[best];
+    }
+
+protected:
+private:
+    struct Tier
+    {
+        TemperatureHistory samples;
+
+        // bucket that is being filled
+        time_t bucketStart = 0;
+        uint32_t bucketCount = 0;
+        Sample min;
+        Sample max;
+
+        void flush()
+        {
+            // in time order, one sample when the bucket was flat
+            if (this->min.time == this->max.time)
+            {
+                this->samples.push(this->min.time, this->min.temperature);
+            }
+            else if (this->min.time < this->max.time)
+            {
+                this->samples.push(this->min.time, this->min.temperature);
+                this->samples.push(this->max.time, this->max.temperature);
+            }
+            else
+            {
+                this->samples.push(this->max.time, this->max.temperature);
+                this->samples.push(this->min.time, this->min.temperature);
+            }
+
+            this->bucketCount = 0;
+        }
+    };
+
+    // largest-triangle-three-buckets over samples [first, last), keeps the first and last and per bucket the sample
+    // that makes the largest triangle with the previous pick and the average of the next bucket
+    static void lttb(const TemperatureHistory &samples, size_t first, size_t last, size_t maxPoints, std::function<void(const Sample &sample)> &output)
+    {
+        size_t count = last - first;
+
+        if (count <= maxPoints)
+        {
+            for (size_t i = first; i < last; i++)
+            {
+                output(samples.at(i));
+            }
+            return;
+        }
+
+        // no room for buckets in between, the ends are all there is
+        if (maxPoints < 3)
+        {
+            if (maxPoints == 2)
+            {
+                output(samples.at(first));
+            }
+            if (maxPoints >= 1)
+            {
+                output(samples.at(last - 1));
+            }
+            return;
+        }
+
+        double every = (double)(count - 2) / (double)(maxPoints - 2);
+
+        Sample previous = samples.at(first);
+        output(previous);
+
+        for (size_t bucket = 0; bucket < maxPoints - 2; bucket++)
+        {
+            // average of the next bucket
+            size_t averageStart = first + (size_t)std::floor((bucket + 1) * every) + 1;
+            size_t averageEnd = std::min(first + (size_t)std::floor((bucket + 2) * every) + 1, last);
+
+            double averageTime = 0;
+            double averageTemperature = 0;
+            for (size_t i = averageStart; i < averageEnd; i++)
+            {
+                Sample sample = samples.at(i);
+                averageTime += (double)(sample.time - previous.time);
+                averageTemperature += sample.temperature;
+            }
+            size_t averageCount = std::max<size_t>(averageEnd - averageStart, 1);
+            averageTime /= averageCount;
+            averageTemperature /= averageCount;
+
+            // times relative to the previous pick, so they fit in a double without losing precision
+            size_t rangeStart = first + (size_t)std::floor(bucket * every) + 1;
+            size_t rangeEnd = first + (size_t)std::floor((bucket + 1) * every) + 1;
+
+            double maxArea = -1;
+            Sample picked = samples.at(rangeStart);
+            for (size_t i = rangeStart; i < rangeEnd; i++)
+            {
+                Sample sample = samples.at(i);
+                double area = std::fabs((averageTime * (sample.temperature - previous.temperature)) - ((double)(sample.time - previous.time) * (averageTemperature - previous.temperature)));
+
+                if (area > maxArea)
+                {
+                    maxArea = area;
+                    picked = sample;
+                }
+            }
+
+            output(picked);
+            previous = picked;
+        }
+
+        output(samples.at(last - 1));
+    }
+
+    std::array<Tier, 3> tiers;
+};
+
+#endif /* _TieredHistory_H_ */
@@ -0,0 +1,99 @@
+#ifndef _WebEtags_H_
+#define _WebEtags_H_
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+// Etags of the files on the www partition, from the etags file updatewebfiles.sh writes next to them.
+// Each line has the hash and the path of a stored file, like "3f2a9c0d11b4e7a5 /assets/index.js.gz".
+class WebEtags
+{
+public:
+    // reads the lines of an etags file, returns how many there were
+    size_t load(FILE *file)
+    {
+        this->etags.clear();
+
+        char hash[17];
+        char path[128];
+        while (fscanf(file, "%16s %127s", hash, path) == 2)
+        {
+            this->etags.insert_or_assign(path, "\"" + string(hash) + "\"");
+        }
+
+        return this->etags.size();
+    }
+
+    // quoted etag of a stored file, nullptr when we don't know it
+    const char *find(const string &path) const
+    {
+        auto found = this->etags.find(path);
+        if (found == this->etags.end())
+        {
+            return nullptr;
+        }
+
+        return found->second.c_str();
+    }
+
+    size_t size() const
+    {
+        return this->etags.size();
+    }
+
+    // if the If-None-Match header of a request lists this etag, or is *
+    // browsers may send it weak (W/"...") and several in one, the comparison is weak like rfc 9110 wants for If-None-Match
+    static bool matches(std::string_view ifNoneMatch, std::string_view etag)
+    {
+        if (etag.starts_with("W/"))
+        {
+            etag.remove_prefix(2);
+        }
+
+        while (!ifNoneMatch.empty())
+        {
+            size_t end = ifNoneMatch.find(',');
+            std::string_view candidate = ifNoneMatch.substr(0, end);
+            ifNoneMatch = (end == std::string_view::npos) ? std::string_view() : ifNoneMatch.substr(end + 1);
+
+            candidate = trim(candidate);
+            if (candidate == "*")
+            {
+                return true;
+            }
+            if (candidate.starts_with("W/"))
+            {
+                candidate.remove_prefix(2);
+            }
+            if (candidate == etag)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+protected:
+private:
+    static std::string_view trim(std::string_view text)
+    {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+        {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\0'))
+        {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+
+    std::map<string, string> etags; // quoted content hash per file on the www partition
+};
+
+#endif /* _WebEtags_H_ */
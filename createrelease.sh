@@ -66,4 +66,5 @@ esptool.py --chip $target merge_bin \
   0x8000 loader/build/partition_table/partition-table.bin \
   0x40000 loader/build/esp-brew-engine-loader.bin \
   0x35000 misc/ota_boot_ota0.bin \
-  0x110000 build/esp-brew-engine.bin
+  0x110000 build/esp-brew-engine.bin \
+  $( [ -f build/www.bin ] && echo "0x37E000 build/www.bin" )
@@ -0,0 +1,131 @@
+/*
+ * esp-brew-engine
+ * Copyright (C) Dekien Jeroen 2024
+ *
+ */
+#ifndef INCLUDE_SETTING_H
+#define INCLUDE_SETTING_H
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// nvs keys are at most 15 characters
+#define SETTING_KEY_MAX_LENGTH 15
+
+enum class Persistence
+{
+    Deferred = 0, // written with the next commit, save functions commit once when they are done
+    Immediate = 1 // committed as soon as it is set, for state that has to survive a power loss
+};
+
+namespace SettingSchema
+{
+    consteval bool validKey(const char *key)
+    {
+        size_t length = std::string_view(key).size();
+        return length > 0 && length <= SETTING_KEY_MAX_LENGTH;
+    }
+
+    // not constexpr and never defined, a schema entry that calls one doesn't compile and the error names the problem
+    void keyIsEmptyOrTooLong();
+    void defaultIsOutOfRange();
+}
+
+// A setting in the schema: its key in nvs, the name used in the api, default, valid range and when it is written.
+// Schema entries are constexpr, a key that is too long or a default outside its range doesn't compile.
+template <typename T>
+struct Setting
+{
+    static_assert(std::is_arithmetic_v<T>, "Setting only holds numbers and bools, use TextSetting or BlobSetting");
+
+    using Type = T;
+
+    const char *key;
+    const char *name; // field in the api json
+    T defaultValue;
+    T min;
+    T max;
+    Persistence persistence;
+
+    consteval Setting(const char *key, const char *name, T defaultValue, T min, T max, Persistence persistence = Persistence::Deferred)
+        : key(key), name(name), defaultValue(defaultValue), min(min), max(max), persistence(persistence)
+    {
+        if (!SettingSchema::validKey(key))
+        {
+            SettingSchema::keyIsEmptyOrTooLong();
+        }
+        if (!this->valid(defaultValue))
+        {
+            SettingSchema::defaultIsOutOfRange();
+        }
+    }
+
+    // the full range of the type, for bools and settings we don't limit
+    consteval Setting(const char *key, const char *name, T defaultValue, Persistence persistence = Persistence::Deferred)
+        : Setting(key, name, defaultValue, std::numeric_limits<T>::lowest(), std::numeric_limits<T>::max(), persistence)
+    {
+    }
+
+    constexpr bool valid(T value) const
+    {
+        return value >= this->min && value <= this->max; // also false for nan
+    }
+};
+
+struct TextSetting
+{
+    using Type = std::string;
+
+    const char *key;
+    const char *name;
+    const char *defaultValue;
+    size_t maxLength;
+    Persistence persistence;
+
+    consteval TextSetting(const char *key, const char *name, const char *defaultValue, size_t maxLength, Persistence persistence = Persistence::Deferred)
+        : key(key), name(name), defaultValue(defaultValue), maxLength(maxLength), persistence(persistence)
+    {
+        if (!SettingSchema::validKey(key))
+        {
+            SettingSchema::keyIsEmptyOrTooLong();
+        }
+        if (std::string_view(defaultValue).size() > maxLength)
+        {
+            SettingSchema::defaultIsOutOfRange();
+        }
+    }
+
+    constexpr bool valid(std::string_view value) const
+    {
+        return value.size() <= this->maxLength;
+    }
+};
+
+// serialized data like schedules, the owner checks the content
+struct BlobSetting
+{
+    const char *key;
+    Persistence persistence;
+
+    consteval BlobSetting(const char *key, Persistence persistence = Persistence::Deferred)
+        : key(key), persistence(persistence)
+    {
+        if (!SettingSchema::validKey(key))
+        {
+            SettingSchema::keyIsEmptyOrTooLong();
+        }
+    }
+};
+
+// binds a setting to the member that holds its value while running, like &BrewEngine::buzzerTime
+template <typename S, typename Member>
+struct SettingField
+{
+    const S &setting;
+    Member member;
+};
+
+#endif /* INCLUDE_SETTING_H */
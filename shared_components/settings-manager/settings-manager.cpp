@@ -32,7 +32,7 @@ void SettingsManager::Init()
     }
     ESP_LOGI(TAG, "NVS partition Init: Done");
 
-    ESP_ERROR_CHECK(nvs_open(this->Namespace.c_str(), NVS_READWRITE, this->nvsHandle));
+    ESP_ERROR_CHECK(nvs_open(this->Namespace.c_str(), NVS_READWRITE, &this->nvsHandle));
 
     nvs_stats_t nvs_stats;
     nvs_get_stats("nvs", &nvs_stats);
@@ -40,9 +40,127 @@ void SettingsManager::Init()
     ESP_LOGI(TAG, "NVS Used:%d Free:%d Total:%d", nvs_stats.used_entries, nvs_stats.free_entries, nvs_stats.total_entries);
 
     size_t used;
-    nvs_get_used_entry_count(*this->nvsHandle, &used);
+    nvs_get_used_entry_count(this->nvsHandle, &used);
 
     ESP_LOGI(TAG, "NVS Used:%d", used);
+
+    this->loadAll();
+
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = &SettingsManager::commitTimerCallback;
+    timerArgs.arg = this;
+    timerArgs.dispatch_method = ESP_TIMER_TASK;
+    timerArgs.name = "settings_commit";
+    ESP_ERROR_CHECK(esp_timer_create(&timerArgs, &this->commitTimer));
+}
+
+// reads every setting of our namespace once, after this the flash is only written
+// blobs can be large and are often not needed, like schedules that are never run, they are read on first use
+void SettingsManager::loadAll()
+{
+    nvs_iterator_t it = NULL;
+    esp_err_t res = nvs_entry_find("nvs", this->Namespace.c_str(), NVS_TYPE_ANY, &it);
+
+    while (res == ESP_OK)
+    {
+        nvs_entry_info_t info;
+        nvs_entry_info(it, &info);
+
+        if (info.type == NVS_TYPE_BLOB)
+        {
+            this->cache.insert_or_assign(info.key, Entry{vector<uint8_t>(), false, false});
+        }
+        else
+        {
+            this->load(info.key, info.type);
+        }
+
+        res = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
+
+    ESP_LOGI(TAG, "Loaded %d settings", this->cache.size());
+}
+
+void SettingsManager::load(const char *name, nvs_type_t type)
+{
+    esp_err_t err = ESP_FAIL;
+    Value value;
+
+    switch (type)
+    {
+    case NVS_TYPE_U8:
+    {
+        uint8_t u8 = 0;
+        err = nvs_get_u8(this->nvsHandle, name, &u8);
+        value = u8;
+        break;
+    }
+    case NVS_TYPE_I8:
+    {
+        int8_t i8 = 0;
+        err = nvs_get_i8(this->nvsHandle, name, &i8);
+        value = i8;
+        break;
+    }
+    case NVS_TYPE_U16:
+    {
+        uint16_t u16 = 0;
+        err = nvs_get_u16(this->nvsHandle, name, &u16);
+        value = u16;
+        break;
+    }
+    case NVS_TYPE_U32:
+    {
+        uint32_t u32 = 0;
+        err = nvs_get_u32(this->nvsHandle, name, &u32);
+        value = u32;
+        break;
+    }
+    case NVS_TYPE_U64:
+    {
+        uint64_t u64 = 0;
+        err = nvs_get_u64(this->nvsHandle, name, &u64);
+        value = u64;
+        break;
+    }
+    case NVS_TYPE_STR:
+    {
+        size_t size = 0;
+        err = nvs_get_str(this->nvsHandle, name, NULL, &size);
+        if (err == ESP_OK && size > 0)
+        {
+            string text(size, '\0');
+            err = nvs_get_str(this->nvsHandle, name, text.data(), &size);
+            text.resize(size - 1); // without the terminator
+            value = text;
+        }
+        break;
+    }
+    case NVS_TYPE_BLOB:
+    {
+        size_t size = 0;
+        err = nvs_get_blob(this->nvsHandle, name, NULL, &size);
+        if (err == ESP_OK)
+        {
+            vector<uint8_t> blob(size);
+            err = nvs_get_blob(this->nvsHandle, name, blob.data(), &size);
+            value = blob;
+        }
+        break;
+    }
+    default:
+        ESP_LOGW(TAG, "Skipping setting %s, type %d is not used by us", name, type);
+        return;
+    }
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Error reading Setting: %s", name);
+        return;
+    }
+
+    this->cache.insert_or_assign(name, Entry{value, false});
 }
 
 void SettingsManager::FactoryReset()
@@ -50,6 +168,11 @@ void SettingsManager::FactoryReset()
     // Reset NVS
     ESP_LOGI(TAG, "FactoryReset: Start");
 
+    {
+        std::lock_guard<std::mutex> guard(this->cacheLock);
+        this->cache.clear();
+    }
+
     ESP_ERROR_CHECK(nvs_flash_erase());
     ESP_ERROR_CHECK(nvs_flash_init());
 
@@ -74,210 +197,341 @@ void SettingsManager::FactoryReset()
 //     }
 // }
 
-string SettingsManager::Read(string name, string defaultValue)
+template <typename T>
+std::optional<T> SettingsManager::lookup(const string &name)
 {
+    std::lock_guard<std::mutex> guard(this->cacheLock);
 
-    size_t size = 0;
-    esp_err_t err = nvs_get_str(*this->nvsHandle, name.c_str(), NULL, &size);
-
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+    auto found = this->cache.find(name);
+    if (found != this->cache.end() && !found->second.loaded)
     {
-        ESP_LOGE(TAG, "Error reading Setting: %s", name.c_str());
+        this->load(name.c_str(), NVS_TYPE_BLOB);
+        found = this->cache.find(name);
     }
 
-    if (size == 0)
+    if (found == this->cache.end() || !found->second.loaded)
     {
-        // does not exist yet, we save the default
-        this->Write(name, defaultValue);
-        return defaultValue;
+        return std::nullopt;
     }
 
-    char *chars = (char *)malloc(size);
-
-    err = nvs_get_str(*this->nvsHandle, name.c_str(), chars, &size);
-
-    if (err != ESP_OK)
+    T *value = std::get_if<T>(&found->second.value);
+    if (value != nullptr)
     {
-        ESP_LOGE(TAG, "Error reading Setting: %s", name.c_str());
+        // blobs can be large and the caller keeps its own copy, so a saved one is read from flash again next time
+        if constexpr (std::is_same_v<T, vector<uint8_t>>)
+        {
+            if (!found->second.dirty)
+            {
+                T blob = std::move(*value);
+                found->second.value = vector<uint8_t>();
+                found->second.loaded = false;
+                return blob;
+            }
+        }
+
+        return *value;
     }
 
-    return (string)chars;
+    ESP_LOGE(TAG, "Setting %s has another type, using the default", name.c_str());
+    return std::nullopt;
 }
 
-vector<uint8_t> SettingsManager::Read(string name, vector<uint8_t> defaultValue)
+template <typename T>
+T SettingsManager::read(const string &name, const T &defaultValue)
 {
-
-    size_t size = 0;
-    esp_err_t err = nvs_get_blob(*this->nvsHandle, name.c_str(), NULL, &size);
-
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+    std::optional<T> value = this->lookup<T>(name);
+    if (value.has_value())
     {
-        ESP_LOGE(TAG, "Error reading Setting: %s", name.c_str());
+        return value.value();
     }
 
-    if (size == 0)
-    {
-        // does not exist yet, we save the default
-        this->Write(name, defaultValue);
-        return defaultValue;
-    }
-
-    ESP_LOGD(TAG, "Size: %d", size);
+    // does not exist yet, we save the default
+    std::lock_guard<std::mutex> guard(this->cacheLock);
+    this->cache.insert_or_assign(name, Entry{defaultValue, true});
+    this->scheduleCommit();
 
-    uint8_t blob[size];
+    return defaultValue;
+}
 
-    err = nvs_get_blob(*this->nvsHandle, name.c_str(), blob, &size);
+template <typename T>
+void SettingsManager::write(const string &name, const T &value)
+{
+    std::lock_guard<std::mutex> guard(this->cacheLock);
 
-    if (err != ESP_OK)
+    // saving a form writes every field, most didn't change
+    auto found = this->cache.find(name);
+    if (found != this->cache.end())
     {
-        ESP_LOGE(TAG, "Error reading Setting: %s", name.c_str());
+        const T *current = std::get_if<T>(&found->second.value);
+        if (current != nullptr && found->second.loaded && *current == value)
+        {
+            return;
+        }
     }
 
-    vector<uint8_t> v_blob = vector(blob, *(&blob + 1));
-
-    return v_blob;
+    this->cache.insert_or_assign(name, Entry{value, true});
+    this->scheduleCommit();
 }
 
-bool SettingsManager::Read(string name, bool defaultValue)
+// caller holds the lock
+void SettingsManager::scheduleCommit()
 {
-    uint8_t value = 0;
-    esp_err_t err = nvs_get_u8(*this->nvsHandle, name.c_str(), &value);
-
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+    if (this->commitScheduled || this->commitTimer == NULL)
     {
-        ESP_LOGE(TAG, "Error reading Setting: %s", name.c_str());
+        return;
     }
 
-    if (err == ESP_ERR_NVS_NOT_FOUND)
+    if (esp_timer_start_once(this->commitTimer, SETTINGS_COMMIT_DELAY_MS * 1000) == ESP_OK)
     {
-        // does not exist yet, we save the default
-        this->Write(name, defaultValue);
-        return defaultValue;
+        this->commitScheduled = true;
     }
+}
 
-    return (bool)value;
+void SettingsManager::commitTimerCallback(void *arg)
+{
+    SettingsManager *instance = (SettingsManager *)arg;
+    instance->Commit();
 }
 
-uint8_t SettingsManager::Read(string name, uint8_t defaultValue)
+esp_err_t SettingsManager::store(const string &name, const Value &value)
 {
-    uint8_t value = 0;
-    esp_err_t err = nvs_get_u8(*this->nvsHandle, name.c_str(), &value);
+    return std::visit([this, &name](auto &&v) -> esp_err_t
+                      {
+        using T = std::decay_t<decltype(v)>;
+
+        if constexpr (std::is_same_v<T, uint8_t>)
+        {
+            return nvs_set_u8(this->nvsHandle, name.c_str(), v);
+        }
+        else if constexpr (std::is_same_v<T, int8_t>)
+        {
+            return nvs_set_i8(this->nvsHandle, name.c_str(), v);
+        }
+        else if constexpr (std::is_same_v<T, uint16_t>)
+        {
+            return nvs_set_u16(this->nvsHandle, name.c_str(), v);
+        }
+        else if constexpr (std::is_same_v<T, uint32_t>)
+        {
+            return nvs_set_u32(this->nvsHandle, name.c_str(), v);
+        }
+        else if constexpr (std::is_same_v<T, uint64_t>)
+        {
+            return nvs_set_u64(this->nvsHandle, name.c_str(), v);
+        }
+        else if constexpr (std::is_same_v<T, string>)
+        {
+            return nvs_set_str(this->nvsHandle, name.c_str(), v.c_str());
+        }
+        else
+        {
+            return nvs_set_blob(this->nvsHandle, name.c_str(), v.data(), v.size());
+        } },
+                      value);
+}
 
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+void SettingsManager::Commit()
+{
+    std::lock_guard<std::mutex> guard(this->cacheLock);
+
+    if (this->commitScheduled)
     {
-        ESP_LOGE(TAG, "Error reading Setting: %s", name.c_str());
+        esp_timer_stop(this->commitTimer);
+        this->commitScheduled = false;
     }
 
-    if (err == ESP_ERR_NVS_NOT_FOUND)
+    int written = 0;
+    for (auto &[name, entry] : this->cache)
     {
-        // does not exist yet, we save the default
-        this->Write(name, defaultValue);
-        return defaultValue;
+        if (!entry.dirty)
+        {
+            continue;
+        }
+
+        esp_err_t err = this->store(name, entry.value);
+        if (err != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Error writing Setting: %s", name.c_str());
+        }
+
+        entry.dirty = false;
+
+        // a written blob is only needed again when it is read, like one loaded at boot
+        if (std::holds_alternative<vector<uint8_t>>(entry.value))
+        {
+            entry.value = vector<uint8_t>();
+            entry.loaded = false;
+        }
+        written++;
     }
 
-    return value;
-}
-
-int8_t SettingsManager::Read(string name, int8_t defaultValue)
-{
-    int8_t value = 0;
-    esp_err_t err = nvs_get_i8(*this->nvsHandle, name.c_str(), &value);
-
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+    if (written == 0 && !this->erasePending)
     {
-        ESP_LOGE(TAG, "Error reading Setting: %s", name.c_str());
+        return;
     }
+    this->erasePending = false;
 
-    if (err == ESP_ERR_NVS_NOT_FOUND)
+    esp_err_t err = nvs_commit(this->nvsHandle);
+    if (err != ESP_OK)
     {
-        // does not exist yet, we save the default
-        this->Write(name, defaultValue);
-        return defaultValue;
+        ESP_LOGE(TAG, "Error committing Settings");
     }
 
-    return value;
+    ESP_LOGD(TAG, "Committed %d settings", written);
 }
 
-uint16_t SettingsManager::Read(string name, uint16_t defaultValue)
+string SettingsManager::Read(string name, string defaultValue)
 {
-    uint16_t value = 0;
-    esp_err_t err = nvs_get_u16(*this->nvsHandle, name.c_str(), &value);
+    return this->read(name, defaultValue);
+}
 
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
-    {
-        ESP_LOGE(TAG, "Error reading Setting: %s", name.c_str());
-    }
+vector<uint8_t> SettingsManager::Read(string name, vector<uint8_t> defaultValue)
+{
+    return this->read(name, defaultValue);
+}
 
-    if (err == ESP_ERR_NVS_NOT_FOUND)
-    {
-        // does not exist yet, we save the default
-        this->Write(name, defaultValue);
-        return defaultValue;
-    }
+bool SettingsManager::Read(string name, bool defaultValue)
+{
+    return (bool)this->read(name, (uint8_t)defaultValue);
+}
 
-    return value;
+uint8_t SettingsManager::Read(string name, uint8_t defaultValue)
+{
+    return this->read(name, defaultValue);
 }
 
-void SettingsManager::Write(string name, string value)
+int8_t SettingsManager::Read(string name, int8_t defaultValue)
 {
-    esp_err_t err = nvs_set_str(*this->nvsHandle, name.c_str(), value.c_str());
+    return this->read(name, defaultValue);
+}
 
-    if (err != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Error writing Setting: %s", name.c_str());
-    }
+uint16_t SettingsManager::Read(string name, uint16_t defaultValue)
+{
+    return this->read(name, defaultValue);
+}
+
+void SettingsManager::Write(string name, string value)
+{
+    this->write(name, value);
 }
 
 void SettingsManager::Write(string name, vector<uint8_t> value)
 {
-    int size = value.size();
-    uint8_t arr[size];
-    copy(value.begin(), value.end(), arr);
+    this->write(name, value);
+}
 
-    esp_err_t err = nvs_set_blob(*this->nvsHandle, name.c_str(), arr, size);
+void SettingsManager::Write(string name, bool value)
+{
+    this->write(name, (uint8_t)value);
+}
 
-    if (err != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Error writing Setting: %s", name.c_str());
-    }
+void SettingsManager::Write(string name, uint8_t value)
+{
+    this->write(name, value);
 }
 
-void SettingsManager::Write(string name, bool value)
+void SettingsManager::Write(string name, int8_t value)
 {
-    esp_err_t err = nvs_set_u8(*this->nvsHandle, name.c_str(), (uint8_t)value);
+    this->write(name, value);
+}
 
-    if (err != ESP_OK)
+void SettingsManager::Write(string name, uint16_t value)
+{
+    this->write(name, value);
+}
+
+// schema settings, the numeric ones are templates in the header
+template std::optional<uint8_t> SettingsManager::lookup(const string &name);
+template std::optional<int8_t> SettingsManager::lookup(const string &name);
+template std::optional<uint16_t> SettingsManager::lookup(const string &name);
+template std::optional<uint32_t> SettingsManager::lookup(const string &name);
+template std::optional<uint64_t> SettingsManager::lookup(const string &name);
+template void SettingsManager::write(const string &name, const uint8_t &value);
+template void SettingsManager::write(const string &name, const int8_t &value);
+template void SettingsManager::write(const string &name, const uint16_t &value);
+template void SettingsManager::write(const string &name, const uint32_t &value);
+template void SettingsManager::write(const string &name, const uint64_t &value);
+
+void SettingsManager::invalidSetting(const char *key)
+{
+    ESP_LOGW(TAG, "Setting %s is out of range, using the default", key);
+}
+
+string SettingsManager::Get(const TextSetting &setting)
+{
+    std::optional<string> value = this->lookup<string>(setting.key);
+    if (!value.has_value())
     {
-        ESP_LOGE(TAG, "Error writing Setting: %s", name.c_str());
+        return setting.defaultValue;
     }
+
+    if (!setting.valid(value.value()))
+    {
+        this->invalidSetting(setting.key);
+        return setting.defaultValue;
+    }
+
+    return value.value();
 }
 
-void SettingsManager::Write(string name, uint8_t value)
+bool SettingsManager::Set(const TextSetting &setting, const string &value)
 {
-    esp_err_t err = nvs_set_u8(*this->nvsHandle, name.c_str(), value);
+    if (!setting.valid(value))
+    {
+        return false;
+    }
 
-    if (err != ESP_OK)
+    this->write(setting.key, value);
+
+    if (setting.persistence == Persistence::Immediate)
     {
-        ESP_LOGE(TAG, "Error writing Setting: %s", name.c_str());
+        this->Commit();
     }
+
+    return true;
 }
 
-void SettingsManager::Write(string name, int8_t value)
+vector<uint8_t> SettingsManager::Get(const BlobSetting &setting, const vector<uint8_t> &defaultValue)
 {
-    esp_err_t err = nvs_set_i8(*this->nvsHandle, name.c_str(), value);
+    return this->lookup<vector<uint8_t>>(setting.key).value_or(defaultValue);
+}
 
-    if (err != ESP_OK)
+void SettingsManager::Set(const BlobSetting &setting, const vector<uint8_t> &value)
+{
+    this->write(setting.key, value);
+
+    if (setting.persistence == Persistence::Immediate)
     {
-        ESP_LOGE(TAG, "Error writing Setting: %s", name.c_str());
+        this->Commit();
     }
 }
 
-void SettingsManager::Write(string name, uint16_t value)
+bool SettingsManager::Contains(const string &name)
 {
-    esp_err_t err = nvs_set_u16(*this->nvsHandle, name.c_str(), value);
+    std::lock_guard<std::mutex> guard(this->cacheLock);
+    return this->cache.contains(name);
+}
 
-    if (err != ESP_OK)
+void SettingsManager::Erase(const string &name)
+{
+    std::lock_guard<std::mutex> guard(this->cacheLock);
+
+    if (this->cache.erase(name) == 0)
     {
-        ESP_LOGE(TAG, "Error writing Setting: %s", name.c_str());
+        return;
     }
-}
\ No newline at end of file
+
+    esp_err_t err = nvs_erase_key(this->nvsHandle, name.c_str());
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+    {
+        ESP_LOGE(TAG, "Error erasing Setting: %s", name.c_str());
+    }
+
+    this->erasePending = true;
+    this->scheduleCommit();
+}
+
+std::optional<vector<uint8_t>> SettingsManager::ReadBlob(const string &name)
+{
+    return this->lookup<vector<uint8_t>>(name);
+}
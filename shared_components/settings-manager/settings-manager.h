@@ -11,25 +11,152 @@
 #include "freertos/event_groups.h"
 
 #include "esp_log.h"
+#include "esp_timer.h"
 
+#include <bit>
 #include <vector>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <variant>
 
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "nvs_handle.hpp"
 
+#include "setting.h"
+
+#define SETTINGS_COMMIT_DELAY_MS 2000 // writes that aren't committed by the caller go to flash this long after the first one
+
 using namespace std;
 
 class SettingsManager
 {
 private:
-    nvs_handle_t *nvsHandle;
+    // bools are kept as uint8_t, like in nvs, floats and doubles by their bits in an uint32_t or uint64_t
+    using Value = std::variant<uint8_t, int8_t, uint16_t, uint32_t, uint64_t, string, vector<uint8_t>>;
+
+    template <typename T>
+    struct Stored
+    {
+        using type = T;
+    };
+
+    struct Entry
+    {
+        Value value;
+        bool dirty;         // changed since the last commit
+        bool loaded = true; // blobs are only read from flash when they are needed, and not kept after
+    };
+
+    nvs_handle_t nvsHandle;
+
+    // all settings of our namespace, loaded at init, only reading a blob touches the flash
+    std::map<string, Entry> cache;
+    std::mutex cacheLock;
+    esp_timer_handle_t commitTimer = NULL;
+    bool commitScheduled = false;
+    bool erasePending = false; // erased keys need a commit too
+
+    void loadAll();
+    void load(const char *name, nvs_type_t type);
+    template <typename T>
+    std::optional<T> lookup(const string &name);
+    template <typename T>
+    T read(const string &name, const T &defaultValue);
+    template <typename T>
+    void write(const string &name, const T &value);
+    esp_err_t store(const string &name, const Value &value);
+    void scheduleCommit();
+    static void commitTimerCallback(void *arg);
+    void invalidSetting(const char *key);
+
+    template <typename T>
+    static typename Stored<T>::type toStored(T value)
+    {
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            return std::bit_cast<typename Stored<T>::type>(value);
+        }
+        else
+        {
+            return static_cast<typename Stored<T>::type>(value);
+        }
+    }
+
+    template <typename T>
+    static T fromStored(typename Stored<T>::type value)
+    {
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            return std::bit_cast<T>(value);
+        }
+        else
+        {
+            return static_cast<T>(value);
+        }
+    }
 
 public:
     SettingsManager(); // constructor
     void Init();
     void FactoryReset();
 
+    // writes changed settings to flash in one go, save functions call this when they are done
+    void Commit();
+
+    // settings from a schema, see setting.h
+    // a stored value outside the range gives the default, setting one outside the range is refused
+    template <typename T>
+    T Get(const Setting<T> &setting)
+    {
+        auto stored = this->lookup<typename Stored<T>::type>(setting.key);
+        if (!stored.has_value())
+        {
+            return setting.defaultValue;
+        }
+
+        T value = fromStored<T>(stored.value());
+        if (!setting.valid(value))
+        {
+            this->invalidSetting(setting.key);
+            return setting.defaultValue;
+        }
+
+        return value;
+    }
+
+    template <typename T>
+    bool Set(const Setting<T> &setting, T value)
+    {
+        if (!setting.valid(value))
+        {
+            return false;
+        }
+
+        this->write(setting.key, toStored(value));
+
+        if (setting.persistence == Persistence::Immediate)
+        {
+            this->Commit();
+        }
+
+        return true;
+    }
+
+    string Get(const TextSetting &setting);
+    bool Set(const TextSetting &setting, const string &value);
+    vector<uint8_t> Get(const BlobSetting &setting, const vector<uint8_t> &defaultValue);
+    void Set(const BlobSetting &setting, const vector<uint8_t> &value);
+
+    // a blob under a key that isn't in a schema, like one per schedule, nullopt when there is none
+    std::optional<vector<uint8_t>> ReadBlob(const string &name);
+
+    bool Contains(const string &name);
+    void Erase(const string &name);
+
     // maby an option for the future, atm it just seems to make it more complex
     // template <typename T>
     // T *Read(string name, T *defaultValue);
@@ -52,4 +179,22 @@ public:
     string Namespace = "Settings";
 };
 
+template <>
+struct SettingsManager::Stored<bool>
+{
+    using type = uint8_t;
+};
+
+template <>
+struct SettingsManager::Stored<float>
+{
+    using type = uint32_t;
+};
+
+template <>
+struct SettingsManager::Stored<double>
+{
+    using type = uint64_t;
+};
+
 #endif /* INCLUDE_SETTINGSMANAGER_H */
@@ -61,6 +61,7 @@ void WiFiConnect::saveSettings()
     this->settingsManager->Write("wifi_ap", this->enableAP);
     this->settingsManager->Write("wifi_max_power", this->maxWifiPower);
     this->settingsManager->Write("Hostname", this->Hostname);
+    this->settingsManager->Commit();
 
     ESP_LOGI(TAG, "Saving Wifi Settings Done");
 }
@@ -0,0 +1,295 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "check.h"
+#include "command-result.h"
+#include "command-table.h"
+#include "json-writer.h"
+
+using namespace std::chrono;
+
+// A stand-in for the api on the loopback interface, one connection at a time like httpd on the esp.
+// It answers a command or an array of them the way apiPostHandler does, the handlers just return some settings.
+// GetRunningSchedule streams its data like the real one, Start and Stop change what it shows.
+#define API_MAX_BATCH_COMMANDS 16 // same as brew-engine.h
+
+struct StandInCommand
+{
+    std::string_view name;
+    int fields; // size of the answer
+};
+
+static constexpr CommandTable<StandInCommand, 9> commands({{
+    {"Data", 12},
+    {"GetHeaterSettings", 8},
+    {"GetMashSchedules", 30},
+    {"GetPIDSettings", 10},
+    {"GetRunningSchedule", 20},
+    {"GetSystemSettings", 10},
+    {"GetTempSettings", 8},
+    {"Start", 0},
+    {"Stop", 0},
+}});
+
+static bool running = false; // only the server thread touches it
+
+static CommandResult processCommand(json &jCommand)
+{
+    CommandResult result;
+
+    const StandInCommand *found = jCommand.is_object() && jCommand["command"].is_string() ? commands.find(jCommand["command"].get<string>()) : nullptr;
+    if (found == nullptr)
+    {
+        result.success = false;
+        result.message = "Unknown command";
+        return result;
+    }
+
+    if (found->name == "Start" || found->name == "Stop")
+    {
+        running = (found->name == "Start");
+        return result;
+    }
+
+    result.writeData = [found](JsonWriter &writer)
+    {
+        writer.beginObject();
+        if (found->name == "GetRunningSchedule")
+        {
+            writer.key("running");
+            writer.value(running);
+        }
+        for (int i = 0; i < found->fields; i++)
+        {
+            writer.key(string(found->name) + std::to_string(i));
+            writer.value(i * 1.5);
+        }
+        writer.endObject();
+    };
+
+    return result;
+}
+
+static void sendAll(int fd, std::string_view data)
+{
+    while (!data.empty())
+    {
+        ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        CHECK(sent > 0);
+        data.remove_prefix(sent);
+    }
+}
+
+// headers and body of one request, or of the response until the other side closes
+static string receive(int fd, bool untilClosed)
+{
+    string received;
+    char buffer[4096];
+    while (true)
+    {
+        if (!untilClosed)
+        {
+            size_t headerEnd = received.find("\r\n\r\n");
+            if (headerEnd != string::npos)
+            {
+                size_t lengthAt = received.find("Content-Length: ");
+                size_t length = (lengthAt == string::npos) ? 0 : std::stoul(received.substr(lengthAt + 16));
+                if (received.size() >= headerEnd + 4 + length)
+                {
+                    return received.substr(headerEnd + 4);
+                }
+            }
+        }
+
+        ssize_t read = recv(fd, buffer, sizeof(buffer), 0);
+        if (read <= 0)
+        {
+            return received;
+        }
+        received.append(buffer, read);
+    }
+}
+
+class StandInServer
+{
+public:
+    StandInServer()
+    {
+        this->listener = socket(AF_INET, SOCK_STREAM, 0);
+        CHECK(this->listener >= 0);
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        CHECK(bind(this->listener, (sockaddr *)&address, sizeof(address)) == 0);
+        CHECK(listen(this->listener, 8) == 0);
+
+        socklen_t length = sizeof(address);
+        CHECK(getsockname(this->listener, (sockaddr *)&address, &length) == 0);
+        this->port = ntohs(address.sin_port);
+
+        this->thread = std::thread([this]()
+                                   { this->serve(); });
+    }
+
+    ~StandInServer()
+    {
+        this->running = false;
+        shutdown(this->listener, SHUT_RDWR);
+        close(this->listener);
+        this->thread.join();
+    }
+
+    uint16_t port = 0;
+
+protected:
+private:
+    void serve()
+    {
+        while (this->running)
+        {
+            int fd = accept(this->listener, nullptr, nullptr);
+            if (fd < 0)
+            {
+                return;
+            }
+            this->handle(fd);
+            close(fd);
+        }
+    }
+
+    void handle(int fd)
+    {
+        json jCommand = json::parse(receive(fd, false), nullptr, false);
+
+        bool batch = jCommand.is_array();
+        if (jCommand.is_discarded() || !(jCommand.is_object() || batch) || (batch && jCommand.size() > API_MAX_BATCH_COMMANDS))
+        {
+            sendAll(fd, "HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n");
+            return;
+        }
+
+        std::vector<CommandResult> results = runCommands(jCommand, processCommand);
+
+        sendAll(fd, "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nConnection: close\r\n\r\n");
+
+        JsonWriter writer([fd](const char *data, size_t length)
+                          {
+            sendAll(fd, std::string_view(data, length));
+            return true; });
+
+        if (batch)
+        {
+            writer.beginArray();
+        }
+        for (auto &result : results)
+        {
+            result.write(writer);
+        }
+        if (batch)
+        {
+            writer.endArray();
+        }
+        writer.flush();
+    }
+
+    int listener = -1;
+    std::atomic<bool> running = true;
+    std::thread thread;
+};
+
+// a new connection per request like the ui makes them, returns the status line and the body
+static std::pair<string, json> post(uint16_t port, const json &jBody)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK(fd >= 0);
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    CHECK(connect(fd, (sockaddr *)&address, sizeof(address)) == 0);
+
+    string body = jBody.dump();
+    sendAll(fd, "POST /api HTTP/1.1\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body);
+    string response = receive(fd, true);
+    close(fd);
+
+    size_t headerEnd = response.find("\r\n\r\n");
+    CHECK(headerEnd != string::npos);
+    return {response.substr(0, response.find("\r\n")), json::parse(response.substr(headerEnd + 4), nullptr, false)};
+}
+
+int main()
+{
+    StandInServer server;
+
+    // what the ui asks for when a page loads
+    json jPageLoad = json::array({});
+    for (const char *name : {"Data", "GetRunningSchedule", "GetMashSchedules", "GetTempSettings", "GetHeaterSettings", "GetPIDSettings", "GetSystemSettings"})
+    {
+        jPageLoad.push_back({{"command", name}, {"data", nullptr}});
+    }
+
+    // the batch answers the same as the commands one by one, in order
+    auto [status, jResults] = post(server.port, jPageLoad);
+    CHECK(status == "HTTP/1.1 200 OK");
+    CHECK(jResults.is_array() && jResults.size() == jPageLoad.size());
+    for (size_t i = 0; i < jPageLoad.size(); i++)
+    {
+        auto [singleStatus, jSingle] = post(server.port, jPageLoad[i]);
+        CHECK(jSingle == jResults[i]);
+        CHECK(jSingle["success"] == true);
+    }
+
+    // unknown commands fail on their own, too many in one are refused as a whole
+    auto [mixedStatus, jMixed] = post(server.port, json::parse(R"([{"command":"Data"},{"command":"Nope"}])"));
+    CHECK(jMixed[0]["success"] == true && jMixed[1]["success"] == false);
+    json jTooMany = json::array({});
+    for (int i = 0; i <= API_MAX_BATCH_COMMANDS; i++)
+    {
+        jTooMany.push_back({{"command", "Data"}});
+    }
+    CHECK(post(server.port, jTooMany).first == "HTTP/1.1 400 Bad Request");
+
+    // a streamed result shows the state right after its own command, not what later commands in the batch did
+    post(server.port, {{"command", "Start"}});
+    auto [stopStatus, jStop] = post(server.port, json::parse(R"([{"command":"GetRunningSchedule"},{"command":"Stop"},{"command":"GetRunningSchedule"}])"));
+    CHECK(jStop.is_array() && jStop.size() == 3);
+    CHECK(jStop[0]["data"]["running"] == true);
+    CHECK(jStop[1]["success"] == true);
+    CHECK(jStop[2]["data"]["running"] == false);
+
+    // latency of a page load, on loopback this is only the connection and httpd overhead, on wifi every request adds a round trip on top
+    const int loads = 200;
+    auto start = steady_clock::now();
+    for (int i = 0; i < loads; i++)
+    {
+        for (auto &jCommand : jPageLoad)
+        {
+            CHECK(post(server.port, jCommand).second.is_object());
+        }
+    }
+    double separate = (double)duration_cast<microseconds>(steady_clock::now() - start).count() / loads;
+
+    start = steady_clock::now();
+    for (int i = 0; i < loads; i++)
+    {
+        CHECK(post(server.port, jPageLoad).second.is_array());
+    }
+    double batched = (double)duration_cast<microseconds>(steady_clock::now() - start).count() / loads;
+
+    printf("page load of %zu commands on loopback: %zu requests %.0f us, one batch %.0f us\n", jPageLoad.size(), jPageLoad.size(), separate, batched);
+    CHECK(batched < separate);
+
+    return 0;
+}
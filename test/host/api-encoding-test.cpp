@@ -0,0 +1,160 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "json-writer.h"
+
+using namespace std::chrono;
+
+// a Data poll with the log since the last one and a running schedule, written like the api handler does
+static void writeData(JsonWriter &writer, size_t samples)
+{
+    writer.beginObject();
+    writer.key("temp");
+    writer.value(64.8);
+    writer.key("targetTemp");
+    writer.value(65.0);
+    writer.key("output");
+    writer.value(42);
+    writer.key("status");
+    writer.value("Running");
+    writer.key("runningVersion");
+    writer.value(31337);
+    writer.key("tempLog");
+    writer.beginArray();
+    for (size_t i = 0; i < samples; i++)
+    {
+        writer.beginObject();
+        writer.key("time");
+        writer.value((int64_t)(1700000000 + i * 5));
+        writer.key("temp");
+        writer.value(20 + (float)(i % 450) / 10);
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.endObject();
+}
+
+static void writeRunningSchedule(JsonWriter &writer, size_t steps)
+{
+    writer.beginObject();
+    writer.key("version");
+    writer.value(31337);
+    writer.key("steps");
+    writer.beginArray();
+    for (size_t i = 0; i < steps; i++)
+    {
+        writer.beginObject();
+        writer.key("time");
+        writer.value((int64_t)(1700000000 + i * 60));
+        writer.key("temperature");
+        writer.value(50 + (int)(i % 30));
+        writer.key("extendIfNeeded");
+        writer.value(i % 2 == 0);
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.endObject();
+}
+
+// average microseconds of a run over a number of repeats
+static double timed(int repeats, std::function<void()> run)
+{
+    auto start = steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+    {
+        run();
+    }
+    return (double)duration_cast<nanoseconds>(steady_clock::now() - start).count() / repeats / 1000;
+}
+
+static void compare(const char *name, std::function<void(JsonWriter &writer)> write)
+{
+    const int repeats = 50;
+
+    string text;
+    JsonWriter streamer([&text](const char *data, size_t length)
+                        {
+        text.append(data, length);
+        return true; });
+    write(streamer);
+    CHECK(streamer.flush());
+
+    json jDocument;
+    JsonWriter builder(jDocument);
+    write(builder);
+
+    std::vector<uint8_t> msgpack = json::to_msgpack(jDocument);
+    std::vector<uint8_t> cbor = json::to_cbor(jDocument);
+
+    // all three decode to the same document, the client gets the same whatever it asks for
+    CHECK(json::from_msgpack(msgpack) == jDocument);
+    CHECK(json::from_cbor(cbor) == jDocument);
+    CHECK(json::parse(text).size() == jDocument.size());
+
+    double textEncode = timed(repeats, [&]()
+                              {
+        size_t length = 0;
+        JsonWriter writer([&length](const char *, size_t chunk)
+                          {
+            length += chunk;
+            return true; });
+        write(writer);
+        writer.flush(); });
+    double msgpackEncode = timed(repeats, [&]()
+                                 {
+        json jResult;
+        JsonWriter writer(jResult);
+        write(writer);
+        CHECK(!json::to_msgpack(jResult).empty()); });
+    double cborEncode = timed(repeats, [&]()
+                              {
+        json jResult;
+        JsonWriter writer(jResult);
+        write(writer);
+        CHECK(!json::to_cbor(jResult).empty()); });
+
+    double textDecode = timed(repeats, [&]()
+                              { CHECK(!json::parse(text, nullptr, false).is_discarded()); });
+    double msgpackDecode = timed(repeats, [&]()
+                                 { CHECK(!json::from_msgpack(msgpack, true, false).is_discarded()); });
+    double cborDecode = timed(repeats, [&]()
+                              { CHECK(!json::from_cbor(cbor, true, false).is_discarded()); });
+
+    printf("%-26s json %6zu bytes %7.1f/%7.1f us, msgpack %6zu bytes %7.1f/%7.1f us, cbor %6zu bytes %7.1f/%7.1f us (encode/decode)\n",
+           name, text.size(), textEncode, textDecode, msgpack.size(), msgpackEncode, msgpackDecode, cbor.size(), cborEncode, cborDecode);
+
+    CHECK(msgpack.size() < text.size());
+    CHECK(cbor.size() < text.size());
+}
+
+// a command posted as msgpack reads the same as the json one
+static void testCommand()
+{
+    json jCommand = json::parse(R"({"command":"SetTemp","data":{"targetTemp":65.5}})");
+    std::vector<uint8_t> msgpack = json::to_msgpack(jCommand);
+    std::vector<uint8_t> cbor = json::to_cbor(jCommand);
+
+    CHECK(json::from_msgpack(msgpack.begin(), msgpack.end(), true, false) == jCommand);
+    CHECK(json::from_cbor(cbor.begin(), cbor.end(), true, false) == jCommand);
+
+    // a damaged body is discarded, not thrown
+    msgpack.resize(msgpack.size() - 3);
+    CHECK(json::from_msgpack(msgpack.begin(), msgpack.end(), true, false).is_discarded());
+}
+
+int main()
+{
+    testCommand();
+
+    compare("Data, 10 samples", [](JsonWriter &writer)
+            { writeData(writer, 10); });
+    compare("Data, 1000 samples", [](JsonWriter &writer)
+            { writeData(writer, 1000); });
+    compare("RunningSchedule, 60 steps", [](JsonWriter &writer)
+            { writeRunningSchedule(writer, 60); });
+
+    return 0;
+}
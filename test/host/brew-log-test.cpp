@@ -0,0 +1,185 @@
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+#include <unistd.h>
+#include "check.h"
+#include "brew-log.h"
+
+// the flash is a temporary directory, spiffs is a plain file system to the log as well
+static string makeDirectory()
+{
+    char directory[] = "/tmp/brew-log-test-XXXXXX";
+    CHECK(mkdtemp(directory) != nullptr);
+    return directory;
+}
+
+static std::vector<ChannelHistory::Channel> channels()
+{
+    return {
+        {"sensor1", 10, true},
+        {"output", 1, true},
+        {"unused", 1, false},
+    };
+}
+
+static long fileSize(const string &path)
+{
+    std::error_code error;
+    auto size = std::filesystem::file_size(path, error);
+    return error ? -1 : (long)size;
+}
+
+static size_t readCount(const BrewLog &log, time_t id, time_t *last = nullptr)
+{
+    size_t count = 0;
+    log.read(id, [](const json &) {}, [&count, last](time_t time, const std::vector<float> &)
+             {
+                 count++;
+                 if (last != nullptr)
+                 {
+                     *last = time;
+                 } });
+    return count;
+}
+
+// what goes in comes out, at the precision of each channel
+static void testRoundTrip(const string &directory)
+{
+    BrewLog log(256);
+    log.setDirectory(directory);
+
+    json header;
+    header["schedule"] = "Default";
+    CHECK(log.open(1000, header, channels()));
+
+    for (int i = 0; i < 200; i++)
+    {
+        float temperature = (i == 50) ? NAN : 20 + (i * 0.25f);
+        log.append(1000 + (i * 5), {temperature, (float)(i % 100), 7});
+    }
+    log.close();
+
+    json readHeader;
+    std::vector<std::pair<time_t, std::vector<float>>> samples;
+    CHECK(log.read(1000, [&readHeader](const json &header)
+                   { readHeader = header; },
+                   [&samples](time_t time, const std::vector<float> &values)
+                   { samples.push_back({time, values}); }));
+
+    CHECK(readHeader["schedule"] == "Default");
+    CHECK(readHeader["channels"].size() == 2);
+    CHECK(samples.size() == 200);
+    for (int i = 0; i < 200; i++)
+    {
+        CHECK(samples[i].first == 1000 + (i * 5));
+        CHECK(samples[i].second.size() == 2);
+        if (i == 50)
+        {
+            CHECK(std::isnan(samples[i].second[0]));
+        }
+        else
+        {
+            CHECK(std::fabs(samples[i].second[0] - (20 + (i * 0.25f))) < 0.06f); // stored in tenths
+        }
+        CHECK(samples[i].second[1] == i % 100);
+    }
+}
+
+// samples are collected in ram, the file only grows a block at a time
+static void testBatchedWrites(const string &directory)
+{
+    BrewLog log(256);
+    log.setDirectory(directory);
+    CHECK(log.open(2000, json::object(), channels()));
+
+    string path = directory + "/2000.log";
+    long size = fileSize(path);
+    size_t writes = 0;
+    const size_t samples = 2000;
+
+    for (size_t i = 0; i < samples; i++)
+    {
+        log.append(2000 + (i * 5), {65 + (float)(i % 7) / 10, 40, 0});
+
+        long newSize = fileSize(path);
+        if (newSize != size)
+        {
+            writes++;
+            size = newSize;
+        }
+    }
+    log.close();
+
+    CHECK(writes > 0);
+    CHECK(writes <= samples / 20);
+    CHECK(readCount(log, 2000) == samples);
+
+    printf("%zu samples in %zu writes, %.1f bytes per sample\n", samples, writes, (double)fileSize(path) / samples);
+}
+
+// a reboot can cut off the last block, the resumed run has to be readable after it
+static void testResumeAfterCutOffBlock(const string &directory)
+{
+    BrewLog log(64);
+    log.setDirectory(directory);
+    CHECK(log.open(3000, json::object(), channels()));
+    for (int i = 0; i < 40; i++)
+    {
+        log.append(3000 + (i * 5), {50.0f + i, 10, 0});
+    }
+    log.close();
+
+    string path = directory + "/3000.log";
+    CHECK(truncate(path.c_str(), fileSize(path) - 3) == 0);
+    size_t beforeResume = readCount(log, 3000);
+    CHECK(beforeResume > 0 && beforeResume < 40);
+
+    CHECK(log.open(3000, json::object(), channels()));
+    for (int i = 0; i < 10; i++)
+    {
+        log.append(4000 + (i * 5), {70.0f + i, 10, 0});
+    }
+    log.close();
+
+    time_t last = 0;
+    CHECK(readCount(log, 3000, &last) == beforeResume + 10);
+    CHECK(last == 4045);
+
+    // other sensors after the reboot don't fit in the same log
+    auto changed = channels();
+    changed[2].enabled = true;
+    CHECK(!log.open(3000, json::object(), changed));
+}
+
+static void testListAndRemove(const string &directory)
+{
+    BrewLog log;
+    log.setDirectory(directory);
+
+    std::vector<time_t> ids;
+    log.list([&ids](time_t id, size_t)
+             { ids.push_back(id); });
+    CHECK((ids == std::vector<time_t>{1000, 2000, 3000}));
+
+    CHECK(log.open(5000, json::object(), channels()));
+    CHECK(!log.remove(5000)); // still open
+    log.close();
+
+    CHECK(log.remove(1000));
+    CHECK(log.readHeader(1000).empty());
+}
+
+int main()
+{
+    string directory = makeDirectory();
+
+    testRoundTrip(directory);
+    testBatchedWrites(directory);
+    testResumeAfterCutOffBlock(directory);
+    testListAndRemove(directory);
+
+    std::filesystem::remove_all(directory);
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include <cmath>
+#include <vector>
+#include "check.h"
+#include "channel-history.h"
+
+static ChannelHistory makeHistory(size_t bytes)
+{
+    ChannelHistory history;
+    history.reserve(bytes);
+    history.configure({
+        {"sensor1", 10, true},
+        {"output", 1, false},
+        {"target", 10, true},
+    });
+    return history;
+}
+
+// only enabled channels are stored, values come back at their scale and a missing value stays missing
+static void testValues()
+{
+    ChannelHistory history = makeHistory(1000);
+
+    history.push(100, {65.44f, 50, 66});
+    history.push(110, {NAN, 50, 66});
+
+    CHECK(history.size() == 2);
+    CHECK(history.find("sensor1") == 0);
+    CHECK(history.find("output") == string::npos);
+    CHECK(history.timeAt(1) == 110);
+    CHECK(std::fabs(history.valueAt(0, 0) - 65.4f) < 0.001f);
+    CHECK(std::isnan(history.valueAt(0, 1)));
+    CHECK(std::isnan(history.valueAt(1, 0)));
+    CHECK(history.valueAt(2, 1) == 66);
+
+    // values outside int16 are clamped, not wrapped
+    CHECK(ChannelHistory::toFixed(5000, 10) == std::numeric_limits<int16_t>::max());
+    CHECK(ChannelHistory::toFixed(NAN, 10) == ChannelHistory::missing);
+}
+
+// when full the oldest samples go, a time column and two value columns take 8 bytes per sample
+static void testOverwrite()
+{
+    ChannelHistory history = makeHistory(8 * 4);
+
+    for (int i = 0; i < 6; i++)
+    {
+        history.push(100 + (i * 10), {20.0f + i, 0, 50});
+    }
+
+    CHECK(history.size() == 4);
+    CHECK(history.timeAt(0) == 120);
+    CHECK(history.valueAt(0, 3) == 25);
+}
+
+// a range is cut in buckets so no more than the asked points come out, each the average of its samples
+static void testRange()
+{
+    ChannelHistory history = makeHistory(8000);
+
+    for (int i = 0; i < 100; i++)
+    {
+        history.push(1000 + i, {(float)i, 0, NAN});
+    }
+
+    ChannelHistory::Range range = history.range(1010, 1049, 10);
+    CHECK(range.first == 10);
+    CHECK(range.last == 50);
+    CHECK(range.every == 4);
+
+    std::vector<time_t> times;
+    history.times(range, [&times](time_t time)
+                  { times.push_back(time); });
+    CHECK(times.size() == 10);
+    CHECK(times[1] == 1014);
+
+    std::vector<float> values;
+    history.values(0, range, [&values](float value)
+                   { values.push_back(value); });
+    CHECK(values.size() == 10);
+    CHECK(values[0] == 11.5f); // 10 to 13
+
+    std::vector<float> targets;
+    history.values(2, range, [&targets](float value)
+                   { targets.push_back(value); });
+    CHECK(targets.size() == 10);
+    CHECK(std::isnan(targets[0]));
+}
+
+int main()
+{
+    testValues();
+    testOverwrite();
+    testRange();
+
+    return 0;
+}
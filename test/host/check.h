@@ -0,0 +1,18 @@
+#ifndef _Check_H_
+#define _Check_H_
+
+#include <cstdio>
+#include <cstdlib>
+
+// like assert, but also in release builds and it says what failed
+#define CHECK(condition)                                                                    \
+    do                                                                                      \
+    {                                                                                       \
+        if (!(condition))                                                                   \
+        {                                                                                   \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            exit(1);                                                                        \
+        }                                                                                   \
+    } while (0)
+
+#endif /* _Check_H_ */
@@ -0,0 +1,152 @@
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <string_view>
+#include "check.h"
+#include "command-table.h"
+#include "nlohmann_json.hpp"
+
+using namespace std::chrono;
+using json = nlohmann::json;
+
+struct TestCommand
+{
+    std::string_view name;
+    void (*handler)(json &data, int &result);
+};
+
+static void handle(json &data, int &result)
+{
+    result += data.size();
+}
+
+// the commands of the api, like findCommand in brew-engine.cpp
+static constexpr CommandTable<TestCommand, 37> commands({{
+    {"BootIntoRecovery", handle},
+    {"Data", handle},
+    {"DeleteBrewLog", handle},
+    {"DeleteMashSchedule", handle},
+    {"DetectTempSensors", handle},
+    {"FactoryReset", handle},
+    {"GetBrewLog", handle},
+    {"GetBrewLogs", handle},
+    {"GetChannelHistory", handle},
+    {"GetHeaterSettings", handle},
+    {"GetHistory", handle},
+    {"GetHistoryChannels", handle},
+    {"GetJob", handle},
+    {"GetMashSchedules", handle},
+    {"GetPIDSettings", handle},
+    {"GetRunningSchedule", handle},
+    {"GetSystemSettings", handle},
+    {"GetTempSettings", handle},
+    {"GetWifiSettings", handle},
+    {"ReadyBy", handle},
+    {"Reboot", handle},
+    {"SaveHeaterSettings", handle},
+    {"SaveHistoryChannels", handle},
+    {"SaveMashSchedule", handle},
+    {"SavePIDSettings", handle},
+    {"SaveSystemSettings", handle},
+    {"SaveTempSettings", handle},
+    {"SaveWifiSettings", handle},
+    {"ScanWifi", handle},
+    {"SetMashSchedule", handle},
+    {"SetOverrideOutput", handle},
+    {"SetTemp", handle},
+    {"Start", handle},
+    {"StartAt", handle},
+    {"StartStir", handle},
+    {"Stop", handle},
+    {"StopStir", handle},
+}});
+
+static_assert(commands.find("Data") != nullptr);
+static_assert(commands.find("Dat") == nullptr);
+
+// the if chain processCommand used to be, comparing one name after the other in the order they were added
+static const TestCommand *findLinear(const string &name)
+{
+    static const char *order[] = {"Data", "GetRunningSchedule", "SetTemp", "SetOverrideOutput", "Start", "StartStir", "Stop", "StopStir",
+                                  "GetMashSchedules", "SetMashSchedule", "SaveMashSchedule", "DeleteMashSchedule", "GetPIDSettings",
+                                  "SavePIDSettings", "GetTempSettings", "DetectTempSensors", "SaveTempSettings", "GetHeaterSettings",
+                                  "SaveHeaterSettings", "GetWifiSettings", "SaveWifiSettings", "ScanWifi", "GetSystemSettings",
+                                  "SaveSystemSettings", "Reboot", "FactoryReset", "BootIntoRecovery", "GetHistory", "GetJob", "StartAt",
+                                  "ReadyBy", "GetHistoryChannels", "SaveHistoryChannels", "GetChannelHistory", "GetBrewLogs",
+                                  "GetBrewLog", "DeleteBrewLog"};
+
+    for (const char *candidate : order)
+    {
+        if (name == candidate)
+        {
+            return commands.find(candidate);
+        }
+    }
+    return nullptr;
+}
+
+// average nanoseconds of a run
+static double timed(int repeats, std::function<void()> run)
+{
+    auto start = steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+    {
+        run();
+    }
+    return (double)duration_cast<nanoseconds>(steady_clock::now() - start).count() / repeats;
+}
+
+static void testFind()
+{
+    CHECK(commands.all().size() == 37);
+    for (auto const &command : commands.all())
+    {
+        CHECK(commands.find(command.name) == &command);
+        CHECK(findLinear(string(command.name)) == &command);
+    }
+
+    CHECK(commands.find("") == nullptr);
+    CHECK(commands.find("data") == nullptr);
+    CHECK(commands.find("StopStirr") == nullptr);
+    CHECK(commands.find("Zzz") == nullptr);
+    CHECK(commands.find("Aaa") == nullptr);
+}
+
+// lookup alone and a whole request: parse, look up, run the handler
+static void benchmark()
+{
+    const int repeats = 20000;
+    volatile int sink = 0;
+
+    for (const char *name : {"Data", "SetTemp", "GetBrewLog", "DeleteBrewLog", "Unknown"})
+    {
+        string command = name;
+        double table = timed(repeats, [&]()
+                             { sink = sink + (commands.find(command) != nullptr); });
+        double linear = timed(repeats, [&]()
+                              { sink = sink + (findLinear(command) != nullptr); });
+
+        string payload = "{\"command\":\"" + command + "\",\"data\":{\"targetTemp\":65.5}}";
+        double request = timed(repeats / 10, [&]()
+                               {
+            json jCommand = json::parse(payload);
+            string requested = jCommand["command"];
+            json data = std::move(jCommand["data"]);
+            int result = 0;
+            if (const TestCommand *found = commands.find(requested))
+            {
+                found->handler(data, result);
+            }
+            sink = sink + result; });
+
+        printf("%-14s lookup %5.1f ns, if chain %5.1f ns, parse and dispatch %6.1f ns\n", name, table, linear, request);
+    }
+}
+
+int main()
+{
+    testFind();
+    benchmark();
+    return 0;
+}
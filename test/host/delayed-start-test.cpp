@@ -0,0 +1,92 @@
+#include <chrono>
+#include <cstdio>
+#include "check.h"
+#include "delayed-start.h"
+
+using namespace std::chrono;
+
+// a kettle overnight: full power until the target, losing heat to the room in proportion to how warm it is
+struct Kettle
+{
+    float temperature;
+    uint32_t watt;
+    float volume;
+    float room = 18;
+    float lossPerMinute = 1.0f / 600; // cools down about 10 hours to room temperature
+
+    void minute(bool heating, float target)
+    {
+        this->temperature -= (this->temperature - this->room) * this->lossPerMinute;
+        if (heating && this->temperature < target)
+        {
+            this->temperature = std::min(target, this->temperature + DelayedStart::estimatedRate(this->watt, this->volume));
+        }
+    }
+};
+
+// runs the delayed start the way delayedStartLoop does, the start time is calculated again every minute while waiting
+// returns how many minutes before readyBy the target was reached, negative when late
+static int simulate(Kettle kettle, float learnedRate, float target, int stepTime, int minutesUntilReady)
+{
+    const float tempMargin = 0.5;
+
+    bool started = false;
+    for (int minute = 0; minute < minutesUntilReady + 600; minute++)
+    {
+        if (!started)
+        {
+            float rate = (learnedRate > 0) ? learnedRate : DelayedStart::estimatedRate(kettle.watt, kettle.volume);
+            float heatUp = DelayedStart::heatUpMinutes(kettle.temperature, target, rate, stepTime);
+            started = minute >= minutesUntilReady - heatUp;
+        }
+
+        kettle.minute(started, target);
+
+        if (started && kettle.temperature >= target - tempMargin)
+        {
+            return minutesUntilReady - (minute + 1);
+        }
+    }
+
+    return -600;
+}
+
+struct Scenario
+{
+    const char *name;
+    Kettle kettle;
+    float learnedRate;
+    float target;
+    int stepTime;
+};
+
+int main()
+{
+    // the rate a kettle really heats at is a bit lower than the wattage says, the rest goes to the room
+    Scenario scenarios[] = {
+        {"30l 3000W from wattage", {15, 3000, 30}, 0, 65, 0},
+        {"30l 3000W learned", {15, 3000, 30}, 1.35, 65, 0},
+        {"50l 3500W from wattage", {12, 3500, 50}, 0, 67, 0},
+        {"20l 2000W warm start", {45, 2000, 20}, 0, 52, 0},
+        {"20l 2000W long first step", {45, 2000, 20}, 0, 52, 30},
+        {"40l 5500W learned too high", {15, 5500, 40}, 2.2, 66, 0},
+    };
+
+    for (auto const &scenario : scenarios)
+    {
+        int early = simulate(scenario.kettle, scenario.learnedRate, scenario.target, scenario.stepTime, 8 * 60);
+        printf("%-28s ready %3d min early\n", scenario.name, early);
+
+        // never late, and not so early the mash sits for long
+        CHECK(early >= 0);
+        CHECK(early <= std::max(20, scenario.stepTime));
+    }
+
+    // already at temperature, only the margin for the pid is left
+    CHECK(DelayedStart::heatUpMinutes(70, 65, 1, 0) == 5);
+    CHECK(DelayedStart::heatUpMinutes(70, 65, 1, 15) == 15);
+    CHECK(DelayedStart::estimatedRate(0, 30) == 0);
+    CHECK(DelayedStart::estimatedRate(3000, 0) == 0);
+
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "check.h"
+#include "eta-predictor.h"
+
+using namespace std::chrono;
+
+struct PlannedStep
+{
+    int minute;
+    float temperature;
+    bool extendIfNeeded;
+};
+
+static ExecutionPlan makePlan(system_clock::time_point start, const std::vector<PlannedStep> &steps)
+{
+    ExecutionPlan plan;
+    for (auto const &planned : steps)
+    {
+        ExecutionStep step;
+        step.time = start + minutes(planned.minute);
+        step.temperature = planned.temperature;
+        step.extendIfNeeded = planned.extendIfNeeded;
+        plan.push_back(step);
+    }
+    return plan;
+}
+
+// a kettle that heats at a fixed rate towards the target, run the way the engine runs a plan:
+// a step is done at its time, an extended one also waits until the temperature is within the margin
+static system_clock::time_point simulate(const ExecutionPlan &plan, system_clock::time_point now, float temperature, float degreesPerMinute, float tempMargin)
+{
+    system_clock::time_point time = now;
+    seconds delay = seconds(0);
+
+    for (size_t i = 0; i < plan.size(); i++)
+    {
+        const ExecutionStep &step = plan.at(i);
+
+        while (true)
+        {
+            bool timeReached = time >= plan.timeOf(i) + delay;
+            bool temperatureReached = !step.extendIfNeeded || temperature >= step.temperature - tempMargin;
+
+            if (timeReached && temperatureReached)
+            {
+                break;
+            }
+
+            if (timeReached)
+            {
+                delay += seconds(1); // overtime
+            }
+
+            time += seconds(1);
+            temperature = std::min(step.temperature, temperature + (degreesPerMinute / 60));
+        }
+    }
+
+    return time;
+}
+
+static double minutesBetween(system_clock::time_point a, system_clock::time_point b)
+{
+    return std::fabs(duration<double>(a - b).count()) / 60;
+}
+
+// a ramp that falls behind pushes back the end, the prediction should match what the kettle really does
+static void testPredictsOvertime()
+{
+    auto start = system_clock::from_time_t(1700000000);
+    ExecutionPlan plan = makePlan(start, {{0, 20, false}, {10, 65, true}, {70, 65, false}, {80, 78, true}, {100, 78, false}});
+
+    EtaPredictor eta;
+    eta.update(plan, 0, start, 20, 1, 0.5);
+
+    system_clock::time_point simulated = simulate(plan, start, 20, 1, 0.5);
+
+    CHECK(eta.stepTimes.size() == plan.size());
+    CHECK(eta.endTime > plan.timeOf(plan.size() - 1));
+    CHECK(minutesBetween(eta.endTime, simulated) < 1);
+
+    // halfway the ramp, the prediction still agrees
+    auto later = start + minutes(20);
+    eta.update(plan, 1, later, 40, 1, 0.5);
+    CHECK(minutesBetween(eta.endTime, simulated) < 1);
+
+    printf("planned end %+.1f min, predicted %+.1f min, simulated %+.1f min\n",
+           duration<double>(plan.timeOf(plan.size() - 1) - start).count() / 60,
+           duration<double>(eta.endTime - start).count() / 60,
+           duration<double>(simulated - start).count() / 60);
+}
+
+// without a known heating rate we can't predict anything, so the plan is all we have
+static void testUnknownRate()
+{
+    auto start = system_clock::from_time_t(1700000000);
+    ExecutionPlan plan = makePlan(start, {{0, 20, false}, {10, 65, true}, {70, 65, false}});
+
+    EtaPredictor eta;
+    eta.update(plan, 0, start, 20, 0, 0.5);
+
+    for (size_t i = 0; i < plan.size(); i++)
+    {
+        CHECK(eta.stepTimes[i] == plan.timeOf(i));
+    }
+}
+
+// steps that are already done keep the time they got
+static void testDoneStepsKeepTheirTime()
+{
+    auto start = system_clock::from_time_t(1700000000);
+    ExecutionPlan plan = makePlan(start, {{0, 20, false}, {10, 65, true}, {70, 65, false}});
+
+    EtaPredictor eta;
+    eta.update(plan, 0, start, 20, 1, 0.5);
+    auto firstStepDone = eta.stepTimes[1];
+
+    eta.update(plan, 2, start + minutes(60), 65, 1, 0.5);
+    CHECK(eta.stepTimes[1] == firstStepDone);
+    CHECK(eta.stepTimes[2] == plan.timeOf(2));
+}
+
+int main()
+{
+    testPredictsOvertime();
+    testUnknownRate();
+    testDoneStepsKeepTheirTime();
+
+    return 0;
+}
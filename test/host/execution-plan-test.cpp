@@ -0,0 +1,120 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include "check.h"
+#include "execution-plan.h"
+
+using namespace std::chrono;
+
+static ExecutionPlan makePlan(system_clock::time_point start, size_t steps)
+{
+    ExecutionPlan plan;
+    for (size_t i = 0; i < steps; i++)
+    {
+        ExecutionStep step;
+        step.time = start + minutes(10 * i);
+        step.temperature = 50 + (i % 30);
+        step.extendIfNeeded = (i % 2) == 0;
+        plan.push_back(step);
+    }
+    return plan;
+}
+
+// overtime moves the step it happened at and everything after it, not what came before
+static void testShift()
+{
+    auto start = system_clock::from_time_t(1700000000);
+    ExecutionPlan plan = makePlan(start, 5);
+
+    plan.shift(2, seconds(90));
+    plan.shift(2, seconds(30)); // same step again
+    plan.shift(4, seconds(60));
+
+    CHECK(plan.timeOf(1) == start + minutes(10));
+    CHECK(plan.timeOf(2) == start + minutes(20) + seconds(120));
+    CHECK(plan.timeOf(3) == start + minutes(30) + seconds(120));
+    CHECK(plan.timeOf(4) == start + minutes(40) + seconds(180));
+    CHECK(plan.offset() == seconds(180));
+
+    // what a checkpoint stores gives the same plan again
+    ExecutionPlan replayed = makePlan(start, 5);
+    plan.eachShift([&replayed](size_t fromIndex, seconds extra)
+                   { replayed.shift(fromIndex, extra); });
+    for (size_t i = 0; i < plan.size(); i++)
+    {
+        CHECK(replayed.timeOf(i) == plan.timeOf(i));
+    }
+}
+
+static void testIndexAfter()
+{
+    auto start = system_clock::from_time_t(1700000000);
+    ExecutionPlan plan = makePlan(start, 5);
+    plan.shift(3, seconds(300));
+
+    CHECK(plan.indexAfter(start - seconds(1)) == 0);
+    CHECK(plan.indexAfter(start) == 1);
+    CHECK(plan.indexAfter(start + minutes(30)) == 3); // step 3 moved to 35 minutes
+    CHECK(plan.indexAfter(start + minutes(35)) == 4);
+    CHECK(plan.indexAfter(start + minutes(100)) == 5);
+}
+
+// the json clients get has the shifted times
+static void testWrite()
+{
+    auto start = system_clock::from_time_t(1700000000);
+    ExecutionPlan plan = makePlan(start, 3);
+    plan.shift(1, seconds(45));
+
+    string output;
+    JsonWriter writer([&output](const char *data, size_t length)
+                      { output.append(data, length); return true; });
+    plan.write(writer);
+    CHECK(writer.flush());
+
+    json jSteps = json::parse(output);
+    CHECK(jSteps.size() == 3);
+    for (size_t i = 0; i < plan.size(); i++)
+    {
+        CHECK(jSteps[i]["time"].get<int64_t>() == system_clock::to_time_t(plan.timeOf(i)));
+    }
+}
+
+// a plan with thousands of steps, overtime on every step and a lookup of the current step each second
+static void benchmark()
+{
+    const size_t steps = 5000;
+    auto start = system_clock::from_time_t(1700000000);
+    ExecutionPlan plan = makePlan(start, steps);
+
+    auto begin = steady_clock::now();
+    for (size_t i = 0; i < steps; i++)
+    {
+        plan.shift(i, seconds(5));
+    }
+    auto shifted = steady_clock::now();
+
+    size_t found = 0;
+    for (size_t i = 0; i < steps; i++)
+    {
+        found += plan.indexAfter(start + minutes(10 * i));
+    }
+    auto looked = steady_clock::now();
+
+    CHECK(plan.offset() == seconds(5 * steps));
+    CHECK(found > 0);
+
+    printf("%zu steps: shift %.3f us, indexAfter %.3f us\n", steps,
+           duration<double, std::micro>(shifted - begin).count() / steps,
+           duration<double, std::micro>(looked - shifted).count() / steps);
+}
+
+int main()
+{
+    testShift();
+    testIndexAfter();
+    testWrite();
+    benchmark();
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+#ifndef _HeapCounter_H_
+#define _HeapCounter_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// The host has no heap_caps_get_largest_free_block, instead every allocation through new is counted.
+// Include from one file of a test only, it replaces the global operator new and delete.
+namespace HeapCounter
+{
+    inline size_t liveBytes = 0;
+    inline size_t peakBytes = 0;
+    inline size_t allocations = 0;
+
+    // peak from here on
+    inline void resetPeak()
+    {
+        peakBytes = liveBytes;
+    }
+}
+
+void *operator new(size_t size)
+{
+    // room in front for the size, so delete knows what it releases
+    size_t *block = (size_t *)malloc(size + sizeof(max_align_t));
+    if (block == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    *block = size;
+
+    HeapCounter::liveBytes += size;
+    HeapCounter::peakBytes = std::max(HeapCounter::peakBytes, HeapCounter::liveBytes);
+    HeapCounter::allocations++;
+
+    return (char *)block + sizeof(max_align_t);
+}
+
+void operator delete(void *memory) noexcept
+{
+    if (memory == nullptr)
+    {
+        return;
+    }
+
+    size_t *block = (size_t *)((char *)memory - sizeof(max_align_t));
+    HeapCounter::liveBytes -= *block;
+    free(block);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    operator delete(memory);
+}
+
+#endif /* _HeapCounter_H_ */
@@ -0,0 +1,212 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "heap-counter.h"
+#include "json-writer.h"
+#include "temperature-history.h"
+
+using namespace std::chrono;
+
+using Sample = TemperatureHistory::Sample;
+
+static std::vector<Sample> makeLog(size_t length)
+{
+    std::vector<Sample> log;
+    log.reserve(length);
+    for (size_t i = 0; i < length; i++)
+    {
+        log.push_back({(time_t)(1700000000 + i * 5), 20 + (float)(i % 500) / 10});
+    }
+    return log;
+}
+
+// the Data response like it was built before, the whole log as a dom that is then dumped to one string
+static string domData(const std::vector<Sample> &log)
+{
+    json jTempLog = json::array({});
+    for (auto const &sample : log)
+    {
+        json jSample;
+        jSample["time"] = sample.time;
+        jSample["temp"] = sample.temperature;
+        jTempLog.push_back(jSample);
+    }
+
+    json jData;
+    jData["temp"] = 65.2;
+    jData["status"] = "Running";
+    jData["lastLogDateTime"] = log.back().time;
+    jData["tempLog"] = jTempLog;
+
+    return jData.dump();
+}
+
+// the same response streamed, like the Data handler does
+static void streamData(JsonWriter &writer, const std::vector<Sample> &log)
+{
+    writer.beginObject();
+    writer.key("temp");
+    writer.value(65.2);
+    writer.key("status");
+    writer.value("Running");
+    writer.key("lastLogDateTime");
+    writer.value(log.back().time);
+    writer.key("tempLog");
+    writer.beginArray();
+    for (auto const &sample : log)
+    {
+        writer.beginObject();
+        writer.key("time");
+        writer.value(sample.time);
+        writer.key("temp");
+        writer.value(sample.temperature);
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.endObject();
+}
+
+static string streamed(std::function<void(JsonWriter &writer)> write)
+{
+    string output;
+    JsonWriter writer([&output](const char *data, size_t length)
+                      {
+        output.append(data, length);
+        return true; });
+    write(writer);
+    CHECK(writer.flush());
+    return output;
+}
+
+// escaping, nesting, and what json can't hold
+static void testOutput()
+{
+    string output = streamed([](JsonWriter &writer)
+                             {
+        writer.beginObject();
+        writer.key("text");
+        writer.value("quote \" backslash \\ newline \n tab \t bell \a");
+        writer.key("empty");
+        writer.beginArray();
+        writer.endArray();
+        writer.key("nested");
+        writer.beginArray();
+        writer.beginObject();
+        writer.endObject();
+        writer.value(-12);
+        writer.value(true);
+        writer.null();
+        writer.endArray();
+        writer.key("nan");
+        writer.value(NAN);
+        writer.key("raw");
+        writer.raw("{\"a\":[1,2]}");
+        writer.endObject(); });
+
+    json parsed = json::parse(output);
+    CHECK(parsed["text"] == "quote \" backslash \\ newline \n tab \t bell \a");
+    CHECK(parsed["empty"] == json::array());
+    CHECK(parsed["nested"] == json::parse("[{},-12,true,null]"));
+    CHECK(parsed["nan"].is_null());
+    CHECK(parsed["raw"]["a"][1] == 2);
+
+    // building a json value gives the same document
+    json built;
+    JsonWriter builder(built);
+    builder.beginObject();
+    builder.key("nested");
+    builder.beginArray();
+    builder.beginObject();
+    builder.key("x");
+    builder.value(1.5);
+    builder.endObject();
+    builder.value("y");
+    builder.endArray();
+    builder.endObject();
+    CHECK(built == json::parse("{\"nested\":[{\"x\":1.5},\"y\"]}"));
+}
+
+// the output goes in chunks of at most the buffer size, a failed chunk stops the rest
+static void testChunks()
+{
+    std::vector<Sample> log = makeLog(1000);
+
+    size_t chunks = 0;
+    size_t largest = 0;
+    JsonWriter writer([&](const char *, size_t length)
+                      {
+        chunks++;
+        largest = std::max(largest, length);
+        return chunks < 3; });
+    streamData(writer, log);
+    CHECK(!writer.flush());
+    CHECK(chunks == 3);
+    CHECK(largest == 512);
+}
+
+// the streamed response is the same document, it takes a fixed amount of heap however long the log is
+static void compareWithDom()
+{
+    for (size_t length : {100, 1000, 5000})
+    {
+        std::vector<Sample> log = makeLog(length);
+
+        json jStreamed = json::parse(streamed([&log](JsonWriter &writer)
+                                              { streamData(writer, log); }));
+        json jDom = json::parse(domData(log));
+        CHECK(jStreamed.size() == jDom.size());
+        CHECK(jStreamed["tempLog"].size() == length);
+
+        // the dom widens floats to double, the writer prints them shortest, as floats they are the same
+        for (size_t i = 0; i < length; i++)
+        {
+            CHECK(jStreamed["tempLog"][i]["time"] == jDom["tempLog"][i]["time"]);
+            CHECK(jStreamed["tempLog"][i]["temp"].get<float>() == jDom["tempLog"][i]["temp"].get<float>());
+        }
+
+        HeapCounter::resetPeak();
+        size_t before = HeapCounter::liveBytes;
+        size_t allocations = HeapCounter::allocations;
+        auto start = steady_clock::now();
+
+        size_t sent = domData(log).size(); // httpd_resp_sendstr
+
+        auto domTime = duration_cast<microseconds>(steady_clock::now() - start).count();
+        size_t domPeak = HeapCounter::peakBytes - before;
+        size_t domAllocations = HeapCounter::allocations - allocations;
+
+        HeapCounter::resetPeak();
+        allocations = HeapCounter::allocations;
+        start = steady_clock::now();
+
+        size_t streamedBytes = 0;
+        JsonWriter writer([&streamedBytes](const char *, size_t length)
+                          {
+            streamedBytes += length; // httpd_resp_send_chunk
+            return true; });
+        streamData(writer, log);
+        CHECK(writer.flush());
+
+        auto streamTime = duration_cast<microseconds>(steady_clock::now() - start).count();
+        size_t streamPeak = HeapCounter::peakBytes - before;
+        size_t streamAllocations = HeapCounter::allocations - allocations;
+
+        printf("%5zu samples, %6zu bytes: dom %7zu bytes peak %6zu allocations %5lld us, streamed %4zu bytes peak %2zu allocations %5lld us\n",
+               length, sent, domPeak, domAllocations, (long long)domTime, streamPeak, streamAllocations, (long long)streamTime);
+
+        CHECK(streamedBytes > 0);
+        CHECK(streamPeak < 1024);
+        CHECK(streamAllocations < 10);
+    }
+}
+
+int main()
+{
+    testOutput();
+    testChunks();
+    compareWithDom();
+    return 0;
+}
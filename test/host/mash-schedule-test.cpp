@@ -0,0 +1,86 @@
+#include <cstdio>
+#include <map>
+#include "check.h"
+#include "heap-counter.h"
+#include "mash-schedule.h"
+
+static json makeSchedule(const string &name, int variant)
+{
+    MashSchedule schedule;
+    schedule.name = name;
+    for (int i = 0; i < 6; i++)
+    {
+        MashStep &step = schedule.steps.emplace_back();
+        step.index = i;
+        step.name = "Step " + std::to_string(i) + " of a schedule with a long name";
+        step.temperature = 50 + i * 5 + variant;
+        step.stepTime = 10 + variant;
+        step.time = 15;
+        step.extendStepTimeIfNeeded = true;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        Notification &notification = schedule.notifications.emplace_back();
+        notification.name = "Add hops " + std::to_string(i);
+        notification.message = "Time to add the next hop addition to the kettle";
+        notification.timeFromStart = 20 * i + variant;
+        notification.buzzer = true;
+    }
+    return schedule.to_json();
+}
+
+// what setMashSchedule and saveMashSchedule do: parse the posted schedule, replace the one in the map, serialize for nvs
+static void loadAndSave(std::map<string, MashSchedule> &schedules, const vector<uint8_t> &posted)
+{
+    json jSchedule = json::from_msgpack(posted, true, false);
+
+    MashSchedule schedule;
+    schedule.from_json(jSchedule);
+    string name = schedule.name;
+    schedules.insert_or_assign(name, std::move(schedule));
+
+    vector<uint8_t> serialized = json::to_msgpack(schedules[name].to_json());
+    CHECK(serialized.size() > 100);
+}
+
+int main()
+{
+    std::map<string, MashSchedule> schedules;
+
+    vector<vector<uint8_t>> posted;
+    for (int variant = 0; variant < 4; variant++)
+    {
+        posted.push_back(json::to_msgpack(makeSchedule("Schedule " + std::to_string(variant % 2), variant)));
+    }
+
+    // the first cycles fill the map, after that the same schedules are replaced over and over
+    for (auto const &serialized : posted)
+    {
+        loadAndSave(schedules, serialized);
+    }
+
+    // bytes that are still live after a cycle are what would fragment the heap on the esp over a long uptime
+    size_t baseline = HeapCounter::liveBytes;
+    size_t cyclePeak = 0;
+    size_t allocationsBefore = HeapCounter::allocations;
+    const int cycles = 1000;
+
+    for (int i = 0; i < cycles; i++)
+    {
+        HeapCounter::resetPeak();
+        loadAndSave(schedules, posted[i % posted.size()]);
+
+        // a replaced schedule is released as a whole, nothing stays behind
+        CHECK(HeapCounter::liveBytes == baseline);
+        cyclePeak = std::max(cyclePeak, HeapCounter::peakBytes - baseline);
+    }
+
+    CHECK(schedules.size() == 2);
+    CHECK(schedules["Schedule 1"].steps.size() == 6);
+    CHECK(schedules["Schedule 1"].notifications.size() == 3);
+
+    printf("%d load/save cycles: %zu bytes held by 2 schedules, %zu bytes more at most during a cycle, %zu allocations a cycle, 0 bytes leaked\n",
+           cycles, baseline, cyclePeak, (HeapCounter::allocations - allocationsBefore) / cycles);
+
+    return 0;
+}
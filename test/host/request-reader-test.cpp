@@ -0,0 +1,168 @@
+#include <cstdio>
+#include <string>
+#include "check.h"
+#include "heap-counter.h"
+#include "mash-schedule.h"
+#include "request-reader.h"
+
+#define API_MAX_REQUEST_SIZE 32768 // same as brew-engine.h
+#define API_MAX_RECV_TIMEOUTS 3
+
+static httpd_req_t makeRequest(const string &body)
+{
+    httpd_req_t req;
+    req.content_len = body.size();
+    req.body = body;
+    return req;
+}
+
+// a SaveMashSchedule of about 20k, like an imported recipe
+static string makeUpload()
+{
+    MashSchedule schedule;
+    schedule.name = "Imported recipe";
+    for (int i = 0; i < 170; i++)
+    {
+        MashStep &step = schedule.steps.emplace_back();
+        step.index = i;
+        step.name = "Rest " + std::to_string(i);
+        step.temperature = 50 + (i % 30);
+        step.stepTime = 10;
+        step.time = 20;
+        step.extendStepTimeIfNeeded = true;
+    }
+
+    json jCommand = {{"command", "SaveMashSchedule"}, {"data", schedule.to_json()}};
+    return jCommand.dump();
+}
+
+static json parse(RequestReader &reader)
+{
+    return json::parse(reader.begin(), reader.end(), nullptr, false);
+}
+
+// what apiPostHandler did before: the body in a string, parsed, then the data copied out
+static size_t bufferedPeak(const string &body)
+{
+    httpd_req_t req = makeRequest(body);
+    HeapCounter::resetPeak();
+    size_t before = HeapCounter::liveBytes;
+
+    string stringBuffer;
+    char buf[256];
+    size_t remaining = req.content_len;
+    while (remaining > 0)
+    {
+        int ret = httpd_req_recv(&req, buf, (std::min<size_t>)(remaining, sizeof(buf)));
+        CHECK(ret > 0);
+        remaining -= ret;
+        stringBuffer.append(buf, ret);
+    }
+    json jCommand = json::parse(stringBuffer);
+    json data = jCommand["data"];
+    CHECK(data["steps"].size() == 170);
+
+    return HeapCounter::peakBytes - before;
+}
+
+// what it does now: parsed while received, the data moved out
+static size_t streamedPeak(const string &body)
+{
+    httpd_req_t req = makeRequest(body);
+    HeapCounter::resetPeak();
+    size_t before = HeapCounter::liveBytes;
+
+    RequestReader reader(&req, API_MAX_REQUEST_SIZE, API_MAX_RECV_TIMEOUTS);
+    json jCommand = parse(reader);
+    json data = std::move(jCommand["data"]);
+    CHECK(!reader.failed());
+    CHECK(data["steps"].size() == 170);
+    CHECK(req.largestRead <= 256);
+
+    return HeapCounter::peakBytes - before;
+}
+
+static void testChunkBoundaries()
+{
+    // a string with multi byte characters that crosses the 256 byte buffer and the odd sized chunks the socket gives
+    json jExpected = {{"command", "SaveMashSchedule"}, {"data", {{"name", string(240, 'a') + "Weißbier ünd Märzen " + string(300, 'b')}}}};
+    string body = jExpected.dump();
+
+    httpd_req_t req = makeRequest(body);
+    req.script = {100, 7, 256, 1, 255};
+    RequestReader reader(&req, API_MAX_REQUEST_SIZE, API_MAX_RECV_TIMEOUTS);
+    json jCommand = parse(reader);
+
+    CHECK(!reader.failed());
+    CHECK(req.sent == body.size());
+    CHECK(jCommand == jExpected);
+}
+
+static void testTimeouts()
+{
+    string body = makeUpload();
+
+    // a slow client is waited for, as long as it doesn't time out too often in a row
+    httpd_req_t slow = makeRequest(body);
+    slow.script = {100, HTTPD_SOCK_ERR_TIMEOUT, HTTPD_SOCK_ERR_TIMEOUT, 100, HTTPD_SOCK_ERR_TIMEOUT, HTTPD_SOCK_ERR_TIMEOUT};
+    RequestReader slowReader(&slow, API_MAX_REQUEST_SIZE, API_MAX_RECV_TIMEOUTS);
+    json jSlow = parse(slowReader);
+    CHECK(!slowReader.failed() && !slowReader.timedOut());
+    CHECK(jSlow == json::parse(body));
+
+    // one that stops sending halfway gets a 408 instead of being waited for forever
+    httpd_req_t stalled = makeRequest(body);
+    stalled.script = {100, 256, HTTPD_SOCK_ERR_TIMEOUT, HTTPD_SOCK_ERR_TIMEOUT, HTTPD_SOCK_ERR_TIMEOUT, 256};
+    RequestReader stalledReader(&stalled, API_MAX_REQUEST_SIZE, API_MAX_RECV_TIMEOUTS);
+    json jStalled = parse(stalledReader);
+    CHECK(stalledReader.failed() && stalledReader.timedOut());
+    CHECK(jStalled.is_discarded());
+    CHECK(stalled.calls == 5);
+    CHECK(stalled.sent == 356);
+
+    // a closed socket fails without a 408
+    httpd_req_t closed = makeRequest(body);
+    closed.script = {100, HTTPD_SOCK_ERR_FAIL};
+    RequestReader closedReader(&closed, API_MAX_REQUEST_SIZE, API_MAX_RECV_TIMEOUTS);
+    json jClosed = parse(closedReader);
+    CHECK(closedReader.failed() && !closedReader.timedOut());
+    CHECK(jClosed.is_discarded());
+    CHECK(closed.calls == 2);
+}
+
+static void testLimit()
+{
+    // over the limit nothing is read, apiPostHandler answers 413
+    httpd_req_t big = makeRequest(string(API_MAX_REQUEST_SIZE + 1, ' '));
+    RequestReader bigReader(&big, API_MAX_REQUEST_SIZE, API_MAX_RECV_TIMEOUTS);
+    CHECK(bigReader.tooLarge());
+    CHECK(bigReader.begin() == bigReader.end());
+    CHECK(big.calls == 0);
+
+    // right at the limit is fine
+    json jCommand = {{"command", "SaveMashSchedule"}, {"data", {{"name", "x"}}}};
+    string body = jCommand.dump();
+    body.append(API_MAX_REQUEST_SIZE - body.size(), ' ');
+    httpd_req_t limit = makeRequest(body);
+    RequestReader limitReader(&limit, API_MAX_REQUEST_SIZE, API_MAX_RECV_TIMEOUTS);
+    CHECK(!limitReader.tooLarge());
+    CHECK(parse(limitReader) == jCommand);
+    CHECK(!limitReader.failed());
+}
+
+int main()
+{
+    testChunkBoundaries();
+    testTimeouts();
+    testLimit();
+
+    // peak heap while a schedule upload is received and its data taken out
+    string body = makeUpload();
+    CHECK(body.size() >= 20000 && body.size() < 24000);
+    size_t buffered = bufferedPeak(body);
+    size_t streamed = streamedPeak(body);
+    printf("upload of %zu bytes: peak heap buffered %zu, streamed %zu bytes, reads of at most 256 bytes\n", body.size(), buffered, streamed);
+    CHECK(streamed * 2 <= buffered);
+
+    return 0;
+}
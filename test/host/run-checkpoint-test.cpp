@@ -0,0 +1,139 @@
+#include <chrono>
+#include <vector>
+#include "check.h"
+#include "execution-plan.h"
+#include "run-checkpoint.h"
+
+using namespace std::chrono;
+
+static ExecutionPlan makePlan(system_clock::time_point start)
+{
+    ExecutionPlan plan;
+    for (int i = 0; i < 5; i++)
+    {
+        ExecutionStep step;
+        step.time = start + minutes(15 * i);
+        step.temperature = 60 + i;
+        plan.push_back(step);
+    }
+    return plan;
+}
+
+// what saveCheckpoint writes and readCheckpoint reads back
+static RunCheckpoint throughNvs(RunCheckpoint checkpoint)
+{
+    vector<uint8_t> serialized = json::to_msgpack(checkpoint.to_json());
+
+    json jCheckpoint = json::from_msgpack(serialized, true, false);
+    CHECK(jCheckpoint.is_object());
+
+    RunCheckpoint read;
+    read.from_json(jCheckpoint);
+    return read;
+}
+
+// a reboot halfway step 2, after an overtime on step 1, the plan comes back with the time we were down added
+static void testRebootMidStep()
+{
+    auto planStart = system_clock::from_time_t(1700000000);
+    ExecutionPlan plan = makePlan(planStart);
+    plan.shift(1, seconds(120));
+
+    RunCheckpoint checkpoint;
+    checkpoint.schedule = "Default";
+    checkpoint.planStart = system_clock::to_time_t(planStart);
+    checkpoint.startTemperature = 20;
+    plan.eachShift([&checkpoint](size_t fromIndex, seconds extra)
+                   { checkpoint.shifts.push_back({(uint16_t)fromIndex, (int32_t)extra.count()}); });
+    checkpoint.step = 2;
+    checkpoint.nextNotification = 1;
+    checkpoint.boostStatus = 1;
+    checkpoint.overrideTargetTemperature = 64.5f;
+    checkpoint.runStart = checkpoint.planStart;
+    checkpoint.savedAt = system_clock::to_time_t(plan.timeOf(2) - minutes(5));
+
+    RunCheckpoint resumed = throughNvs(checkpoint);
+    CHECK(resumed.sameState(checkpoint));
+    CHECK(resumed.savedAt == checkpoint.savedAt);
+    CHECK(!resumed.manualOverrideOutput.has_value());
+
+    // down for three minutes, then resume does what BrewEngine::resume does
+    time_t now = resumed.savedAt + 180;
+    ExecutionPlan rebuilt = makePlan(system_clock::from_time_t(resumed.planStart));
+    for (auto const &[fromIndex, extra] : resumed.shifts)
+    {
+        rebuilt.shift(fromIndex, seconds(extra));
+    }
+    rebuilt.shift(resumed.step, seconds(now - resumed.savedAt));
+
+    CHECK(rebuilt.timeOf(1) == plan.timeOf(1));
+    for (size_t i = 2; i < plan.size(); i++)
+    {
+        CHECK(rebuilt.timeOf(i) == plan.timeOf(i) + seconds(180));
+    }
+
+    // the step still has the five minutes it had left when we went down
+    CHECK(rebuilt.timeOf(2) - system_clock::from_time_t(now) == minutes(5));
+}
+
+// an imported schedule that was never saved goes along in the checkpoint
+static void testTemporarySchedule()
+{
+    RunCheckpoint checkpoint;
+    checkpoint.schedule = "Import";
+    checkpoint.temporarySchedule = {{"name", "Import"}, {"boil", false}, {"steps", json::array()}, {"notifications", json::array()}};
+
+    RunCheckpoint resumed = throughNvs(checkpoint);
+    CHECK(resumed.temporarySchedule == checkpoint.temporarySchedule);
+}
+
+static bool rejects(json jCheckpoint)
+{
+    try
+    {
+        RunCheckpoint checkpoint;
+        checkpoint.from_json(jCheckpoint);
+    }
+    catch (const json::exception &e)
+    {
+        return true;
+    }
+    return false;
+}
+
+// a damaged checkpoint throws, readCheckpoint drops it
+static void testDamaged()
+{
+    RunCheckpoint checkpoint;
+    checkpoint.shifts = {{1, 30}};
+    json jCheckpoint = checkpoint.to_json();
+    CHECK(!rejects(jCheckpoint));
+
+    for (const char *field : {"schedule", "planStart", "step", "shifts", "savedAt"})
+    {
+        json missing = jCheckpoint;
+        missing.erase(field);
+        CHECK(rejects(missing));
+    }
+
+    json wrongType = jCheckpoint;
+    wrongType["step"] = "two";
+    CHECK(rejects(wrongType));
+
+    json shortShift = jCheckpoint;
+    shortShift["shifts"] = json::array({json::array({1})});
+    CHECK(rejects(shortShift));
+
+    json noArray = jCheckpoint;
+    noArray["shifts"] = 5;
+    CHECK(rejects(noArray));
+}
+
+int main()
+{
+    testRebootMidStep();
+    testTemporarySchedule();
+    testDamaged();
+
+    return 0;
+}
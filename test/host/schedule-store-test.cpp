@@ -0,0 +1,113 @@
+#include <cstdio>
+#include <string>
+#include "check.h"
+#include "mash-schedule.h"
+#include "schedule-store.h"
+
+static json makeSchedule(const string &name, int temperature)
+{
+    MashSchedule schedule;
+    schedule.name = name;
+    for (int i = 0; i < 5; i++)
+    {
+        MashStep &step = schedule.steps.emplace_back();
+        step.index = i;
+        step.name = "Rest " + std::to_string(i);
+        step.temperature = temperature + i * 5;
+        step.stepTime = 10;
+        step.time = 20;
+        step.extendStepTimeIfNeeded = true;
+    }
+    Notification &notification = schedule.notifications.emplace_back();
+    notification.name = "Iodine test";
+    notification.timeFromStart = 60;
+    notification.buzzer = true;
+    return schedule.to_json();
+}
+
+static void reboot(SettingsManager &settings, ScheduleStore &store)
+{
+    settings.~SettingsManager();
+    new (&settings) SettingsManager();
+    settings.Init();
+    store = ScheduleStore();
+    store.init(&settings);
+}
+
+int main()
+{
+    fakeNvs = FakeNvs();
+    SettingsManager settings;
+    settings.Init();
+    ScheduleStore store;
+    store.init(&settings);
+    CHECK(!store.load());
+
+    // a library of recipes
+    const int library = 50;
+    json jLibrary = json::array({});
+    for (int i = 0; i < library; i++)
+    {
+        json jSchedule = makeSchedule("Recipe " + std::to_string(i), 50 + (i % 10));
+        store.save(jSchedule);
+        jLibrary.push_back(jSchedule);
+    }
+
+    // changing one writes only its own record
+    fakeNvs.resetCounts();
+    store.save(makeSchedule("Recipe 7", 62));
+    CHECK(fakeNvs.writes == 1);
+    CHECK(fakeNvs.commits == 1);
+    size_t recordBytes = fakeNvs.writtenBytes;
+
+    // a new one also writes the index, the record goes first
+    fakeNvs.resetCounts();
+    store.save(makeSchedule("New recipe", 64));
+    CHECK(fakeNvs.writes == 2);
+    CHECK(fakeNvs.commits == 1);
+
+    // deleting writes the index and erases the record, in that order
+    fakeNvs.resetCounts();
+    store.remove("New recipe");
+    CHECK(fakeNvs.writes == 1);
+    CHECK(fakeNvs.erases == 1);
+    CHECK(fakeNvs.commits == 2);
+    CHECK((fakeNvs.changed == std::vector<string>{"schedindex", "sched50"}));
+    CHECK(!store.contains("New recipe"));
+
+    // a freed record number is used again
+    store.save(makeSchedule("Other recipe", 64));
+    CHECK(fakeNvs.entries.contains("sched50"));
+    CHECK(!fakeNvs.entries.contains("sched51"));
+
+    // after a reboot only the index is read, records when a schedule is needed
+    reboot(settings, store);
+    fakeNvs.resetCounts();
+    CHECK(store.load());
+    CHECK(fakeNvs.reads == 2); // the size of the index, then the index
+    size_t names = 0;
+    store.names([&names](const string &)
+                { names++; });
+    CHECK(names == (size_t)library + 1);
+    CHECK(fakeNvs.reads == 2);
+
+    json jSchedule = store.read("Recipe 7");
+    CHECK(fakeNvs.reads == 4);
+    CHECK(jSchedule == makeSchedule("Recipe 7", 62));
+    CHECK(store.read("Recipe 3") == jLibrary[3]);
+    CHECK(store.read("Missing").is_null());
+
+    // a damaged record reads as missing
+    fakeNvs.entries["sched4"].data = {0xc1, 0x00};
+    reboot(settings, store);
+    CHECK(store.load());
+    CHECK(store.read("Recipe 4").is_null());
+
+    // what saving one schedule costs compared with the one blob of all of them, like before
+    size_t blobBytes = json::to_msgpack(jLibrary).size();
+    printf("%d schedules: saving one writes %zu bytes, the blob of all of them %zu bytes, boot reads the index instead of all schedules\n",
+           library, recordBytes, blobBytes);
+    CHECK(recordBytes * 10 < blobBytes);
+
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include <cstdio>
+#include <vector>
+#include "check.h"
+#include "settings-manager.h"
+
+// a small schema like brew-settings.h, that one needs sdkconfig
+namespace TestSettings
+{
+    inline constexpr Setting<uint8_t> buzzerTime{"buzzerTime", "buzzerTime", 2, 0, 60};
+    inline constexpr Setting<bool> invertOutputs{"invertOutputs", "invertOutputs", false};
+    inline constexpr Setting<uint16_t> pidLoopTime{"pidLoopTime", "pidLoopTime", 60, 1, 3600};
+    inline constexpr Setting<double> mashkP{"mashKp", "kP", 10, 0, 1000};
+    inline constexpr Setting<double> mashkI{"mashKi", "kI", 1, 0, 1000};
+    inline constexpr Setting<float> heatUpRate{"heatRate", "heatUpRate", 0, 0, 50};
+    inline constexpr TextSetting mqttUri{"mqttUri", "mqttUri", "", 256};
+    inline constexpr BlobSetting heaters{"heaters", Persistence::Immediate};
+}
+
+using namespace TestSettings;
+
+// what saving the pid form does, every field is set, in the form only some changed
+static void saveForm(SettingsManager &settings, double kP, double kI, uint16_t loopTime)
+{
+    settings.Set(mashkP, kP);
+    settings.Set(mashkI, kI);
+    settings.Set(pidLoopTime, loopTime);
+    settings.Set(buzzerTime, (uint8_t)2);
+    settings.Set(invertOutputs, false);
+    settings.Set(heatUpRate, 0.0f);
+    settings.Commit();
+}
+
+static void reboot(SettingsManager &settings)
+{
+    settings.~SettingsManager();
+    new (&settings) SettingsManager();
+    settings.Init();
+}
+
+// init reads everything but blobs once, after that reads stay in ram
+static void testReadsFromCache()
+{
+    fakeNvs = FakeNvs();
+    uint16_t loopTime = 30;
+    uint8_t buzzer = 5;
+    vector<uint8_t> blob(200, 7);
+    nvs_set_u16(1, "pidLoopTime", loopTime);
+    nvs_set_u8(1, "buzzerTime", buzzer);
+    nvs_set_blob(1, "heaters", blob.data(), blob.size());
+    fakeNvs.resetCounts();
+
+    SettingsManager settings;
+    settings.Init();
+    CHECK(fakeNvs.reads == 2);
+
+    for (int i = 0; i < 100; i++)
+    {
+        CHECK(settings.Get(pidLoopTime) == 30);
+        CHECK(settings.Get(buzzerTime) == 5);
+        CHECK(settings.Get(mashkP) == 10); // not stored, default
+    }
+    CHECK(fakeNvs.reads == 2);
+
+    // a blob is read when it is used, its size and then the data, and not kept in ram after
+    CHECK(settings.Get(heaters, {}) == blob);
+    CHECK(fakeNvs.reads == 4);
+    CHECK(settings.Get(heaters, {}) == blob);
+    CHECK(fakeNvs.reads == 6);
+    CHECK(settings.Contains("heaters"));
+
+    // a value out of range gives the default and isn't written
+    CHECK(!settings.Set(buzzerTime, (uint8_t)61));
+    CHECK(settings.Get(buzzerTime) == 5);
+    CHECK(fakeNvs.writes == 0);
+}
+
+// writes only what changed and commits once, unchanged saves don't touch the flash
+static void testSaveWritesChanges()
+{
+    fakeNvs = FakeNvs();
+    SettingsManager settings;
+    settings.Init();
+
+    saveForm(settings, 10, 1, 60);
+    fakeNvs.resetCounts();
+
+    saveForm(settings, 12, 1, 90);
+    CHECK(fakeNvs.writes == 2);
+    CHECK(fakeNvs.commits == 1);
+    CHECK(!fakeTimer.armed);
+
+    fakeNvs.resetCounts();
+    saveForm(settings, 12, 1, 90);
+    CHECK(fakeNvs.writes == 0);
+    CHECK(fakeNvs.commits == 0);
+}
+
+// a deferred setting nobody commits goes out when the timer runs out, all at once
+static void testDeferredCommit()
+{
+    fakeNvs = FakeNvs();
+    SettingsManager settings;
+    settings.Init();
+
+    settings.Set(heatUpRate, 1.5f);
+    settings.Set(mqttUri, string("mqtt://brewery"));
+    CHECK(fakeTimer.armed);
+    CHECK(fakeNvs.writes == 0);
+    CHECK(fakeNvs.commits == 0);
+
+    CHECK(fakeTimer.fire());
+    CHECK(fakeNvs.writes == 2);
+    CHECK(fakeNvs.commits == 1);
+
+    // nothing left, the timer isn't started again
+    CHECK(!fakeTimer.fire());
+    CHECK(fakeNvs.commits == 1);
+}
+
+// immediate settings are committed when set, erasing needs a commit too
+static void testImmediateAndErase()
+{
+    fakeNvs = FakeNvs();
+    SettingsManager settings;
+    settings.Init();
+
+    settings.Set(heaters, vector<uint8_t>{1, 2, 3});
+    CHECK(fakeNvs.writes == 1);
+    CHECK(fakeNvs.commits == 1);
+    CHECK(!fakeTimer.armed);
+
+    // once written it is released, like one loaded at boot
+    fakeNvs.reads = 0;
+    CHECK(settings.Get(heaters, {}) == (vector<uint8_t>{1, 2, 3}));
+    CHECK(fakeNvs.reads == 2);
+
+    settings.Erase("heaters");
+    CHECK(fakeNvs.erases == 1);
+    CHECK(!settings.Contains("heaters"));
+    CHECK(fakeTimer.fire());
+    CHECK(fakeNvs.commits == 2);
+    CHECK(!fakeNvs.entries.contains("heaters"));
+}
+
+// values come back after a reboot, floats and doubles by their bits
+static void testReboot()
+{
+    fakeNvs = FakeNvs();
+    SettingsManager settings;
+    settings.Init();
+
+    saveForm(settings, 12.25, 0.1, 90);
+    settings.Set(heatUpRate, 1.7f);
+    settings.Set(mqttUri, string("mqtt://brewery"));
+    settings.Set(invertOutputs, true);
+    settings.Commit();
+
+    reboot(settings);
+    CHECK(settings.Get(mashkP) == 12.25);
+    CHECK(settings.Get(mashkI) == 0.1);
+    CHECK(settings.Get(heatUpRate) == 1.7f);
+    CHECK(settings.Get(pidLoopTime) == 90);
+    CHECK(settings.Get(invertOutputs) == true);
+    CHECK(settings.Get(mqttUri) == "mqtt://brewery");
+}
+
+// a brew day of form saves compared with writing and committing every field like before the cache
+static void reportCounts()
+{
+    fakeNvs = FakeNvs();
+    SettingsManager settings;
+    settings.Init();
+
+    const int saves = 50;
+    const int fields = 6;
+    fakeNvs.resetCounts();
+    for (int i = 0; i < saves; i++)
+    {
+        saveForm(settings, 10 + (i % 5), 1, 60);
+        for (int j = 0; j < 20; j++)
+        {
+            settings.Get(mashkP);
+            settings.Get(pidLoopTime);
+        }
+    }
+
+    printf("%d form saves: %zu reads %zu writes %zu commits, without the cache %d reads %d writes %d commits\n",
+           saves, fakeNvs.reads, fakeNvs.writes, fakeNvs.commits, saves * 20 * 2, saves * fields, saves * fields);
+    CHECK(fakeNvs.reads == 0);
+    CHECK(fakeNvs.writes == (size_t)(fields + saves - 1)); // the first save stores every field, the others only kP
+    CHECK(fakeNvs.commits == (size_t)saves);
+}
+
+int main()
+{
+    testReadsFromCache();
+    testSaveWritesChanges();
+    testDeferredCommit();
+    testImmediateAndErase();
+    testReboot();
+    reportCounts();
+    return 0;
+}
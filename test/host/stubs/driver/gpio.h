@@ -0,0 +1,3 @@
+#pragma once
+
+#define GPIO_NUM_MAX 49
@@ -0,0 +1,31 @@
+#pragma once
+
+// the part of esp-idf's esp_err.h the code under test uses
+#include <cstdio>
+#include <cstdlib>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERR_NVS_TYPE_MISMATCH 0x1103
+#define ESP_ERR_NVS_INVALID_LENGTH 0x110c
+#define ESP_ERR_NVS_NO_FREE_PAGES 0x110d
+#define ESP_ERR_NVS_NEW_VERSION_FOUND 0x1110
+
+#define ESP_ERROR_CHECK(x)                                                            \
+    do                                                                                \
+    {                                                                                 \
+        esp_err_t error = (x);                                                        \
+        if (error != ESP_OK)                                                          \
+        {                                                                             \
+            fprintf(stderr, "%s:%d: %s failed with %d\n", __FILE__, __LINE__, #x, error); \
+            abort();                                                                  \
+        }                                                                             \
+    } while (0)
+
+inline const char *esp_err_to_name(esp_err_t error)
+{
+    return (error == ESP_OK) ? "ESP_OK" : "ERROR";
+}
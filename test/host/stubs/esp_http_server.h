@@ -0,0 +1,50 @@
+#pragma once
+
+// a request whose body comes from a string, what httpd_req_recv returns can be scripted per call
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <string>
+#include "esp_err.h"
+
+#define HTTPD_SOCK_ERR_FAIL -1
+#define HTTPD_SOCK_ERR_INVALID -2
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+
+typedef struct httpd_req
+{
+    size_t content_len;
+    std::string body; // what the client sends
+    size_t sent = 0;
+    std::deque<int> script; // per call: at most this many bytes, or an HTTPD_SOCK_ERR_, all that is asked when empty
+    size_t calls = 0;
+    size_t largestRead = 0; // biggest length asked for in one call
+} httpd_req_t;
+
+inline int httpd_req_recv(httpd_req_t *req, char *buf, size_t buf_len)
+{
+    req->calls++;
+    req->largestRead = (buf_len > req->largestRead) ? buf_len : req->largestRead;
+
+    size_t length = buf_len;
+    if (!req->script.empty())
+    {
+        int next = req->script.front();
+        req->script.pop_front();
+        if (next < 0)
+        {
+            return next;
+        }
+        length = ((size_t)next < length) ? (size_t)next : length;
+    }
+
+    length = (req->body.size() - req->sent < length) ? req->body.size() - req->sent : length;
+    if (length == 0)
+    {
+        return HTTPD_SOCK_ERR_FAIL; // the client closed the connection
+    }
+
+    std::memcpy(buf, req->body.data() + req->sent, length);
+    req->sent += length;
+    return (int)length;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// one timer that only fires when the test says so
+#include <cstdint>
+#include "esp_err.h"
+
+typedef void (*esp_timer_cb_t)(void *arg);
+typedef struct FakeTimer *esp_timer_handle_t;
+
+typedef enum
+{
+    ESP_TIMER_TASK
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+struct FakeTimer
+{
+    esp_timer_cb_t callback = nullptr;
+    void *arg = nullptr;
+    bool armed = false;
+
+    // runs the callback when the timer was started, like the time ran out
+    bool fire()
+    {
+        if (!this->armed)
+        {
+            return false;
+        }
+        this->armed = false;
+        this->callback(this->arg);
+        return true;
+    }
+};
+
+inline FakeTimer fakeTimer;
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle)
+{
+    fakeTimer = FakeTimer();
+    fakeTimer.callback = args->callback;
+    fakeTimer.arg = args->arg;
+    *handle = &fakeTimer;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t)
+{
+    timer->armed = true;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    timer->armed = false;
+    return ESP_OK;
+}
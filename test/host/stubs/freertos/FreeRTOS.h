@@ -0,0 +1,3 @@
+#pragma once
+
+// nothing of freertos is used by the code under test, the includes just have to resolve
@@ -0,0 +1,232 @@
+#pragma once
+
+// nvs in memory, one namespace, it counts every call so tests can see how often the flash would be touched
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "esp_err.h"
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum
+{
+    NVS_READONLY,
+    NVS_READWRITE
+} nvs_open_mode_t;
+
+typedef enum
+{
+    NVS_TYPE_U8 = 0x01,
+    NVS_TYPE_I8 = 0x11,
+    NVS_TYPE_U16 = 0x02,
+    NVS_TYPE_I16 = 0x12,
+    NVS_TYPE_U32 = 0x04,
+    NVS_TYPE_I32 = 0x14,
+    NVS_TYPE_U64 = 0x08,
+    NVS_TYPE_I64 = 0x18,
+    NVS_TYPE_STR = 0x21,
+    NVS_TYPE_BLOB = 0x42,
+    NVS_TYPE_ANY = 0xff
+} nvs_type_t;
+
+typedef struct
+{
+    size_t used_entries;
+    size_t free_entries;
+    size_t total_entries;
+    size_t namespace_count;
+} nvs_stats_t;
+
+typedef struct
+{
+    char namespace_name[16];
+    char key[16];
+    nvs_type_t type;
+} nvs_entry_info_t;
+
+struct FakeNvs
+{
+    struct Entry
+    {
+        nvs_type_t type;
+        std::vector<uint8_t> data;
+    };
+
+    struct Iterator
+    {
+        std::vector<std::pair<std::string, nvs_type_t>> entries;
+        size_t index = 0;
+    };
+
+    std::map<std::string, Entry> entries;
+
+    size_t reads = 0;
+    size_t writes = 0;
+    size_t writtenBytes = 0;
+    size_t erases = 0;
+    size_t commits = 0;
+    std::vector<std::string> changed; // keys written or erased, in order
+
+    void resetCounts()
+    {
+        this->reads = 0;
+        this->writes = 0;
+        this->writtenBytes = 0;
+        this->erases = 0;
+        this->commits = 0;
+        this->changed.clear();
+    }
+
+    esp_err_t set(const char *key, nvs_type_t type, const void *data, size_t length)
+    {
+        this->writes++;
+        this->writtenBytes += length;
+        this->changed.push_back(key);
+        const uint8_t *bytes = (const uint8_t *)data;
+        this->entries.insert_or_assign(key, Entry{type, std::vector<uint8_t>(bytes, bytes + length)});
+        return ESP_OK;
+    }
+
+    // data null only asks for the length
+    esp_err_t get(const char *key, nvs_type_t type, void *data, size_t *length)
+    {
+        this->reads++;
+        auto found = this->entries.find(key);
+        if (found == this->entries.end())
+        {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        if (found->second.type != type)
+        {
+            return ESP_ERR_NVS_TYPE_MISMATCH;
+        }
+        if (data != nullptr)
+        {
+            if (*length < found->second.data.size())
+            {
+                return ESP_ERR_NVS_INVALID_LENGTH;
+            }
+            std::memcpy(data, found->second.data.data(), found->second.data.size());
+        }
+        *length = found->second.data.size();
+        return ESP_OK;
+    }
+};
+
+typedef FakeNvs::Iterator *nvs_iterator_t;
+
+inline FakeNvs fakeNvs;
+
+inline esp_err_t nvs_open(const char *, nvs_open_mode_t, nvs_handle_t *handle)
+{
+    *handle = 1;
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_get_stats(const char *, nvs_stats_t *stats)
+{
+    *stats = {fakeNvs.entries.size(), 1000, 1000 + fakeNvs.entries.size(), 1};
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_get_used_entry_count(nvs_handle_t, size_t *used)
+{
+    *used = fakeNvs.entries.size();
+    return ESP_OK;
+}
+
+#define FAKE_NVS_NUMBER(type, name, nvsType)                                        \
+    inline esp_err_t nvs_set_##name(nvs_handle_t, const char *key, type value) \
+    {                                                                                 \
+        return fakeNvs.set(key, nvsType, &value, sizeof(value));                      \
+    }                                                                                 \
+    inline esp_err_t nvs_get_##name(nvs_handle_t, const char *key, type *value) \
+    {                                                                                 \
+        size_t length = sizeof(type);                                                 \
+        return fakeNvs.get(key, nvsType, value, &length);                             \
+    }
+
+FAKE_NVS_NUMBER(uint8_t, u8, NVS_TYPE_U8)
+FAKE_NVS_NUMBER(int8_t, i8, NVS_TYPE_I8)
+FAKE_NVS_NUMBER(uint16_t, u16, NVS_TYPE_U16)
+FAKE_NVS_NUMBER(uint32_t, u32, NVS_TYPE_U32)
+FAKE_NVS_NUMBER(uint64_t, u64, NVS_TYPE_U64)
+
+inline esp_err_t nvs_set_str(nvs_handle_t, const char *key, const char *value)
+{
+    return fakeNvs.set(key, NVS_TYPE_STR, value, strlen(value) + 1);
+}
+
+inline esp_err_t nvs_get_str(nvs_handle_t, const char *key, char *value, size_t *length)
+{
+    return fakeNvs.get(key, NVS_TYPE_STR, value, length);
+}
+
+inline esp_err_t nvs_set_blob(nvs_handle_t, const char *key, const void *value, size_t length)
+{
+    return fakeNvs.set(key, NVS_TYPE_BLOB, value, length);
+}
+
+inline esp_err_t nvs_get_blob(nvs_handle_t, const char *key, void *value, size_t *length)
+{
+    return fakeNvs.get(key, NVS_TYPE_BLOB, value, length);
+}
+
+inline esp_err_t nvs_erase_key(nvs_handle_t, const char *key)
+{
+    fakeNvs.erases++;
+    fakeNvs.changed.push_back(key);
+    return fakeNvs.entries.erase(key) > 0 ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+inline esp_err_t nvs_commit(nvs_handle_t)
+{
+    fakeNvs.commits++;
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_entry_find(const char *, const char *, nvs_type_t, nvs_iterator_t *iterator)
+{
+    *iterator = nullptr;
+    if (fakeNvs.entries.empty())
+    {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    *iterator = new FakeNvs::Iterator();
+    for (auto const &[key, entry] : fakeNvs.entries)
+    {
+        (*iterator)->entries.push_back({key, entry.type});
+    }
+    return ESP_OK;
+}
+
+inline esp_err_t nvs_entry_next(nvs_iterator_t *iterator)
+{
+    (*iterator)->index++;
+    if ((*iterator)->index < (*iterator)->entries.size())
+    {
+        return ESP_OK;
+    }
+
+    delete *iterator;
+    *iterator = nullptr;
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+inline esp_err_t nvs_entry_info(nvs_iterator_t iterator, nvs_entry_info_t *info)
+{
+    auto const &[key, type] = iterator->entries[iterator->index];
+    *info = {};
+    strncpy(info->namespace_name, "Settings", sizeof(info->namespace_name) - 1);
+    strncpy(info->key, key.c_str(), sizeof(info->key) - 1);
+    info->type = type;
+    return ESP_OK;
+}
+
+inline void nvs_release_iterator(nvs_iterator_t iterator)
+{
+    delete iterator;
+}
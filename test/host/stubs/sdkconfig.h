@@ -0,0 +1,8 @@
+#pragma once
+
+// the menuconfig defaults brew-settings.h uses
+#define CONFIG_ONEWIRE 4
+#define CONFIG_STIR 5
+#define CONFIG_BUZZER 6
+#define CONFIG_MQTT_URI ""
+#define CONFIG_PID_LOOPTIME 60
@@ -0,0 +1,283 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <atomic>
+#include <map>
+#include <string>
+#include "check.h"
+#include "heap-counter.h"
+#include "telemetry-clients.h"
+#include "telemetry-delta.h"
+
+using namespace std::chrono;
+
+static float temperatureAt(int tick)
+{
+    return 60 + 5 * std::sin((float)tick / 300);
+}
+
+// roughly what telemetryState gives during a mash: the temperature moves every tick, most fields rarely
+static json makeState(int tick)
+{
+    float temperature = temperatureAt(tick);
+
+    json jTemps = json::array({});
+    for (int sensor = 0; sensor < 3; sensor++)
+    {
+        json jTemp;
+        jTemp["sensor"] = std::to_string(2887341234ull + sensor);
+        jTemp["temp"] = (double)((int)((temperature + sensor * 0.3) * 10)) / 10;
+        jTemps.push_back(jTemp);
+    }
+
+    return {
+        {"temp", (double)((int)(temperature * 10)) / 10},
+        {"temps", jTemps},
+        {"targetTemp", tick < 1800 ? 64.0 : 72.0},
+        {"manualOverrideTargetTemp", nullptr},
+        {"output", (tick / 10) % 100},
+        {"manualOverrideOutput", nullptr},
+        {"status", "Running"},
+        {"stirStatus", "Idle"},
+        {"runningVersion", 31337},
+        {"inOverTime", false},
+        {"boostStatus", 0},
+        {"delayedStartTime", nullptr},
+        {"predictedEnd", 1700005400},
+    };
+}
+
+struct Load
+{
+    double milliseconds = 0;
+    size_t peakBytes = 0;
+    size_t allocations = 0;
+    size_t sentBytes = 0;
+};
+
+// an hour of mashing at a tick a second, the log gets a sample every 5 seconds
+// polling: every client asks for Data each tick, the state and its log since its last poll are built and serialized for it
+// pushing: one delta serialized per tick, the same frame goes to every client
+static Load simulate(int clients, bool push)
+{
+    const int ticks = 3600;
+    const time_t start = 1700000000;
+
+    TemperatureHistory log;
+    log.reserve(16 * 1024);
+    TelemetryDelta delta;
+    std::vector<time_t> lastDates(clients, 0);
+
+    Load load;
+    size_t before = HeapCounter::liveBytes;
+    size_t allocations = HeapCounter::allocations;
+    HeapCounter::resetPeak();
+    auto begin = steady_clock::now();
+
+    for (int tick = 0; tick < ticks; tick++)
+    {
+        if (tick % 5 == 0)
+        {
+            log.push(start + tick, temperatureAt(tick));
+        }
+
+        if (push)
+        {
+            json jDelta = delta.update(makeState(tick), log);
+            if (!jDelta.empty())
+            {
+                load.sentBytes += jDelta.dump().size() * clients;
+            }
+            continue;
+        }
+
+        for (auto &lastDate : lastDates)
+        {
+            json jData = makeState(tick);
+            json jTempLog = json::array({});
+            for (size_t i = log.indexAfter(lastDate); i < log.size(); i++)
+            {
+                json jSample;
+                jSample["time"] = log.at(i).time;
+                jSample["temp"] = log.at(i).temperature;
+                jTempLog.push_back(jSample);
+            }
+            jData["lastLogDateTime"] = log.at(log.size() - 1).time;
+            jData["tempLog"] = jTempLog;
+            lastDate = log.at(log.size() - 1).time;
+
+            load.sentBytes += jData.dump().size();
+        }
+    }
+
+    load.milliseconds = (double)duration_cast<microseconds>(steady_clock::now() - begin).count() / 1000;
+    load.peakBytes = HeapCounter::peakBytes - before;
+    load.allocations = HeapCounter::allocations - allocations;
+
+    return load;
+}
+
+// a delta only has what changed, nothing when nothing did
+static void testDelta()
+{
+    TemperatureHistory log;
+    log.reserve(1024);
+    TelemetryDelta delta;
+
+    json jState = makeState(0);
+    log.push(1700000000, 60);
+    json jFirst = delta.update(jState, log);
+    CHECK(jFirst.size() == jState.size() + 1);
+    CHECK(jFirst["tempLog"].size() == 1);
+
+    CHECK(delta.update(jState, log).empty());
+
+    jState["output"] = 55;
+    log.push(1700000005, 60.2);
+    json jChanged = delta.update(jState, log);
+    CHECK(jChanged.size() == 2);
+    CHECK(jChanged["output"] == 55);
+    CHECK(jChanged["tempLog"].size() == 1);
+    CHECK(jChanged["tempLog"][0]["time"] == 1700000005);
+
+    // while nobody listens the log is skipped, not sent all at once later
+    log.push(1700000010, 60.4);
+    log.push(1700000015, 60.6);
+    delta.skipLog(log);
+    log.push(1700000020, 60.8);
+    json jAfterSkip = delta.update(jState, log);
+    CHECK(jAfterSkip["tempLog"].size() == 1);
+    CHECK(jAfterSkip["tempLog"][0]["time"] == 1700000020);
+}
+
+// the engine side of the push: pushTelemetry builds a frame on the read loop, sendTelemetry sends it on the httpd task later
+struct PushEngine
+{
+    TemperatureHistory log;
+    TelemetryDelta delta;
+    TelemetryClients clients;
+    std::atomic<bool> newClient = false;
+
+    // what every client knows of the state, rebuilt from the frames it got
+    std::map<int, json> received;
+    std::map<int, int> deltasBeforeFull;
+
+    PushEngine()
+    {
+        this->log.reserve(1024);
+    }
+
+    // the handshake in eventsHandler
+    void connect(int fd)
+    {
+        this->clients.add(fd);
+        this->newClient = true;
+    }
+
+    TelemetryFrame push(const json &jState)
+    {
+        TelemetryFrame frame;
+        json jDelta = this->delta.update(jState, this->log);
+        if (!jDelta.empty())
+        {
+            frame.delta = jDelta.dump();
+        }
+        if (this->newClient.exchange(false))
+        {
+            frame.full = jState.dump();
+        }
+        return frame;
+    }
+
+    void send(const TelemetryFrame &frame)
+    {
+        this->clients.send(frame, [this, &frame](int fd, const string &payload)
+                           {
+            json jPayload = json::parse(payload);
+            if (payload == frame.full)
+            {
+                this->received[fd] = jPayload;
+                return;
+            }
+            if (!this->received.contains(fd))
+            {
+                this->deltasBeforeFull[fd]++;
+                return;
+            }
+            for (auto &[key, value] : jPayload.items())
+            {
+                this->received[fd][key] = value;
+            } }, [](int)
+                           { return false; });
+
+        if (this->clients.waiting())
+        {
+            this->newClient = true;
+        }
+    }
+};
+
+// a client whose handshake comes after a push took the new client flag, but before that frame is sent
+// it must not get deltas it can't apply, the next frame brings it the full state
+static void testHandshakeBetweenPushAndSend()
+{
+    PushEngine engine;
+    engine.connect(1);
+    engine.send(engine.push(makeState(0)));
+    CHECK(engine.received[1] == makeState(0));
+
+    TelemetryFrame frame = engine.push(makeState(10));
+    CHECK(frame.full.empty());
+    engine.connect(2);
+    engine.send(frame);
+
+    CHECK(!engine.received.contains(2));
+    CHECK(engine.deltasBeforeFull[2] == 0);
+    CHECK(engine.clients.waiting());
+
+    engine.send(engine.push(makeState(20)));
+    CHECK(!engine.clients.waiting());
+
+    for (int tick = 30; tick < 300; tick += 10)
+    {
+        engine.send(engine.push(makeState(tick)));
+    }
+
+    // both know the state of the last push, the late one never saw a delta first
+    CHECK(engine.received[1] == makeState(290));
+    CHECK(engine.received[2] == makeState(290));
+    CHECK(engine.deltasBeforeFull[2] == 0);
+
+    // one that leaves before its full state is forgotten
+    engine.connect(3);
+    engine.clients.remove(3);
+    CHECK(!engine.clients.waiting());
+    CHECK(engine.clients.size() == 2);
+}
+
+int main()
+{
+    testDelta();
+    testHandshakeBetweenPushAndSend();
+
+    for (int clients : {1, 4, 8})
+    {
+        Load polling = simulate(clients, false);
+        Load pushing = simulate(clients, true);
+
+        printf("%d clients, an hour: polling %7.1f ms %8zu allocations %6zu bytes peak %8zu bytes sent, push %6.1f ms %7zu allocations %5zu bytes peak %8zu bytes sent\n",
+               clients, polling.milliseconds, polling.allocations, polling.peakBytes, polling.sentBytes,
+               pushing.milliseconds, pushing.allocations, pushing.peakBytes, pushing.sentBytes);
+
+        // keeping the last state for the delta costs a bit, with one client a push does about as much as a poll
+        // but the engine does the same work however many clients listen, and the deltas are a lot smaller
+        CHECK(pushing.sentBytes * 10 < polling.sentBytes);
+        if (clients > 1)
+        {
+            CHECK(pushing.allocations < polling.allocations);
+            CHECK(pushing.allocations == simulate(1, true).allocations);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "check.h"
+#include "tiered-history.h"
+
+// the ring keeps the newest samples and finds them by time
+static void testRing()
+{
+    TemperatureHistory history;
+    history.reserve(5 * 6); // 5 samples
+
+    for (int i = 0; i < 8; i++)
+    {
+        history.push(1000 + (i * 10), 20 + i);
+    }
+
+    CHECK(history.size() == 5);
+    CHECK(history.at(0).time == 1030);
+    CHECK(history.back().time == 1070);
+    CHECK(history.back().temperature == 27);
+    CHECK(history.indexAfter(1029) == 0);
+    CHECK(history.indexAfter(1030) == 1);
+    CHECK(history.indexAfter(1055) == 3);
+    CHECK(history.indexAfter(1070) == 5);
+}
+
+static std::vector<TieredHistory::Sample> query(const TieredHistory &history, time_t from, time_t to, size_t maxPoints, uint16_t &bucket)
+{
+    std::vector<TieredHistory::Sample> samples;
+    bucket = history.query(from, to, maxPoints, [&samples](const TieredHistory::Sample &sample)
+                           { samples.push_back(sample); });
+    return samples;
+}
+
+// a four hour brew, the recent past at full resolution and the whole day in coarse buckets that keep the peaks
+static void testTiers()
+{
+    TieredHistory history;
+    history.reserve(6000);
+
+    const time_t start = 1700000000;
+    const time_t end = start + (4 * 3600);
+    const time_t spike = start + 3600;
+
+    for (time_t time = start; time < end; time += 2)
+    {
+        float temperature = 60 + (5 * std::sin((double)(time - start) / 600));
+        if (time == spike)
+        {
+            temperature = 90;
+        }
+        history.push(time, temperature);
+    }
+
+    uint16_t bucket;
+    auto recent = query(history, end - 600, end, 1000, bucket);
+    CHECK(bucket == 0);
+    CHECK(recent.size() == 300);
+
+    auto day = query(history, start, end, 1000, bucket);
+    CHECK(bucket == 300);
+    printf("recent %zu samples, whole day %zu samples in buckets of %d s\n", recent.size(), day.size(), bucket);
+    CHECK(!day.empty());
+
+    float highest = 0;
+    for (size_t i = 0; i < day.size(); i++)
+    {
+        highest = std::max(highest, day[i].temperature);
+        if (i > 0)
+        {
+            CHECK(day[i].time > day[i - 1].time);
+        }
+    }
+    CHECK(highest == 90);
+
+    // thinned out to the number of points asked for, first and last stay
+    auto thinned = query(history, end - 600, end, 50, bucket);
+    CHECK(thinned.size() == 50);
+    CHECK(thinned.front().time == recent.front().time);
+    CHECK(thinned.back().time == recent.back().time);
+
+    // the open bucket counts towards the points asked for as well
+    for (size_t maxPoints : {1, 2, 3, 20, 50})
+    {
+        auto thinnedDay = query(history, start, end, maxPoints, bucket);
+        CHECK(bucket == 300);
+        CHECK(thinnedDay.size() == maxPoints);
+        CHECK(thinnedDay.back().time == day.back().time);
+    }
+}
+
+int main()
+{
+    testRing();
+    testTiers();
+
+    return 0;
+}
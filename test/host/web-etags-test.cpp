@@ -0,0 +1,108 @@
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "web-etags.h"
+
+static void testLoad()
+{
+    FILE *file = tmpfile();
+    CHECK(file != nullptr);
+    fputs("3f2a9c0d11b4e7a5 /index.html.gz\n"
+          "0123456789abcdef /assets/index-Bx1.js.gz\n"
+          "fedcba9876543210 /assets/index-C2y.css.gz\n",
+          file);
+    rewind(file);
+
+    WebEtags etags;
+    CHECK(etags.load(file) == 3);
+    fclose(file);
+
+    CHECK(string(etags.find("/index.html.gz")) == "\"3f2a9c0d11b4e7a5\"");
+    CHECK(string(etags.find("/assets/index-Bx1.js.gz")) == "\"0123456789abcdef\"");
+    CHECK(etags.find("/index.html") == nullptr);
+    CHECK(etags.find("/missing.gz") == nullptr);
+}
+
+static void testMatches()
+{
+    const char *etag = "\"0123456789abcdef\"";
+
+    CHECK(WebEtags::matches("\"0123456789abcdef\"", etag));
+    CHECK(WebEtags::matches("W/\"0123456789abcdef\"", etag));
+    CHECK(WebEtags::matches("\"aaaa\", \"0123456789abcdef\"", etag));
+    CHECK(WebEtags::matches("\"aaaa\",W/\"0123456789abcdef\" ", etag));
+    CHECK(WebEtags::matches("*", etag));
+    CHECK(WebEtags::matches(std::string_view("\"0123456789abcdef\"\0", 19), etag)); // like the header buffer we read it into
+
+    CHECK(!WebEtags::matches("", etag));
+    CHECK(!WebEtags::matches("\"0123456789abcde\"", etag));
+    CHECK(!WebEtags::matches("\"0123456789abcdef0\"", etag));
+    CHECK(!WebEtags::matches("0123456789abcdef", etag)); // a hash without quotes is not the etag
+}
+
+struct WebFile
+{
+    string path;
+    size_t size;
+    string etag;
+};
+
+// what a browser does: it remembers the etag of what it got and sends it back, a 304 has no body
+// returns the body bytes of one page load
+static size_t pageLoad(const std::vector<WebFile> &files, std::map<string, string> &browserCache, bool useEtags)
+{
+    size_t bytes = 0;
+    for (auto const &file : files)
+    {
+        auto cached = browserCache.find(file.path);
+        if (useEtags && cached != browserCache.end() && WebEtags::matches(cached->second, file.etag))
+        {
+            continue;
+        }
+
+        bytes += file.size;
+        browserCache.insert_or_assign(file.path, file.etag);
+    }
+    return bytes;
+}
+
+// a phone that comes back on the brewhouse wifi, before it got every file again
+static void comparePageLoads()
+{
+    std::vector<WebFile> files = {
+        {"/index.html.gz", 612, "\"3f2a9c0d11b4e7a5\""},
+        {"/assets/index-Bx1.js.gz", 231400, "\"0123456789abcdef\""},
+        {"/assets/index-C2y.css.gz", 48210, "\"fedcba9876543210\""},
+        {"/assets/materialdesignicons.woff2.gz", 402000, "\"00ff00ff00ff00ff\""},
+        {"/logo.svg.gz", 2100, "\"1111222233334444\""},
+        {"/manifest.json", 410, "\"5555666677778888\""},
+    };
+
+    std::map<string, string> withoutEtags;
+    std::map<string, string> withEtags;
+
+    size_t first = pageLoad(files, withEtags, true);
+    CHECK(first == pageLoad(files, withoutEtags, false));
+
+    size_t before = pageLoad(files, withoutEtags, false);
+    size_t after = pageLoad(files, withEtags, true);
+    CHECK(after == 0);
+
+    // a new firmware that only changed the script
+    files[1].etag = "\"9999888877776666\"";
+    size_t update = pageLoad(files, withEtags, true);
+    CHECK(update == files[1].size);
+
+    printf("page load: %zu bytes the first time, again %zu bytes without etags, %zu bytes with, %zu bytes after an update of one file\n",
+           first, before, after, update);
+}
+
+int main()
+{
+    testLoad();
+    testMatches();
+    comparePageLoads();
+    return 0;
+}
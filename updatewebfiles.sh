@@ -0,0 +1,21 @@
+#/bin/bash
+# builds the web ui as separate files for the www partition, flashed with the next idf.py flash
+cd web
+yarn build:split
+cd ..
+
+rm -rf ./web/www
+mkdir -p ./web/www
+
+# everything is stored precompressed, the engine serves the .gz variant
+cd ./web/dist-split
+find . -type f | while read -r file; do
+  mkdir -p "../www/$(dirname "$file")"
+  gzip -9 -c "$file" > "../www/$file.gz"
+done
+
+# content hashes of the stored files, the engine sends them as etag so unchanged files aren't downloaded again
+cd ../www
+find . -type f ! -name etags | while read -r file; do
+  echo "$(sha256sum "$file" | cut -c1-16) ${file#.}"
+done > etags
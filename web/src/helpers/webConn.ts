@@ -24,8 +24,15 @@ export default class WebConn {
         // referrerPolicy: "no-referrer", // no-referrer, *no-referrer-when-downgrade, origin, origin-when-cross-origin, same-origin, strict-origin, strict-origin-when-cross-origin, unsafe-url
         body: JSON.stringify(data), // body data type must match "Content-Type" header
       })
-        .then((result) => {
-          const apiResult = result.json();
+        .then(async (result) => {
+          const apiResult = await result.json();
+
+          // slow commands run as a job on the engine, we wait for the real result
+          if (apiResult !== null && !Array.isArray(apiResult) && apiResult.jobId !== undefined) {
+            resolve(await this.waitForJob(apiResult.jobId));
+            return;
+          }
+
           resolve(apiResult);
         })
         .catch((error) => {
@@ -39,4 +46,50 @@ export default class WebConn {
         });
     });
   }
+
+  async waitForJob(jobId: number): Promise<IApiResult> {
+    for (let i = 0; i < 60; i += 1) {
+      await new Promise((r) => setTimeout(r, 500));
+
+      const apiResult = await this.doPostRequest({ command: "GetJob", data: { id: jobId } });
+      if (apiResult.jobId === undefined) {
+        return apiResult;
+      }
+    }
+
+    return {
+      success: false,
+      data: null,
+      message: "Timeout waiting for the engine",
+    };
+  }
+
+  // sends several commands in one request, results come back in the same order
+  doBatchRequest(data: Array<any>): Promise<Array<IApiResult>> {
+    return this.doPostRequest(data) as unknown as Promise<Array<IApiResult>>;
+  }
+
+  // websocket the engine uses to push telemetry, messages are (partial) data packets
+  openEvents(onData: (data: any) => void): WebSocket | null {
+    if (this.rootUrl == null) {
+      return null;
+    }
+
+    const url = `${this.rootUrl.replace(/^http/, "ws")}api/events`;
+
+    try {
+      const socket = new WebSocket(url);
+      socket.onmessage = (event) => {
+        try {
+          onData(JSON.parse(event.data));
+        } catch (error) {
+          console.error(error);
+        }
+      };
+      return socket;
+    } catch (error) {
+      console.error(error);
+      return null;
+    }
+  }
 }
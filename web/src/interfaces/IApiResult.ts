@@ -2,4 +2,5 @@ export interface IApiResult {
   success: boolean;
   data: any;
   message: string;
+  jobId?: number;
 }
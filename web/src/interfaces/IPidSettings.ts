@@ -8,4 +8,5 @@ export interface IPidSettings {
   pidLoopTime: number;
   stepInterval: number;
   boostModeUntil: number;
+  heatUpRate: number;
 }
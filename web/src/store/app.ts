@@ -39,24 +39,33 @@ export const useAppStore = () => {
       }
 
       const webConn = new WebConn(rootUrl.value);
-      const requestData = {
-        command: "GetSystemSettings",
-        data: null,
-      };
 
-      const apiResult = await webConn?.doPostRequest(requestData);
+      // also get our schedules, in the same request
+      const requestData = [
+        {
+          command: "GetSystemSettings",
+          data: null,
+        },
+        {
+          command: "GetMashSchedules",
+          data: null,
+        },
+      ];
 
-      if (apiResult === undefined || apiResult.success === false) {
+      const apiResults = await webConn?.doBatchRequest(requestData);
+
+      if (apiResults === undefined || apiResults[0].success === false) {
         return;
       }
 
-      temperatureScale.value = apiResult.data.temperatureScale;
+      temperatureScale.value = apiResults[0].data.temperatureScale;
       if (temperatureScale.value === TemperatureScale.Fahrenheit) {
         tempUnit.value = "°F";
       }
 
-      // also get our schedules
-      getMashSchedules();
+      if (apiResults[1]?.success) {
+        mashSchedules.value = apiResults[1].data;
+      }
 
       systemSettingsLoaded.value = true;
     }
@@ -29,7 +29,8 @@ export default defineConfig(({ command, mode }) => {
           configFile: "src/styles/settings.scss",
         },
       }),
-      viteSingleFile(),
+      // the embedded ui is one file, the www partition gets separate hashed files
+      mode !== "split" && viteSingleFile(),
       // {
       //   name: 'build-script',
       //   closeBundle() {
@@ -64,12 +65,19 @@ export default defineConfig(({ command, mode }) => {
         },
       },
     },
-    // build: {
-    //   rollupOptions: {
-    //     output: {
-    //       manualChunks: undefined,
-    //     },
-    //   },
-    // },
+    // spiffs names are limited to 32 characters, so assets only get their hash
+    build:
+      mode === "split"
+        ? {
+            outDir: "dist-split",
+            rollupOptions: {
+              output: {
+                entryFileNames: "assets/[hash].js",
+                chunkFileNames: "assets/[hash].js",
+                assetFileNames: "assets/[hash][extname]",
+              },
+            },
+          }
+        : {},
   };
 });